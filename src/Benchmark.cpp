@@ -0,0 +1,255 @@
+#include "Benchmark.h"
+#include "FPSGame.h"
+#include "SceneLoader.h"
+
+#include <OgreRoot.h>
+#include <OgreRenderSystem.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+#include <sys/resource.h> // for getrusage()
+
+// the default orbit, around wherever the scene puts the camera
+static const float ORBIT_RADIUS = 20.0f;
+static const float ORBIT_SECONDS = 20.0f;
+
+static long getPeakRssKb()
+{
+    // NOTE: kilobytes on Linux
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return usage.ru_maxrss;
+}
+
+static void writeJsonString(std::ostream &out, const std::string &text)
+{
+    out << '"';
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            out << ' ';
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+// nearest-rank percentile of sorted values
+static float getPercentile(const std::vector<float> &sorted, double fraction)
+{
+    if (sorted.empty())
+        return 0.0f;
+    const size_t rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(fraction * sorted.size())));
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+Benchmark::Benchmark(const BenchmarkOptions &options, const std::string &scenePath) :
+    mOptions(options),
+    mScenePath(scenePath),
+    mPhase(Phase::Loading),
+    mFrame(0),
+    mLoadTimeMs(0.0f)
+{
+    mOptions.frames = std::max(mOptions.frames, 1);
+    mOptions.warmupFrames = std::max(mOptions.warmupFrames, 0);
+    mRecords.reserve(mOptions.frames);
+}
+
+bool Benchmark::loadCameraPath()
+{
+    if (mOptions.cameraPathFile.empty())
+        return true;
+    if (!mCameraPath.load(mOptions.cameraPathFile))
+    {
+        mPhase = Phase::Failed;
+        return false;
+    }
+    std::cout << "Benchmark: camera path \"" << mOptions.cameraPathFile << "\" with " << mCameraPath.getNumKeyframes() << " keyframes" << std::endl;
+    return true;
+}
+
+void Benchmark::beginFrame(FPSGame &game)
+{
+    if (mPhase == Phase::Loading)
+    {
+        const AsyncSceneLoad * const sceneLoad = game.getSceneLoad();
+        if (sceneLoad && !sceneLoad->isFinished())
+            return;
+        if (sceneLoad && sceneLoad->getState() == AsyncSceneLoad::STATE_FAILED)
+        {
+            std::cerr << "error: the benchmark scene \"" << mScenePath << "\" failed to load" << std::endl;
+            mPhase = Phase::Failed;
+            return;
+        }
+        mLoadTimeMs = sceneLoad ? static_cast<float>(sceneLoad->getStats().totalMs) : 0.0f;
+        if (mCameraPath.empty())
+            mCameraPath = CameraPath::makeOrbit(game.getCameraState().position, ORBIT_RADIUS, ORBIT_SECONDS);
+        mPhase = mOptions.warmupFrames > 0 ? Phase::WarmingUp : Phase::Measuring;
+        mFrame = 0;
+        std::cout << "Benchmark: scene loaded in " << mLoadTimeMs << " ms, rendering " << mOptions.warmupFrames << " + " << mOptions.frames << " frames" << std::endl;
+    }
+
+    if (mPhase == Phase::WarmingUp)
+        game.setCameraState(mCameraPath.sample(_GetPathTime(mFrame, mOptions.warmupFrames)));
+    else if (mPhase == Phase::Measuring)
+        game.setCameraState(mCameraPath.sample(_GetPathTime(mFrame, mOptions.frames)));
+}
+
+void Benchmark::endFrame(const FrameTiming &timing)
+{
+    if (mPhase == Phase::WarmingUp)
+    {
+        if (++mFrame == mOptions.warmupFrames)
+        {
+            mPhase = Phase::Measuring;
+            mFrame = 0;
+        }
+        return;
+    }
+    if (mPhase != Phase::Measuring)
+        return;
+
+    // NOTE: the metrics are those of the frame that was just rendered
+    const Ogre::RenderingMetrics &metrics = Ogre::Root::getSingleton().getRenderSystem()->getMetrics();
+    FrameRecord record;
+    record.timing = timing;
+    record.drawCount = metrics.mDrawCount;
+    record.batchCount = metrics.mBatchCount;
+    record.faceCount = metrics.mFaceCount;
+    record.vertexCount = metrics.mVertexCount;
+    mRecords.push_back(record);
+    if (++mFrame == mOptions.frames)
+        mPhase = Phase::Done;
+}
+
+bool Benchmark::writeResults() const
+{
+    const bool ok = _WriteJson(mOptions.outputPath + ".json") && _WriteCsv(mOptions.outputPath + ".csv");
+    if (ok)
+        std::cout << "Benchmark: wrote " << mOptions.outputPath << ".json and " << mOptions.outputPath << ".csv" << std::endl;
+    return ok;
+}
+
+float Benchmark::_GetPathTime(int frame, int frameCount) const
+{
+    // the first and the last frame are the ends of the path
+    if (frameCount <= 1)
+        return 0.0f;
+    return mCameraPath.getDuration() * frame / (frameCount - 1);
+}
+
+bool Benchmark::_WriteJson(const std::string &filename) const
+{
+    std::vector<float> totals;
+    totals.reserve(mRecords.size());
+    FrameTiming sums;
+    double drawCount = 0.0, batchCount = 0.0, faceCount = 0.0, vertexCount = 0.0;
+    // NOTE: the stutters are counted like the frame stats panel counts them (see FrameTimingHistory), so a run
+    // reports the same number either way
+    std::unique_ptr<FrameTimingHistory> history = std::make_unique<FrameTimingHistory>();
+    for (const FrameRecord &record : mRecords)
+    {
+        history->push(record.timing);
+        totals.push_back(record.timing.totalMs);
+        sums.inputMs += record.timing.inputMs;
+        sums.simulationMs += record.timing.simulationMs;
+        sums.ogreMs += record.timing.ogreMs;
+        sums.rmluiMs += record.timing.rmluiMs;
+        sums.swapMs += record.timing.swapMs;
+        sums.totalMs += record.timing.totalMs;
+        drawCount += record.drawCount;
+        batchCount += record.batchCount;
+        faceCount += record.faceCount;
+        vertexCount += record.vertexCount;
+    }
+    std::sort(totals.begin(), totals.end());
+    const double frames = std::max<size_t>(mRecords.size(), 1);
+    const float median = getPercentile(totals, 0.5);
+    const uint64_t stutters = history->getSummary().totalStutters;
+
+    std::ofstream out(filename);
+    if (!out)
+    {
+        std::cerr << "error: could not write the benchmark results to \"" << filename << "\"" << std::endl;
+        return false;
+    }
+    out << std::fixed << std::setprecision(4);
+    out << "{\n";
+    out << "  \"scene\": "; writeJsonString(out, mScenePath); out << ",\n";
+    out << "  \"cameraPath\": "; writeJsonString(out, mOptions.cameraPathFile.empty() ? "orbit" : mOptions.cameraPathFile); out << ",\n";
+    out << "  \"frames\": " << mRecords.size() << ",\n";
+    out << "  \"warmupFrames\": " << mOptions.warmupFrames << ",\n";
+    out << "  \"loadTimeMs\": " << mLoadTimeMs << ",\n";
+    out << "  \"peakRssKb\": " << getPeakRssKb() << ",\n";
+    out << "  \"frameTimeMs\": {\n";
+    out << "    \"mean\": " << sums.totalMs / frames << ",\n";
+    out << "    \"min\": " << (totals.empty() ? 0.0f : totals.front()) << ",\n";
+    out << "    \"p50\": " << median << ",\n";
+    out << "    \"p95\": " << getPercentile(totals, 0.95) << ",\n";
+    out << "    \"p99\": " << getPercentile(totals, 0.99) << ",\n";
+    out << "    \"p99.9\": " << getPercentile(totals, 0.999) << ",\n";
+    out << "    \"max\": " << (totals.empty() ? 0.0f : totals.back()) << "\n";
+    out << "  },\n";
+    out << "  \"stutters\": " << stutters << ",\n";
+    out << "  \"phaseMeanMs\": {\n";
+    out << "    \"input\": " << sums.inputMs / frames << ",\n";
+    out << "    \"simulation\": " << sums.simulationMs / frames << ",\n";
+    out << "    \"ogreRender\": " << sums.ogreMs / frames << ",\n";
+    out << "    \"rmluiRender\": " << sums.rmluiMs / frames << ",\n";
+    out << "    \"swap\": " << sums.swapMs / frames << "\n";
+    out << "  },\n";
+    out << "  \"meanDrawCalls\": " << drawCount / frames << ",\n";
+    out << "  \"meanBatches\": " << batchCount / frames << ",\n";
+    out << "  \"meanFaces\": " << faceCount / frames << ",\n";
+    out << "  \"meanVertices\": " << vertexCount / frames << "\n";
+    out << "}\n";
+    out.close();
+    if (!out)
+    {
+        std::cerr << "error: could not write the benchmark results to \"" << filename << "\"" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Benchmark::_WriteCsv(const std::string &filename) const
+{
+    std::ofstream out(filename);
+    if (!out)
+    {
+        std::cerr << "error: could not write the benchmark results to \"" << filename << "\"" << std::endl;
+        return false;
+    }
+    out << std::fixed << std::setprecision(4);
+    out << "frame,total_ms,input_ms,simulation_ms,ogre_ms,rmlui_ms,swap_ms,draw_calls,batches,faces,vertices\n";
+    for (size_t i = 0; i < mRecords.size(); ++i)
+    {
+        const FrameRecord &record = mRecords[i];
+        out << i << ","
+            << record.timing.totalMs << ","
+            << record.timing.inputMs << ","
+            << record.timing.simulationMs << ","
+            << record.timing.ogreMs << ","
+            << record.timing.rmluiMs << ","
+            << record.timing.swapMs << ","
+            << record.drawCount << ","
+            << record.batchCount << ","
+            << record.faceCount << ","
+            << record.vertexCount << "\n";
+    }
+    out.close();
+    if (!out)
+    {
+        std::cerr << "error: could not write the benchmark results to \"" << filename << "\"" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "CameraPath.h"
+#include "FrameTimingHistory.h" // for FrameTiming
+
+#include <string>
+#include <vector>
+
+class FPSGame;
+
+struct BenchmarkOptions
+{
+    int frames = 1000; // measured frames, the camera path is spread evenly over them
+    int warmupFrames = 60; // rendered from the start of the path before measuring, so shaders etc. are compiled
+    std::string cameraPathFile; // empty flies an orbit around the start position
+    std::string outputPath = "benchmark"; // writes outputPath + ".json" (summary) and outputPath + ".csv" (per frame)
+};
+
+// runs FPSGame non-interactively: waits for the scene to load, flies the camera along a path for a fixed number
+// of frames (not a fixed time, so every run renders the same frames), then writes the results
+class Benchmark
+{
+public:
+    enum class Phase
+    {
+        Loading,
+        WarmingUp,
+        Measuring,
+        Done,
+        Failed
+    };
+
+    Benchmark(const BenchmarkOptions &options, const std::string &scenePath);
+    bool loadCameraPath(); // NOTE: reports its own errors
+    Phase getPhase() const {return mPhase;}
+    bool isFinished() const {return mPhase == Phase::Done || mPhase == Phase::Failed;}
+
+    // call after FPSGame::advance(), before drawing, puts the camera where this frame needs it
+    void beginFrame(FPSGame &game);
+    // call after presenting, with the CPU timings of the frame
+    void endFrame(const FrameTiming &timing);
+    // writes the JSON and CSV files, returns false on failure
+    bool writeResults() const;
+protected:
+    struct FrameRecord
+    {
+        FrameTiming timing;
+        size_t drawCount;
+        size_t batchCount;
+        size_t faceCount;
+        size_t vertexCount;
+    };
+    float _GetPathTime(int frame, int frameCount) const;
+    bool _WriteJson(const std::string &filename) const;
+    bool _WriteCsv(const std::string &filename) const;
+protected:
+    BenchmarkOptions mOptions;
+    std::string mScenePath;
+    CameraPath mCameraPath;
+    Phase mPhase;
+    int mFrame; // of the current phase
+    float mLoadTimeMs;
+    std::vector<FrameRecord> mRecords;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,134 @@
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static const int ORBIT_KEYFRAMES = 16;
+
+// Catmull-Rom between p1 and p2, with p0 and p3 as the neighbours
+template <typename T>
+static T catmullRom(const T &p0, const T &p1, const T &p2, const T &p3, float t)
+{
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    return ((p1 * 2.0f) +
+            (p2 - p0) * t +
+            (p0 * 2.0f - p1 * 5.0f + p2 * 4.0f - p3) * t2 +
+            (p1 * 3.0f - p0 - p2 * 3.0f + p3) * t3) * 0.5f;
+}
+
+CameraPath CameraPath::makeOrbit(const Ogre::Vector3 &center, float radius, float seconds)
+{
+    CameraPath path;
+    for (int i = 0; i <= ORBIT_KEYFRAMES; ++i)
+    {
+        const float angle = 360.0f * i / ORBIT_KEYFRAMES;
+        const float radians = angle * static_cast<float>(M_PI) / 180.0f;
+        CameraKeyframe keyframe;
+        keyframe.time = seconds * i / ORBIT_KEYFRAMES;
+        keyframe.state.position = center + Ogre::Vector3(std::sin(radians) * radius, 0.0f, std::cos(radians) * radius);
+        // NOTE: yaw 0 looks along -Z, so this looks ahead along the circle (counterclockwise seen from above)
+        keyframe.state.yaw = angle - 90.0f;
+        keyframe.state.pitch = -10.0f;
+        path.mKeyframes.push_back(keyframe);
+    }
+    return path;
+}
+
+bool CameraPath::load(const std::string &filename)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        std::cerr << "error: could not open the camera path \"" << filename << "\"" << std::endl;
+        return false;
+    }
+    std::vector<CameraKeyframe> keyframes;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        const size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#')
+            continue;
+        std::istringstream stream(line);
+        CameraKeyframe keyframe;
+        Ogre::Vector3 &position = keyframe.state.position;
+        if (!(stream >> keyframe.time >> position.x >> position.y >> position.z >> keyframe.state.pitch >> keyframe.state.yaw))
+        {
+            std::cerr << "error: " << filename << ":" << lineNumber << ": expected \"time x y z pitch yaw\"" << std::endl;
+            return false;
+        }
+        if (!keyframes.empty() && keyframe.time < keyframes.back().time)
+        {
+            std::cerr << "error: " << filename << ":" << lineNumber << ": keyframes have to be in time order" << std::endl;
+            return false;
+        }
+        keyframes.push_back(keyframe);
+    }
+    if (keyframes.empty())
+    {
+        std::cerr << "error: the camera path \"" << filename << "\" has no keyframes" << std::endl;
+        return false;
+    }
+    mKeyframes = std::move(keyframes);
+    return true;
+}
+
+bool CameraPath::save(const std::string &filename) const
+{
+    std::ofstream file(filename);
+    file << "# time x y z pitch yaw" << std::endl;
+    for (const CameraKeyframe &keyframe : mKeyframes)
+    {
+        const Ogre::Vector3 &position = keyframe.state.position;
+        file << keyframe.time << " " << position.x << " " << position.y << " " << position.z << " "
+             << keyframe.state.pitch << " " << keyframe.state.yaw << std::endl;
+    }
+    if (!file)
+    {
+        std::cerr << "error: could not write the camera path \"" << filename << "\"" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void CameraPath::addKeyframe(float time, const GameState &state)
+{
+    CameraKeyframe keyframe;
+    keyframe.time = mKeyframes.empty() ? time : std::max(time, mKeyframes.back().time);
+    keyframe.state = state;
+    mKeyframes.push_back(keyframe);
+}
+
+GameState CameraPath::sample(float time) const
+{
+    if (mKeyframes.empty())
+        return GameState();
+    if (time <= mKeyframes.front().time)
+        return mKeyframes.front().state;
+    if (time >= mKeyframes.back().time)
+        return mKeyframes.back().state;
+
+    // the segment [i, i + 1] containing time
+    const auto next = std::upper_bound(mKeyframes.begin(), mKeyframes.end(), time,
+                                       [](float t, const CameraKeyframe &keyframe) {return t < keyframe.time;});
+    const size_t i = static_cast<size_t>(next - mKeyframes.begin()) - 1;
+    const CameraKeyframe &k1 = mKeyframes[i];
+    const CameraKeyframe &k2 = mKeyframes[i + 1];
+    // NOTE: the ends reuse their own keyframe as the missing neighbour
+    const CameraKeyframe &k0 = mKeyframes[i > 0 ? i - 1 : i];
+    const CameraKeyframe &k3 = mKeyframes[i + 2 < mKeyframes.size() ? i + 2 : i + 1];
+    const float duration = k2.time - k1.time;
+    const float t = duration > 0.0f ? (time - k1.time) / duration : 0.0f;
+
+    GameState state;
+    state.position = catmullRom(k0.state.position, k1.state.position, k2.state.position, k3.state.position, t);
+    state.pitch = catmullRom(k0.state.pitch, k1.state.pitch, k2.state.pitch, k3.state.pitch, t);
+    state.yaw = catmullRom(k0.state.yaw, k1.state.yaw, k2.state.yaw, k3.state.yaw, t);
+    return state;
+}
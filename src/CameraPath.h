@@ -0,0 +1,37 @@
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include "GameSimulation.h" // for GameState
+
+#include <string>
+#include <vector>
+
+struct CameraKeyframe
+{
+    float time = 0.0f; // seconds since the start of the path
+    GameState state;
+};
+
+// a camera flythrough, a Catmull-Rom spline through keyframes of the camera position, pitch and yaw
+//
+// stored as text, one keyframe per line: "time x y z pitch yaw" (lines starting with '#' are comments)
+class CameraPath
+{
+public:
+    // a loop around center, looking along the way, for when there is no recorded path
+    static CameraPath makeOrbit(const Ogre::Vector3 &center, float radius, float seconds);
+
+    bool load(const std::string &filename);
+    bool save(const std::string &filename) const;
+    // NOTE: keyframes have to be added in time order
+    void addKeyframe(float time, const GameState &state);
+    bool empty() const {return mKeyframes.empty();}
+    size_t getNumKeyframes() const {return mKeyframes.size();}
+    float getDuration() const {return mKeyframes.empty() ? 0.0f : mKeyframes.back().time;}
+    // time is clamped to the path
+    GameState sample(float time) const;
+protected:
+    std::vector<CameraKeyframe> mKeyframes;
+};
+
+#endif // CAMERAPATH_H
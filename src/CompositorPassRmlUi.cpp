@@ -0,0 +1,102 @@
+#include "CompositorPassRmlUi.h"
+#include "RenderInterface_Ogre.h"
+#include "GpuTimer.h"
+#include "Profiler.h"
+
+#include <RmlUi/Core/Context.h>
+
+#include <chrono>
+
+CompositorPassRmlUi::CompositorPassRmlUi(const CompositorPassRmlUiDef *definition, Ogre::CompositorNode *parentNode, const Ogre::RenderTargetViewDef *rtvDef, CompositorPassRmlUiProvider *provider) :
+    Ogre::CompositorPass(definition, parentNode),
+    mProvider(provider)
+{
+    initialize(rtvDef);
+}
+
+void CompositorPassRmlUi::execute(const Ogre::Camera *lodCamera)
+{
+    Rml::Context * const context = mProvider->getContext();
+    RenderInterface_Ogre * const renderInterface = mProvider->getRenderInterface();
+    if (!context || !renderInterface)
+        return;
+
+    PROFILE_ZONE("CompositorPassRmlUi");
+    // NOTE: the same steps as Ogre's own passes (i.e. CompositorPassQuad), minus the ones we don't use
+    profilingBegin();
+    notifyPassEarlyPreExecuteListeners();
+    executeResourceTransitions();
+
+    const std::chrono::steady_clock::time_point renderStart = std::chrono::steady_clock::now();
+    mProvider->_gpuTimestamp(false);
+    // NOTE: in retained mode the UI is drawn into its layer (if it changed) before this pass' render pass begins
+    const bool retained = renderInterface->IsRetained();
+    if (retained)
+    {
+        renderInterface->BeginRecording();
+        context->Render();
+        renderInterface->EndRecording();
+    }
+    setRenderPassDescToCurrent();
+    notifyPassPreExecuteListeners();
+    renderInterface->BeginFrame(mRenderPassDesc, mAnyTargetTexture, mAnyMipLevel);
+    if (retained)
+        renderInterface->DrawLayer();
+    else
+        context->Render();
+    renderInterface->EndFrame();
+    mProvider->_gpuTimestamp(true);
+    mProvider->_addRenderTime(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - renderStart).count());
+
+    notifyPassPosExecuteListeners();
+    profilingEnd();
+}
+
+CompositorPassRmlUiProvider::CompositorPassRmlUiProvider() :
+    mContext(nullptr),
+    mRenderInterface(nullptr),
+    mRenderTimeMs(0.0f),
+    mGpuTimer(nullptr),
+    mGpuBeginTimestamp(0),
+    mGpuEndTimestamp(0)
+{
+}
+
+void CompositorPassRmlUiProvider::setContext(Rml::Context *context, RenderInterface_Ogre *renderInterface)
+{
+    mContext = context;
+    mRenderInterface = renderInterface;
+}
+
+float CompositorPassRmlUiProvider::takeRenderTime()
+{
+    const float ms = mRenderTimeMs;
+    mRenderTimeMs = 0.0f;
+    return ms;
+}
+
+void CompositorPassRmlUiProvider::setGpuTimer(GpuTimer *timer, size_t beginTimestamp, size_t endTimestamp)
+{
+    mGpuTimer = timer;
+    mGpuBeginTimestamp = beginTimestamp;
+    mGpuEndTimestamp = endTimestamp;
+}
+
+void CompositorPassRmlUiProvider::_gpuTimestamp(bool end)
+{
+    if (mGpuTimer)
+        mGpuTimer->timestamp(end ? mGpuEndTimestamp : mGpuBeginTimestamp);
+}
+
+Ogre::CompositorPassDef * CompositorPassRmlUiProvider::addPassDef(Ogre::CompositorPassType passType, Ogre::IdString customId, Ogre::CompositorTargetDef *parentTargetDef, Ogre::CompositorNodeDef *parentNodeDef)
+{
+    if (customId == getPassId())
+        return OGRE_NEW CompositorPassRmlUiDef(parentTargetDef);
+    return nullptr;
+}
+
+Ogre::CompositorPass * CompositorPassRmlUiProvider::addPass(const Ogre::CompositorPassDef *definition, Ogre::Camera *defaultCamera, Ogre::CompositorNode *parentNode, const Ogre::RenderTargetViewDef *rtvDef, Ogre::SceneManager *sceneManager)
+{
+    // NOTE: only ever called with the definitions made by addPassDef(), Ogre deletes both with OGRE_DELETE
+    return OGRE_NEW CompositorPassRmlUi(static_cast<const CompositorPassRmlUiDef *>(definition), parentNode, rtvDef, this);
+}
@@ -0,0 +1,68 @@
+#ifndef COMPOSITORPASSRMLUI_H
+#define COMPOSITORPASSRMLUI_H
+
+#include <Compositor/Pass/OgreCompositorPass.h>
+#include <Compositor/Pass/OgreCompositorPassDef.h>
+#include <Compositor/Pass/OgreCompositorPassProvider.h>
+
+namespace Rml {
+
+class Context;
+
+} // namespace Rml
+
+class RenderInterface_Ogre;
+class CompositorPassRmlUiProvider;
+class GpuTimer;
+
+// a custom compositor pass ("custom rmlui" in a compositor script) that renders an RmlUi context
+// into the pass' render target, usually after the scene pass of the window
+class CompositorPassRmlUiDef : public Ogre::CompositorPassDef
+{
+public:
+    CompositorPassRmlUiDef(Ogre::CompositorTargetDef *parentTargetDef) :
+        Ogre::CompositorPassDef(Ogre::PASS_CUSTOM, parentTargetDef)
+    {
+    }
+};
+
+class CompositorPassRmlUi : public Ogre::CompositorPass
+{
+public:
+    CompositorPassRmlUi(const CompositorPassRmlUiDef *definition, Ogre::CompositorNode *parentNode, const Ogre::RenderTargetViewDef *rtvDef, CompositorPassRmlUiProvider *provider);
+    void execute(const Ogre::Camera *lodCamera) override;
+protected:
+    CompositorPassRmlUiProvider *mProvider;
+};
+
+// registered with Ogre::CompositorManager2::setCompositorPassProvider() before any workspace using the pass is created
+//
+// the context can be set (or changed) at any time later, the pass does nothing while there is none
+class CompositorPassRmlUiProvider : public Ogre::CompositorPassProvider
+{
+public:
+    static Ogre::IdString getPassId() {return Ogre::IdString("rmlui");}
+
+    CompositorPassRmlUiProvider();
+    void setContext(Rml::Context *context, RenderInterface_Ogre *renderInterface);
+    Rml::Context * getContext() const {return mContext;}
+    RenderInterface_Ogre * getRenderInterface() const {return mRenderInterface;}
+    // CPU time spent rendering the context since the last call, so it can be told apart from the rest of the workspace
+    float takeRenderTime();
+    void _addRenderTime(float ms) {mRenderTimeMs += ms;}
+    // the pass records the two timestamps right before and after rendering the context (timer can be null)
+    void setGpuTimer(GpuTimer *timer, size_t beginTimestamp, size_t endTimestamp);
+    void _gpuTimestamp(bool end);
+
+    Ogre::CompositorPassDef * addPassDef(Ogre::CompositorPassType passType, Ogre::IdString customId, Ogre::CompositorTargetDef *parentTargetDef, Ogre::CompositorNodeDef *parentNodeDef) override;
+    Ogre::CompositorPass * addPass(const Ogre::CompositorPassDef *definition, Ogre::Camera *defaultCamera, Ogre::CompositorNode *parentNode, const Ogre::RenderTargetViewDef *rtvDef, Ogre::SceneManager *sceneManager) override;
+protected:
+    Rml::Context *mContext;
+    RenderInterface_Ogre *mRenderInterface;
+    float mRenderTimeMs;
+    GpuTimer *mGpuTimer;
+    size_t mGpuBeginTimestamp;
+    size_t mGpuEndTimestamp;
+};
+
+#endif // COMPOSITORPASSRMLUI_H
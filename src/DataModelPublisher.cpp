@@ -0,0 +1,88 @@
+#include "DataModelPublisher.h"
+
+#include <cmath>
+
+namespace GUI {
+
+// whether a and b look the same with the given number of decimals
+static bool sameWhenDisplayed(float a, float b, int decimals)
+{
+    const double scale = std::pow(10.0, decimals);
+    return std::llround(a * scale) == std::llround(b * scale);
+}
+
+DataModelPublisher::DataModelPublisher(Rml::DataModelHandle model, Clock::duration interval) :
+    mModel(model),
+    mInterval(interval),
+    mPublished(false),
+    mNumDirtied(0),
+    mNumSet(0)
+{
+}
+
+bool DataModelPublisher::isDue(Clock::time_point now)
+{
+    if (mPublished && now < mNextTime)
+        return false;
+    // NOTE: from now rather than from the previous due time, so a hitch doesn't cause a burst of updates
+    mPublished = true;
+    mNextTime = now + mInterval;
+    return true;
+}
+
+void DataModelPublisher::set(const Rml::String &name, float &variable, float value, int decimals)
+{
+    mNumSet++;
+    if (sameWhenDisplayed(variable, value, decimals))
+        return;
+    variable = value;
+    _Dirty(name);
+}
+
+void DataModelPublisher::set(const Rml::String &name, int &variable, int value)
+{
+    mNumSet++;
+    if (variable == value)
+        return;
+    variable = value;
+    _Dirty(name);
+}
+
+void DataModelPublisher::set(const Rml::String &name, bool &variable, bool value)
+{
+    mNumSet++;
+    if (variable == value)
+        return;
+    variable = value;
+    _Dirty(name);
+}
+
+void DataModelPublisher::set(const Rml::String &name, Rml::String &variable, const Rml::String &value)
+{
+    mNumSet++;
+    if (variable == value)
+        return;
+    variable = value;
+    _Dirty(name);
+}
+
+void DataModelPublisher::set(const Rml::String &name, Rml::Vector<float> &variable, const Rml::Vector<float> &value, int decimals)
+{
+    mNumSet++;
+    bool same = variable.size() == value.size();
+    for (size_t i = 0; same && i < value.size(); ++i)
+        same = sameWhenDisplayed(variable[i], value[i], decimals);
+    if (same)
+        return;
+    variable = value;
+    _Dirty(name);
+}
+
+void DataModelPublisher::_Dirty(const Rml::String &name)
+{
+    mNumDirtied++;
+    if (mModel)
+        mModel.DirtyVariable(name);
+}
+
+} // namespace GUI
@@ -0,0 +1,59 @@
+#ifndef DATAMODELPUBLISHER_H
+#define DATAMODELPUBLISHER_H
+
+#include <RmlUi/Core/DataModelHandle.h>
+#include <RmlUi/Core/Types.h>
+
+#include <chrono>
+
+namespace GUI {
+
+// publishes values to the variables bound in an RmlUi data model, at most once per interval, and only dirties the
+// variables whose displayed value changed (a dirty variable makes RmlUi update, and usually re-layout, every element
+// bound to it, DirtyAllVariables() does that for all of them)
+//
+// one per data model, e.g.:
+//     if (publisher.isDue(now))
+//     {
+//         publisher.set("fps", data.fps, fps, 3);
+//         publisher.set("drawCount", data.drawCount, drawCount);
+//     }
+class DataModelPublisher
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr Clock::duration DEFAULT_INTERVAL = std::chrono::milliseconds(250);
+
+    explicit DataModelPublisher(Rml::DataModelHandle model = Rml::DataModelHandle(), Clock::duration interval = DEFAULT_INTERVAL);
+    void setModel(Rml::DataModelHandle model) {mModel = model;}
+    Clock::duration getInterval() const {return mInterval;}
+    void setInterval(Clock::duration interval) {mInterval = interval;}
+    // whether it is time to publish again, the first call always is (NOTE: starts the next interval if so)
+    bool isDue(Clock::time_point now);
+
+    // these assign value to the bound variable and dirty it if it changed, floats are compared rounded to the
+    // number of decimals they are displayed with, so changes nobody can see are neither assigned nor dirtied
+    void set(const Rml::String &name, float &variable, float value, int decimals);
+    void set(const Rml::String &name, int &variable, int value);
+    void set(const Rml::String &name, bool &variable, bool value);
+    void set(const Rml::String &name, Rml::String &variable, const Rml::String &value);
+    void set(const Rml::String &name, Rml::Vector<float> &variable, const Rml::Vector<float> &value, int decimals);
+
+    // how many times a variable was dirtied, and how many times one was set, since the start
+    size_t getNumDirtied() const {return mNumDirtied;}
+    size_t getNumSet() const {return mNumSet;}
+protected:
+    void _Dirty(const Rml::String &name);
+protected:
+    Rml::DataModelHandle mModel;
+    Clock::duration mInterval;
+    Clock::time_point mNextTime;
+    bool mPublished;
+    size_t mNumDirtied;
+    size_t mNumSet;
+};
+
+} // namespace GUI
+
+#endif // DATAMODELPUBLISHER_H
@@ -0,0 +1,206 @@
+#include "DocumentCache.h"
+#include "ShellFileInterface.h"
+#include "Profiler.h"
+
+#include <RmlUi/Core/Context.h>
+#include <RmlUi/Core/ElementDocument.h>
+#include <RmlUi/Core/Factory.h>
+#include <RmlUi/Core/FileInterface.h>
+#include <RmlUi/Core/Core.h>
+
+#include <iostream>
+
+#include <sys/stat.h> // for stat()
+
+namespace GUI {
+
+// templates and style sheets can link to more of them, but not this deep unless they link in a circle
+static const int MAX_LINK_DEPTH = 16;
+
+static bool endsWith(const Rml::String &text, const char *suffix)
+{
+    const size_t length = std::char_traits<char>::length(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+static Rml::String removeComments(const Rml::String &source)
+{
+    Rml::String result;
+    size_t position = 0;
+    while (position < source.size())
+    {
+        const size_t start = source.find("<!--", position);
+        if (start == Rml::String::npos)
+            break;
+        result.append(source, position, start - position);
+        const size_t end = source.find("-->", start + 4);
+        position = end == Rml::String::npos ? source.size() : end + 3;
+    }
+    if (position < source.size())
+        result.append(source, position, Rml::String::npos);
+    return result;
+}
+
+DocumentCache::DocumentCache(const Rml::String &root) :
+    mRoot(root)
+{
+}
+
+bool DocumentCache::preload(const Rml::String &path)
+{
+    return _Read(ShellFileInterface::NormalizePath(path), true) != nullptr;
+}
+
+const Rml::String * DocumentCache::getSource(const Rml::String &path)
+{
+    const File * const file = _Read(ShellFileInterface::NormalizePath(path), true);
+    return file && file->hasSource ? &file->source : nullptr;
+}
+
+Rml::ElementDocument * DocumentCache::loadDocument(Rml::Context *context, const Rml::String &path)
+{
+    PROFILE_ZONE("DocumentCache::loadDocument");
+    const Rml::String * const source = getSource(path);
+    if (!source)
+    {
+        std::cerr << "error: could not read the document \"" << path << "\"" << std::endl;
+        return nullptr;
+    }
+    // NOTE: the path is still given, the links are relative to it
+    return context->LoadDocumentFromMemory(*source, ShellFileInterface::NormalizePath(path));
+}
+
+Rml::Vector<Rml::String> DocumentCache::takeStaleDocuments()
+{
+    Rml::Vector<Rml::String> changed;
+    for (const auto &entry : mFiles)
+    {
+        if (_GetModificationTime(entry.first) != entry.second.modificationTime)
+            changed.push_back(entry.first);
+    }
+    Rml::Vector<Rml::String> stale;
+    if (changed.empty())
+        return stale;
+
+    bool styleSheetsChanged = false, templatesChanged = false;
+    for (const Rml::String &path : changed)
+    {
+        const File &file = mFiles[path];
+        if (endsWith(path, ".rcss"))
+            styleSheetsChanged = true;
+        else if (!file.isDocument)
+            templatesChanged = true;
+    }
+    // NOTE: whatever links to a changed file is dropped as well (e.g. a template between a document and a style
+    // sheet), the stale documents are read again when they are loaded, along with whatever they link to by then
+    Rml::Vector<Rml::String> affected;
+    for (const auto &entry : mFiles)
+    {
+        for (const Rml::String &path : changed)
+        {
+            if (entry.first == path || _DependsOn(entry.first, path, 0))
+            {
+                affected.push_back(entry.first);
+                if (entry.second.isDocument)
+                    stale.push_back(entry.first);
+                break;
+            }
+        }
+    }
+    for (const Rml::String &path : affected)
+        mFiles.erase(path);
+    if (styleSheetsChanged)
+        Rml::Factory::ClearStyleSheetCache();
+    if (templatesChanged)
+        Rml::Factory::ClearTemplateCache();
+    return stale;
+}
+
+bool DocumentCache::isTracked(const Rml::String &path) const
+{
+    return mFiles.find(ShellFileInterface::NormalizePath(path)) != mFiles.end();
+}
+
+DocumentCache::File * DocumentCache::_Read(const Rml::String &path, bool isDocument)
+{
+    const auto it = mFiles.find(path);
+    if (it != mFiles.end())
+    {
+        if (!isDocument || it->second.hasSource)
+            return &it->second;
+        // NOTE: tracked as something a document links to so far
+        mFiles.erase(it);
+    }
+
+    File file;
+    file.modificationTime = _GetModificationTime(path);
+    file.isDocument = isDocument;
+    file.hasSource = false;
+    // style sheets are only tracked, RmlUi reads and compiles them itself when a document links to them
+    Rml::String source;
+    if (!endsWith(path, ".rcss"))
+    {
+        if (!Rml::GetFileInterface()->LoadFile(path, source))
+            return nullptr;
+    }
+    // NOTE: inserted before following the links, so a circle of links ends here
+    File &inserted = mFiles[path] = std::move(file);
+    _AddLinks(inserted, path, source);
+    if (isDocument)
+    {
+        inserted.source = std::move(source);
+        inserted.hasSource = true;
+    }
+    return &inserted;
+}
+
+void DocumentCache::_AddLinks(File &file, const Rml::String &path, const Rml::String &source)
+{
+    // the <link href="..."> tags, outside of comments, relative to the file's directory
+    const Rml::String text = removeComments(source);
+    const size_t slash = path.rfind('/');
+    const Rml::String directory = slash == Rml::String::npos ? Rml::String() : path.substr(0, slash + 1);
+    size_t position = 0;
+    while ((position = text.find("<link", position)) != Rml::String::npos)
+    {
+        const size_t end = text.find('>', position);
+        const Rml::String tag = text.substr(position, end == Rml::String::npos ? Rml::String::npos : end - position);
+        position = end == Rml::String::npos ? text.size() : end;
+        const size_t href = tag.find("href=");
+        if (href == Rml::String::npos || href + 5 >= tag.size())
+            continue;
+        const char quote = tag[href + 5];
+        const size_t valueEnd = tag.find(quote, href + 6);
+        if ((quote != '"' && quote != '\'') || valueEnd == Rml::String::npos)
+            continue;
+        file.links.push_back(ShellFileInterface::NormalizePath(directory + tag.substr(href + 6, valueEnd - href - 6)));
+    }
+    for (const Rml::String &link : file.links)
+    {
+        if (mFiles.find(link) == mFiles.end() && !_Read(link, false))
+            std::cerr << "warning: \"" << path << "\" links to \"" << link << "\", which can't be read" << std::endl;
+    }
+}
+
+bool DocumentCache::_DependsOn(const Rml::String &path, const Rml::String &changedPath, int depth) const
+{
+    const auto it = mFiles.find(path);
+    if (it == mFiles.end() || depth > MAX_LINK_DEPTH)
+        return false;
+    for (const Rml::String &link : it->second.links)
+    {
+        if (link == changedPath || _DependsOn(link, changedPath, depth + 1))
+            return true;
+    }
+    return false;
+}
+
+int64_t DocumentCache::_GetModificationTime(const Rml::String &path) const
+{
+    struct stat st;
+    if (stat((mRoot + path).c_str(), &st) != 0)
+        return 0;
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+} // namespace GUI
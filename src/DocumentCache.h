@@ -0,0 +1,59 @@
+#ifndef DOCUMENTCACHE_H
+#define DOCUMENTCACHE_H
+
+#include <RmlUi/Core/Types.h>
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace Rml {
+
+class Context;
+class ElementDocument;
+
+} // namespace Rml
+
+namespace GUI {
+
+// the RML documents, read once and parsed from memory after that, along with the templates and style sheets they
+// link to, which RmlUi compiles once and shares between every document linking them (by path)
+//
+// every file is remembered with its modification time: a file that changed since it was read is stale, which
+// drops it (and RmlUi's compiled style sheets and templates, if it was one of those) so it's read again next time
+// NOTE: paths are relative to the root the files are read from, like "data/ui.rml"
+class DocumentCache
+{
+public:
+    DocumentCache(const Rml::String &root);
+    // reads a document and finds what it links to (recursively), unless that was done already
+    bool preload(const Rml::String &path);
+    // the cached source of a document, nullptr if it can't be read
+    const Rml::String * getSource(const Rml::String &path);
+    // loads a document into context from its cached source
+    Rml::ElementDocument * loadDocument(Rml::Context *context, const Rml::String &path);
+    // the documents that have to be loaded again because they, or something they link to, changed on disk (their
+    // sources are dropped, and RmlUi's style sheet/template caches cleared, so loading them reads the new files)
+    Rml::Vector<Rml::String> takeStaleDocuments();
+    // whether path is a document or something one links to
+    bool isTracked(const Rml::String &path) const;
+protected:
+    struct File
+    {
+        int64_t modificationTime; // in nanoseconds, 0 if it couldn't be checked
+        bool isDocument;
+        bool hasSource; // only documents keep their source
+        Rml::String source;
+        Rml::Vector<Rml::String> links; // the files it links to
+    };
+    File * _Read(const Rml::String &path, bool isDocument);
+    void _AddLinks(File &file, const Rml::String &path, const Rml::String &source);
+    bool _DependsOn(const Rml::String &path, const Rml::String &changedPath, int depth) const;
+    int64_t _GetModificationTime(const Rml::String &path) const;
+protected:
+    Rml::String mRoot;
+    std::unordered_map<Rml::String, File> mFiles;
+};
+
+} // namespace GUI
+
+#endif // DOCUMENTCACHE_H
@@ -5,6 +5,7 @@
 #include "OgreMeshManager.h"
 #include "OgreCamera.h"
 #include "OgreConfigFile.h"
+#include "OgreException.h"
 #include "OgreRoot.h"
 #include "OgreWindow.h"
 #include "OgreEntity.h"
@@ -16,20 +17,98 @@
 // #include "OgreHlmsUnlitDatablock.h"
 
 #include "Compositor/OgreCompositorManager2.h"
+#include "Compositor/OgreCompositorWorkspace.h"
+#include "Compositor/OgreCompositorWorkspaceListener.h"
+#include "Compositor/OgreCompositorNodeDef.h"
+#include "Compositor/OgreCompositorWorkspaceDef.h"
+#include "Compositor/Pass/PassScene/OgreCompositorPassSceneDef.h"
 
 #include "OgreWindowEventUtilities.h"
+#include "OgreFrameListener.h"
 
 #include "SceneLoader.h"
+#include "GameSimulation.h"
+#include "CompositorPassRmlUi.h"
+#include "Profiler.h"
 
 #include <SDL.h>
 #include <SDL_syswm.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <string>
 #include <iostream>
+#include <thread>
 
 #include <unistd.h> // for getuid()
 #include <pwd.h> // for getpwuid()
 
+// how much of each frame may be spent creating GPU resources while a scene streams in
+static const double SCENE_UPLOAD_BUDGET_MS = 4.0;
+
+// optional settings for the demo, the command line takes precedence over them
+static const char SETTINGS_FILE[] = "../data/settings.cfg";
+
+// requested = 0 means it wasn't given on the command line
+static size_t getSceneManagerThreads(size_t requested)
+{
+    if (requested > 0)
+        return requested;
+    try
+    {
+        Ogre::ConfigFile cf;
+        cf.load(SETTINGS_FILE);
+        const int fromSettings = std::atoi(cf.getSetting("SceneManagerThreads", "", "0").c_str());
+        if (fromSettings > 0)
+            return static_cast<size_t>(fromSettings);
+    }
+    catch (const Ogre::Exception &)
+    {
+        // NOTE: the settings file is optional
+    }
+    // NOTE: hardware_concurrency() may return 0 if it can't tell
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// measures how long Ogre spends updating the scene graph (node transforms, bounds, ...) each frame, which is
+// the work spread over the SceneManager's worker threads; it runs between the frame being started and the
+// workspace being updated
+class SceneUpdateTimer : public Ogre::FrameListener, public Ogre::CompositorWorkspaceListener
+{
+public:
+    SceneUpdateTimer() : mMeasuring(false), mTotalMs(0.0), mFrames(0)
+    {
+    }
+    bool frameStarted(const Ogre::FrameEvent &evt) override
+    {
+        mFrameStart = std::chrono::steady_clock::now();
+        mMeasuring = true;
+        return true;
+    }
+    void workspacePreUpdate(Ogre::CompositorWorkspace *workspace) override
+    {
+        // NOTE: only the first workspace of the frame, the scene graph is updated once for all of them
+        if (!mMeasuring)
+            return;
+        mMeasuring = false;
+        mTotalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mFrameStart).count();
+        mFrames++;
+    }
+    float takeAverage()
+    {
+        const float average = mFrames ? static_cast<float>(mTotalMs / mFrames) : 0.0f;
+        mTotalMs = 0.0;
+        mFrames = 0;
+        return average;
+    }
+protected:
+    std::chrono::steady_clock::time_point mFrameStart;
+    bool mMeasuring;
+    double mTotalMs;
+    unsigned int mFrames;
+};
+
 static void registerHlms()
 {
     static const Ogre::String resourcePath = "";
@@ -105,18 +184,17 @@ static void registerHlms()
     }
 }
 
-FPSGame::FPSGame(SDL_Window *sdlWindow) :
+FPSGame::FPSGame(SDL_Window *sdlWindow, const FPSGameOptions &options) :
     mSDLWindow(sdlWindow),
     mWindow(nullptr),
     mSceneManager(nullptr),
     mCamera(nullptr),
     mCaptureMouse(true),
     mQuit(false),
-    mPitch(0.0),
-    mYaw(0.0),
-    mWASD({false, false, false, false}),
-    mArrows({false, false, false, false})
+    mScriptedCamera(false),
+    mSceneManagerThreads(getSceneManagerThreads(options.numThreads))
 {
+    PROFILE_ZONE("FPSGame::FPSGame");
 
     SDL_SysWMinfo wmInfo;
     SDL_VERSION(&wmInfo.version);
@@ -166,19 +244,39 @@ FPSGame::FPSGame(SDL_Window *sdlWindow) :
 
     registerHlms();
 
+    // NOTE: has to be registered before the workspace using the RmlUi pass is created in _CreateScene()
+    mRmlUiPassProvider = std::make_unique<CompositorPassRmlUiProvider>();
+    mRoot->getCompositorManager2()->setCompositorPassProvider(mRmlUiPassProvider.get());
+
     // Create SceneManager
-    static const size_t numThreads = 1u;
-    mSceneManager = mRoot->createSceneManager(Ogre::ST_GENERIC, numThreads, "ExampleSMInstance");
+    // NOTE: the worker threads do the culling and the node / bounding box updates
+    std::cout << "SceneManager worker threads: " << mSceneManagerThreads << std::endl;
+    mSceneManager = mRoot->createSceneManager(Ogre::ST_GENERIC, mSceneManagerThreads, "ExampleSMInstance");
     mSceneManager->setForward3D(true, 4, 4, 3, 128, 3.0f, 2000.0f); // TODO figure out what values to use!
     // mSceneManager->setAmbientLight(Ogre::ColourValue::Black, Ogre::ColourValue::Black, Ogre::Vector3::UNIT_Y);
     // mSceneManager->setLightPowerScale(1.0f); // Default is 1.0, try lowering to 0.01–1.0
 
-    _CreateScene();
+    _CreateScene(options.scenePath);
     _UpdateMouseCaptured();
+
+    // the game logic starts from wherever _CreateScene() put the camera
+    GameState initialState;
+    initialState.position = mCamera->getPosition();
+    mSimulation = std::make_unique<GameSimulation>(initialState, options.tickRate);
+    if (options.simulationThread)
+        mSimulation->start();
+    _ApplyGameState(initialState);
 }
 
 FPSGame::~FPSGame()
 {
+    if (mRoot && mSceneUpdateTimer)
+        mRoot->removeFrameListener(mSceneUpdateTimer.get());
+}
+
+float FPSGame::takeSceneUpdateTime()
+{
+    return mSceneUpdateTimer ? mSceneUpdateTimer->takeAverage() : 0.0f;
 }
 
 // TODO look at https://github.com/OGRECave/ogre-next/blob/master/Samples/2.0/Common/src/GraphicsSystem.cpp#L439
@@ -193,15 +291,15 @@ void FPSGame::handleEvent(const SDL_Event &event)
             mQuit = true;
             break;
 
-            case SDL_KeyCode::SDLK_w: mWASD[0] = true; break;
-            case SDL_KeyCode::SDLK_a: mWASD[1] = true; break;
-            case SDL_KeyCode::SDLK_s: mWASD[2] = true; break;
-            case SDL_KeyCode::SDLK_d: mWASD[3] = true; break;
+            case SDL_KeyCode::SDLK_w: mSimulation->setKey(KEY_FORWARD, true); break;
+            case SDL_KeyCode::SDLK_a: mSimulation->setKey(KEY_LEFT, true); break;
+            case SDL_KeyCode::SDLK_s: mSimulation->setKey(KEY_BACK, true); break;
+            case SDL_KeyCode::SDLK_d: mSimulation->setKey(KEY_RIGHT, true); break;
 
-            case SDL_KeyCode::SDLK_UP:    mArrows[0] = true; break;
-            case SDL_KeyCode::SDLK_LEFT:  mArrows[1] = true; break;
-            case SDL_KeyCode::SDLK_DOWN:  mArrows[2] = true; break;
-            case SDL_KeyCode::SDLK_RIGHT: mArrows[3] = true; break;
+            case SDL_KeyCode::SDLK_UP:    mSimulation->setKey(KEY_LOOK_UP, true); break;
+            case SDL_KeyCode::SDLK_LEFT:  mSimulation->setKey(KEY_LOOK_LEFT, true); break;
+            case SDL_KeyCode::SDLK_DOWN:  mSimulation->setKey(KEY_LOOK_DOWN, true); break;
+            case SDL_KeyCode::SDLK_RIGHT: mSimulation->setKey(KEY_LOOK_RIGHT, true); break;
 
             case SDL_KeyCode::SDLK_RETURN:
             {
@@ -226,15 +324,15 @@ void FPSGame::handleEvent(const SDL_Event &event)
     {
         switch (event.key.keysym.sym)
         {
-            case SDL_KeyCode::SDLK_w: mWASD[0] = false; break;
-            case SDL_KeyCode::SDLK_a: mWASD[1] = false; break;
-            case SDL_KeyCode::SDLK_s: mWASD[2] = false; break;
-            case SDL_KeyCode::SDLK_d: mWASD[3] = false; break;
-
-            case SDL_KeyCode::SDLK_UP:    mArrows[0] = false; break;
-            case SDL_KeyCode::SDLK_LEFT:  mArrows[1] = false; break;
-            case SDL_KeyCode::SDLK_DOWN:  mArrows[2] = false; break;
-            case SDL_KeyCode::SDLK_RIGHT: mArrows[3] = false; break;
+            case SDL_KeyCode::SDLK_w: mSimulation->setKey(KEY_FORWARD, false); break;
+            case SDL_KeyCode::SDLK_a: mSimulation->setKey(KEY_LEFT, false); break;
+            case SDL_KeyCode::SDLK_s: mSimulation->setKey(KEY_BACK, false); break;
+            case SDL_KeyCode::SDLK_d: mSimulation->setKey(KEY_RIGHT, false); break;
+
+            case SDL_KeyCode::SDLK_UP:    mSimulation->setKey(KEY_LOOK_UP, false); break;
+            case SDL_KeyCode::SDLK_LEFT:  mSimulation->setKey(KEY_LOOK_LEFT, false); break;
+            case SDL_KeyCode::SDLK_DOWN:  mSimulation->setKey(KEY_LOOK_DOWN, false); break;
+            case SDL_KeyCode::SDLK_RIGHT: mSimulation->setKey(KEY_LOOK_RIGHT, false); break;
         }
     }
     else if (event.type == SDL_MOUSEBUTTONDOWN)
@@ -249,10 +347,7 @@ void FPSGame::handleEvent(const SDL_Event &event)
     {
         if (mCaptureMouse)
         {
-            mYaw -= event.motion.xrel * 0.1f;
-            mPitch -= event.motion.yrel * 0.1f;
-            mPitch = std::clamp(mPitch, -89.0f, 89.0f);
-            _UpdateCameraRotation();
+            mSimulation->addLook(-event.motion.xrel * 0.1f, -event.motion.yrel * 0.1f);
         }
     }
     else if (event.type == SDL_QUIT)
@@ -302,46 +397,39 @@ void FPSGame::handleEvent(const SDL_Event &event)
     }
 }
 
-void FPSGame::advance(float seconds_elapsed)
+void FPSGame::advance()
 {
-    // handle walking
-    {
-        Ogre::Vector3 move(Ogre::Vector3::ZERO);
-        if (mWASD[0]) move.z -= 1;
-        if (mWASD[1]) move.x -= 1;
-        if (mWASD[2]) move.z += 1;
-        if (mWASD[3]) move.x += 1;
+    advance(GameSimulation::Clock::now());
+}
 
-        if (move != Ogre::Vector3::ZERO)
-        {
-            move.normalise();
-            static const float METERS_PER_SECOND = 25.0;
-            const Ogre::Vector3 dir = mCamera->getOrientation() * move;
-            mCamera->setPosition(mCamera->getPosition() + dir * METERS_PER_SECOND * seconds_elapsed);
-        }
-    }
+void FPSGame::advance(std::chrono::steady_clock::time_point now)
+{
+    PROFILE_ZONE("FPSGame::advance");
+    if (mSceneLoad)
+        mSceneLoad->update(SCENE_UPLOAD_BUDGET_MS);
+
+    // NOTE: the walking and looking around happens in GameSimulation, here it is only shown
+    mSimulation->update(now);
+    if (!mScriptedCamera)
+        _ApplyGameState(mSimulation->getInterpolatedState(now));
+}
 
-    // handle looking
-    {
-        static const float DEGREES_PER_SECOND = 50.0f;
-        float up_down = 0.0;
-        float left_right = 0.0;
-        if (mArrows[0])
-            up_down -= 1.0;
-        if (mArrows[2])
-            up_down += 1.0;
-        if (mArrows[1])
-            left_right -= 1.0;
-        if (mArrows[3])
-            left_right += 1.0;
-        if (up_down != 0.0 || left_right != 0.0)
-        {
-            mYaw -= left_right * DEGREES_PER_SECOND * seconds_elapsed;
-            mPitch -= up_down * DEGREES_PER_SECOND * seconds_elapsed;
-            mPitch = std::clamp(mPitch, -89.0f, 89.0f);
-            _UpdateCameraRotation();
-        }
-    }
+void FPSGame::restartClock(std::chrono::steady_clock::time_point now)
+{
+    mSimulation->restartClock(now);
+    if (!mScriptedCamera)
+        _ApplyGameState(mSimulation->getInterpolatedState(now));
+}
+
+GameState FPSGame::getCameraState() const
+{
+    return mSimulation->getInterpolatedState(GameSimulation::Clock::now());
+}
+
+void FPSGame::setCameraState(const GameState &state)
+{
+    mScriptedCamera = true;
+    _ApplyGameState(state);
 }
 
 void FPSGame::draw()
@@ -366,20 +454,20 @@ void FPSGame::_UpdateMouseCaptured()
     }
 }
 
-void FPSGame::_UpdateCameraRotation()
+void FPSGame::_ApplyGameState(const GameState &state)
 {
-    const Ogre::Quaternion qPitch(Ogre::Degree(mPitch), Ogre::Vector3::UNIT_X);
-    const Ogre::Quaternion qYaw(Ogre::Degree(mYaw), Ogre::Vector3::UNIT_Y);
+    const Ogre::Quaternion qPitch(Ogre::Degree(state.pitch), Ogre::Vector3::UNIT_X);
+    const Ogre::Quaternion qYaw(Ogre::Degree(state.yaw), Ogre::Vector3::UNIT_Y);
+    mCamera->setPosition(state.position);
     mCamera->setOrientation(qYaw * qPitch);
 }
 
-void FPSGame::_CreateScene()
+void FPSGame::_CreateScene(const std::string &scenePath)
 {
     // Create & setup camera
     mCamera = mSceneManager->createCamera("Main Camera");
     mCamera->setPosition(Ogre::Vector3(0, 5, 15)); // Position it at 500 in Z direction (? 500 ?)
     // mCamera->lookAt(Ogre::Vector3(0, 0, 0)); // Look back along -Z
-    _UpdateCameraRotation();
     mCamera->setNearClipDistance(0.2f);
     mCamera->setFarClipDistance(1000.0f);
     mCamera->setAutoAspectRatio(true);
@@ -387,9 +475,28 @@ void FPSGame::_CreateScene()
     // Setup a basic compositor with a blue clear colour
     Ogre::CompositorManager2 * const compositorManager = mRoot->getCompositorManager2();
     static const Ogre::String workspaceName("Demo Workspace");
+    static const Ogre::String nodeName("Demo Node");
     static const Ogre::ColourValue backgroundColour(0.2f, 0.4f, 0.6f);
-    compositorManager->createBasicWorkspaceDef(workspaceName, backgroundColour, Ogre::IdString());
-    compositorManager->addWorkspace(mSceneManager, mWindow->getTexture(), mCamera, workspaceName, true);
+    // NOTE: the same as createBasicWorkspaceDef(), plus the pass that draws RmlUi on top of the scene (it does nothing with ENABLE_RMLUI_CONTEXT)
+    {
+        Ogre::CompositorNodeDef * const nodeDef = compositorManager->addNodeDefinition(nodeName);
+        nodeDef->addTextureSourceName("WindowRT", 0, Ogre::TextureDefinitionBase::TEXTURE_INPUT);
+        nodeDef->setNumTargetPass(1);
+        Ogre::CompositorTargetDef * const targetDef = nodeDef->addTargetPass("WindowRT");
+        targetDef->setNumPasses(2);
+        Ogre::CompositorPassSceneDef * const sceneDef = static_cast<Ogre::CompositorPassSceneDef *>(targetDef->addPass(Ogre::PASS_SCENE));
+        sceneDef->setAllClearColours(backgroundColour);
+        sceneDef->setAllLoadActions(Ogre::LoadAction::Clear);
+        targetDef->addPass(Ogre::PASS_CUSTOM, CompositorPassRmlUiProvider::getPassId());
+
+        Ogre::CompositorWorkspaceDef * const workspaceDef = compositorManager->addWorkspaceDefinition(workspaceName);
+        workspaceDef->connectExternal(0, nodeName, 0);
+    }
+    Ogre::CompositorWorkspace * const workspace = compositorManager->addWorkspace(mSceneManager, mWindow->getTexture(), mCamera, workspaceName, true);
+
+    mSceneUpdateTimer = std::make_unique<SceneUpdateTimer>();
+    mRoot->addFrameListener(mSceneUpdateTimer.get());
+    workspace->addListener(mSceneUpdateTimer.get());
 
 #if 0
     // Ogre::HlmsUnlit * const hlmsUnlit = static_cast<Ogre::HlmsUnlit *>(mRoot->getHlmsManager()->getHlms(Ogre::HLMS_UNLIT));
@@ -471,5 +578,26 @@ void FPSGame::_CreateScene()
     lightNode->setPosition(10, 10, 10);
 #endif
 
-    loadSceneWithAssimp("../data/test_scene.glb", mSceneManager, mSceneManager->getRootSceneNode());
+    _LoadScene(scenePath);
+}
+
+void FPSGame::reloadScene()
+{
+    PROFILE_ZONE("FPSGame::reloadScene");
+    if (mSceneLoad)
+        mSceneLoad->destroyScene();
+    mSceneLoad.reset();
+    _LoadScene(mScenePath);
+}
+
+void FPSGame::_LoadScene(const std::string &scenePath)
+{
+    mScenePath = scenePath;
+    SceneLoadOptions options;
+    options.vertexCompression = VertexCompression::Compact;
+    options.instancing = true;
+    // NOTE: the level never moves, set mergeStaticMeshes too for fewer draw calls at the cost of instancing
+    options.staticGeometry = true;
+    options.generateLods = true;
+    mSceneLoad = std::make_unique<AsyncSceneLoad>(scenePath, mSceneManager, mSceneManager->getRootSceneNode(), options);
 }
@@ -1,8 +1,9 @@
 #ifndef FPSGAME_H
 #define FPSGAME_H
 
-#include <array>
+#include <chrono>
 #include <memory>
+#include <string>
 
 namespace Ogre {
 
@@ -13,25 +14,56 @@ class Camera;
 
 } // namespace Ogre
 
+class AsyncSceneLoad;
+class GameSimulation;
+struct GameState;
+class CompositorPassRmlUiProvider;
+class SceneUpdateTimer;
+
 // forward declaration to avoid including <SDL.h>
 typedef struct SDL_Window SDL_Window;
 typedef union SDL_Event SDL_Event;
 
+struct FPSGameOptions
+{
+    std::string scenePath;
+    size_t numThreads = 0; // the SceneManager's worker threads, 0 reads it from the settings file (or uses one per hardware thread)
+    bool simulationThread = false; // run the game logic on its own thread, instead of ticking it in advance()
+    double tickRate = 60.0; // game logic ticks per second
+};
+
 class FPSGame
 {
 public:
-    FPSGame(SDL_Window *sdlWindow);
+    FPSGame(SDL_Window *sdlWindow, const FPSGameOptions &options);
     ~FPSGame();
     Ogre::Window * getWindow() {return mWindow;}
     void handleEvent(const SDL_Event &event);
-    void advance(float seconds_elapsed);
+    void advance();
+    // advances to a given time instead of the current one, e.g. replaying recorded frame deltas
+    void advance(std::chrono::steady_clock::time_point now);
+    // makes now the start of the game logic's timeline, see GameSimulation::restartClock()
+    void restartClock(std::chrono::steady_clock::time_point now);
     void draw();
     bool getQuit() const { return mQuit; }
+    const AsyncSceneLoad * getSceneLoad() const { return mSceneLoad.get(); }
+    // destroys the loaded scene and loads it again (in the background like at startup), e.g. after its file changed
+    void reloadScene();
+    CompositorPassRmlUiProvider * getRmlUiPassProvider() { return mRmlUiPassProvider.get(); }
+    size_t getSceneManagerThreads() const { return mSceneManagerThreads; }
+    // average time Ogre spent updating the scene graph per frame, since the previous call (in milliseconds)
+    float takeSceneUpdateTime();
+    // where the game logic has the camera right now
+    GameState getCameraState() const;
+    // puts the camera somewhere else and stops it from following the game logic (e.g. for Benchmark's flythrough)
+    void setCameraState(const GameState &state);
 protected:
     void _UpdateMouseCaptured();
-    void _UpdateCameraRotation();
-    void _CreateScene();
+    void _ApplyGameState(const GameState &state);
+    void _CreateScene(const std::string &scenePath);
+    void _LoadScene(const std::string &scenePath);
 protected:
+    std::unique_ptr<CompositorPassRmlUiProvider> mRmlUiPassProvider; // NOTE: declared before mRoot so it outlives the compositor
     std::unique_ptr<Ogre::Root> mRoot;
     SDL_Window *mSDLWindow;
     Ogre::Window *mWindow;
@@ -39,9 +71,12 @@ protected:
     Ogre::Camera *mCamera;
     bool mCaptureMouse;
     bool mQuit;
-    float mPitch, mYaw;
-    std::array<bool, 4> mWASD;
-    std::array<bool, 4> mArrows;
+    bool mScriptedCamera;
+    size_t mSceneManagerThreads;
+    std::string mScenePath;
+    std::unique_ptr<SceneUpdateTimer> mSceneUpdateTimer;
+    std::unique_ptr<GameSimulation> mSimulation;
+    std::unique_ptr<AsyncSceneLoad> mSceneLoad; // NOTE: declared after mRoot so it is destroyed first
 };
 
 #endif // FPSGAME_H
@@ -0,0 +1,153 @@
+#include "FileWatcher.h"
+#include "Profiler.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <dirent.h> // for opendir()
+#include <poll.h> // for poll()
+#include <sys/eventfd.h> // for eventfd()
+#include <sys/inotify.h> // for inotify_init1()
+#include <unistd.h> // for read(), write() and close()
+
+// NOTE: IN_CLOSE_WRITE rather than IN_MODIFY, which is sent for every write() while the file is being saved
+static const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_ONLYDIR;
+
+FileWatcher::FileWatcher(Clock::duration debounce) :
+    mDebounce(debounce),
+    mInotifyFd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+    mWakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    if (mInotifyFd < 0 || mWakeFd < 0)
+    {
+        std::cerr << "warning: could not start watching files for changes: " << std::strerror(errno) << std::endl;
+        return;
+    }
+    mThread = std::thread(&FileWatcher::_ThreadMain, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+    if (mThread.joinable())
+    {
+        const uint64_t one = 1;
+        if (write(mWakeFd, &one, sizeof(one)) != sizeof(one))
+            std::cerr << "warning: could not wake the file watcher thread" << std::endl;
+        mThread.join();
+    }
+    if (mInotifyFd >= 0)
+        close(mInotifyFd);
+    if (mWakeFd >= 0)
+        close(mWakeFd);
+}
+
+bool FileWatcher::addDirectory(const std::string &path)
+{
+    if (mInotifyFd < 0)
+        return false;
+    std::lock_guard<std::mutex> lock(mMutex);
+    return _AddWatch(path);
+}
+
+std::vector<std::string> FileWatcher::takeChanges(Clock::time_point now)
+{
+    std::vector<std::string> changes;
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto it = mPending.begin(); it != mPending.end();)
+    {
+        if (now - it->second < mDebounce)
+        {
+            ++it;
+            continue;
+        }
+        changes.push_back(it->first);
+        it = mPending.erase(it);
+    }
+    return changes;
+}
+
+// NOTE: mMutex has to be locked
+bool FileWatcher::_AddWatch(const std::string &path)
+{
+    const int wd = inotify_add_watch(mInotifyFd, path.c_str(), WATCH_MASK);
+    if (wd < 0)
+    {
+        std::cerr << "warning: could not watch \"" << path << "\" for changes: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    mDirectories[wd] = path;
+
+    DIR * const dir = opendir(path.c_str());
+    if (!dir)
+        return true;
+    while (const dirent * const entry = readdir(dir))
+    {
+        if (entry->d_type == DT_DIR && std::strcmp(entry->d_name, ".") != 0 && std::strcmp(entry->d_name, "..") != 0)
+            _AddWatch(path + "/" + entry->d_name);
+    }
+    closedir(dir);
+    return true;
+}
+
+void FileWatcher::_ThreadMain()
+{
+    Profiler::setThreadName("File Watcher");
+    pollfd fds[2] = {{mInotifyFd, POLLIN, 0}, {mWakeFd, POLLIN, 0}};
+    while (true)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "warning: stopped watching files for changes: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (fds[1].revents)
+            break;
+        if (fds[0].revents & POLLIN)
+            _ReadEvents();
+    }
+}
+
+void FileWatcher::_ReadEvents()
+{
+    PROFILE_ZONE("FileWatcher::_ReadEvents");
+    alignas(inotify_event) char buffer[16 * 1024];
+    while (true)
+    {
+        const ssize_t length = read(mInotifyFd, buffer, sizeof(buffer));
+        if (length <= 0)
+            break; // EAGAIN, everything was read
+        const Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const inotify_event * const event = reinterpret_cast<const inotify_event *>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                std::cerr << "warning: the file watcher missed some changes, there were too many at once" << std::endl;
+                continue;
+            }
+            if (event->mask & IN_IGNORED)
+            {
+                mDirectories.erase(event->wd); // the directory was deleted
+                continue;
+            }
+            const auto it = mDirectories.find(event->wd);
+            if (it == mDirectories.end() || event->len == 0)
+                continue;
+            const std::string path = it->second + "/" + event->name;
+            if (event->mask & IN_ISDIR)
+            {
+                // NOTE: whatever is written into a new directory before it is watched is missed
+                if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                    _AddWatch(path);
+                continue;
+            }
+            mPending[path] = now;
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// watches directories (recursively) for files being written, created, moved in or deleted, using inotify on its own
+// thread, so the main thread only has to ask for the changes once per frame, e.g. to hot reload them
+//
+// the changes are debounced: a file is only reported once nothing happened to it for a while, editors tend to
+// write a file in several steps (or write a temporary file and move it over the original)
+// NOTE: Linux only, without inotify nothing is ever reported
+class FileWatcher
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr Clock::duration DEFAULT_DEBOUNCE = std::chrono::milliseconds(200);
+
+    explicit FileWatcher(Clock::duration debounce = DEFAULT_DEBOUNCE);
+    ~FileWatcher();
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher & operator=(const FileWatcher &) = delete;
+
+    // watches a directory and everything below it (including directories created later on)
+    bool addDirectory(const std::string &path);
+    // the files that changed and then stayed the same for the debounce time, as the watched path + "/" + the
+    // file's path below it (NOTE: each change is only returned once)
+    std::vector<std::string> takeChanges(Clock::time_point now);
+protected:
+    bool _AddWatch(const std::string &path);
+    void _ThreadMain();
+    void _ReadEvents();
+protected:
+    Clock::duration mDebounce;
+    int mInotifyFd;
+    int mWakeFd; // an eventfd, to make the thread stop waiting for events when quitting
+    std::thread mThread;
+    std::mutex mMutex;
+    std::unordered_map<int, std::string> mDirectories; // by watch descriptor
+    std::map<std::string, Clock::time_point> mPending; // the time of the last event for each changed file
+};
+
+#endif // FILEWATCHER_H
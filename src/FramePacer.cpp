@@ -0,0 +1,164 @@
+#include "FramePacer.h"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+// bounds for the adaptive spin threshold of the limiter
+static const std::chrono::microseconds MIN_SPIN_THRESHOLD(200);
+static const std::chrono::microseconds MAX_SPIN_THRESHOLD(4000);
+
+const char * FramePacer::getModeName(Mode mode)
+{
+    switch (mode)
+    {
+        case Mode::VSync: return "vsync";
+        case Mode::AdaptiveVSync: return "adaptive";
+        case Mode::Limited: return "limit";
+        case Mode::Uncapped: return "uncapped";
+    }
+    return "";
+}
+
+bool FramePacer::parseMode(const std::string &name, Mode &mode)
+{
+    for (const Mode candidate : {Mode::VSync, Mode::AdaptiveVSync, Mode::Limited, Mode::Uncapped})
+    {
+        if (name == getModeName(candidate))
+        {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+FramePacer::FramePacer(SDL_Window *window, Mode mode, double targetFps) :
+    mWindow(window),
+    mMode(mode),
+    mTargetFps(std::max(targetFps, 1.0)),
+    mSwapIntervalDirty(true),
+    mAdaptiveVSyncSupported(true),
+    mNextFrameStart(Clock::now()),
+    mSpinThreshold(std::chrono::milliseconds(1)),
+    mHasPresented(false),
+    mIntervalsMs(),
+    mNumIntervals(0),
+    mNextInterval(0)
+{
+}
+
+void FramePacer::setMode(Mode mode)
+{
+    if (mode == mMode)
+        return;
+    mMode = mode;
+    mSwapIntervalDirty = true;
+    mNextFrameStart = Clock::now();
+    std::cout << "Frame pacing: " << getModeName(mode) << std::endl;
+}
+
+void FramePacer::setTargetFps(double fps)
+{
+    mTargetFps = std::max(fps, 1.0);
+}
+
+void FramePacer::waitForNextFrame()
+{
+    if (mMode != Mode::Limited)
+        return;
+
+    const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / mTargetFps));
+    const Clock::time_point now = Clock::now();
+    // NOTE: after a slow frame just start from now, trying to catch up would only produce a burst of frames
+    if (mNextFrameStart + period < now)
+        mNextFrameStart = now;
+
+    // sleep for most of the wait, the OS wakes us up late by a varying amount so the rest is spent spinning
+    for (;;)
+    {
+        const Clock::time_point beforeSleep = Clock::now();
+        const Clock::duration remaining = mNextFrameStart - beforeSleep;
+        if (remaining <= mSpinThreshold)
+            break;
+        const Clock::duration sleepTime = remaining - mSpinThreshold;
+        std::this_thread::sleep_for(sleepTime);
+        // the threshold follows how late the sleeps end, with some margin
+        const Clock::duration overslept = Clock::now() - beforeSleep - sleepTime;
+        const Clock::duration target = std::clamp<Clock::duration>(overslept * 2, MIN_SPIN_THRESHOLD, MAX_SPIN_THRESHOLD);
+        mSpinThreshold = (mSpinThreshold * 7 + target) / 8;
+    }
+    while (Clock::now() < mNextFrameStart)
+        std::this_thread::yield();
+
+    mNextFrameStart += period;
+}
+
+void FramePacer::present()
+{
+    if (mSwapIntervalDirty)
+    {
+        _ApplySwapInterval();
+        mSwapIntervalDirty = false;
+    }
+
+    SDL_GL_SwapWindow(mWindow);
+
+    const Clock::time_point now = Clock::now();
+    if (mHasPresented)
+    {
+        mIntervalsMs[mNextInterval] = std::chrono::duration<float, std::milli>(now - mLastPresent).count();
+        mNextInterval = (mNextInterval + 1) % PRESENT_HISTORY;
+        mNumIntervals = std::min(mNumIntervals + 1, PRESENT_HISTORY);
+    }
+    mLastPresent = now;
+    mHasPresented = true;
+}
+
+FramePacer::PresentStats FramePacer::getPresentStats() const
+{
+    PresentStats stats;
+    stats.adaptiveVSyncSupported = mAdaptiveVSyncSupported;
+    if (mNumIntervals == 0)
+        return stats;
+    double sum = 0.0;
+    for (size_t i = 0; i < mNumIntervals; ++i)
+        sum += mIntervalsMs[i];
+    const double average = sum / mNumIntervals;
+    double variance = 0.0;
+    for (size_t i = 0; i < mNumIntervals; ++i)
+        variance += (mIntervalsMs[i] - average) * (mIntervalsMs[i] - average);
+    variance /= mNumIntervals;
+    stats.averageIntervalMs = static_cast<float>(average);
+    stats.jitterMs = static_cast<float>(std::sqrt(variance));
+    stats.fps = average > 0.0 ? static_cast<float>(1000.0 / average) : 0.0f;
+    return stats;
+}
+
+void FramePacer::_ApplySwapInterval()
+{
+    int interval = 0;
+    switch (mMode)
+    {
+        case Mode::VSync: interval = 1; break;
+        case Mode::AdaptiveVSync: interval = -1; break;
+        case Mode::Limited: interval = 0; break;
+        case Mode::Uncapped: interval = 0; break;
+    }
+    if (SDL_GL_SetSwapInterval(interval) == 0)
+        return;
+    if (interval == -1)
+    {
+        // NOTE: needs EXT_swap_control_tear (or the GLX/WGL equivalent)
+        std::cerr << "warning: adaptive vsync isn't supported (" << SDL_GetError() << "), using vsync instead" << std::endl;
+        mAdaptiveVSyncSupported = false;
+        SDL_GL_SetSwapInterval(1);
+    }
+    else
+    {
+        std::cerr << "warning: SDL_GL_SetSwapInterval(" << interval << ") failed: " << SDL_GetError() << std::endl;
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <array>
+#include <chrono>
+#include <string>
+
+// forward declaration to avoid including <SDL.h>
+typedef struct SDL_Window SDL_Window;
+
+// decides when frames start and get presented, and measures the time between presents
+//
+// the limiter waits at the *start* of a frame (before input is read) rather than before the swap, so the frame
+// it delays hasn't been rendered yet and capping the frame rate doesn't add input latency
+class FramePacer
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    enum class Mode
+    {
+        VSync, // swap interval 1
+        AdaptiveVSync, // swap interval -1: waits for vblank, unless the frame is already late (falls back to VSync if unsupported)
+        Limited, // no vsync, frames are started at the target FPS with a hybrid sleep/spin wait
+        Uncapped, // no vsync, no waiting
+    };
+    // the names used on the command line and in the GUI: "vsync", "adaptive", "limit" and "uncapped"
+    static const char * getModeName(Mode mode);
+    static bool parseMode(const std::string &name, Mode &mode);
+
+    struct PresentStats
+    {
+        float averageIntervalMs = 0.0f; // present to present
+        float jitterMs = 0.0f; // standard deviation of the intervals
+        float fps = 0.0f;
+        bool adaptiveVSyncSupported = true;
+    };
+
+    FramePacer(SDL_Window *window, Mode mode = Mode::VSync, double targetFps = 60.0);
+    Mode getMode() const {return mMode;}
+    void setMode(Mode mode);
+    double getTargetFps() const {return mTargetFps;}
+    void setTargetFps(double fps);
+
+    // call at the very start of a frame, only waits in Mode::Limited
+    void waitForNextFrame();
+    // swaps the window of the current GL context, and records when it happened
+    void present();
+    // over the last PRESENT_HISTORY presents
+    PresentStats getPresentStats() const;
+protected:
+    void _ApplySwapInterval();
+protected:
+    static const size_t PRESENT_HISTORY = 120;
+
+    SDL_Window *mWindow;
+    Mode mMode;
+    double mTargetFps;
+    bool mSwapIntervalDirty; // NOTE: applied right before swapping, so it hits the context that actually swaps
+    bool mAdaptiveVSyncSupported;
+    // limiter
+    Clock::time_point mNextFrameStart;
+    Clock::duration mSpinThreshold; // sleeps end this early, the rest is spent spinning
+    // present intervals, in a ring
+    Clock::time_point mLastPresent;
+    bool mHasPresented;
+    std::array<float, PRESENT_HISTORY> mIntervalsMs;
+    size_t mNumIntervals;
+    size_t mNextInterval;
+};
+
+#endif // FRAMEPACER_H
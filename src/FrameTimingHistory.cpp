@@ -0,0 +1,147 @@
+#include "FrameTimingHistory.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const float HISTOGRAM_MIN_MS = 0.1f;
+static const float HISTOGRAM_MAX_MS = 1000.0f;
+// how quickly the average that stutters are compared to follows the frame time
+static const float RECENT_AVERAGE_WEIGHT = 0.05f;
+
+static void getValues(const FrameTiming &timing, float values[6])
+{
+    values[0] = timing.inputMs;
+    values[1] = timing.simulationMs;
+    values[2] = timing.ogreMs;
+    values[3] = timing.rmluiMs;
+    values[4] = timing.swapMs;
+    values[5] = timing.totalMs;
+}
+
+FrameTimingHistory::FrameTimingHistory() :
+    mWriteCount(0)
+{
+    reset();
+}
+
+void FrameTimingHistory::reset()
+{
+    // NOTE: only the statistics, copyLatest() still returns the old frames
+    mStutters.fill(false);
+    mHistogram.fill(0);
+    mFrames = 0;
+    mStutterCount = 0;
+    mTotalStutters = 0;
+    std::fill(std::begin(mSums), std::end(mSums), 0.0);
+    mRecentAverageMs = 0.0f;
+}
+
+void FrameTimingHistory::push(const FrameTiming &timing)
+{
+    const uint64_t writeCount = mWriteCount.load(std::memory_order_relaxed);
+    const size_t slot = writeCount % CAPACITY;
+    float values[6];
+
+    // the frame that gets overwritten leaves the statistics
+    if (mFrames == CAPACITY)
+    {
+        const FrameTiming &old = mTimings[slot];
+        getValues(old, values);
+        for (int i = 0; i < 6; ++i)
+            mSums[i] -= values[i];
+        mHistogram[_GetBin(old.totalMs)]--;
+        if (mStutters[slot])
+            mStutterCount--;
+        mFrames--;
+    }
+
+    const bool stutter = mRecentAverageMs > 0.0f && timing.totalMs > mRecentAverageMs * STUTTER_FACTOR;
+    mRecentAverageMs = mRecentAverageMs > 0.0f ? mRecentAverageMs + (timing.totalMs - mRecentAverageMs) * RECENT_AVERAGE_WEIGHT : timing.totalMs;
+
+    getValues(timing, values);
+    for (int i = 0; i < 6; ++i)
+        mSums[i] += values[i];
+    mHistogram[_GetBin(timing.totalMs)]++;
+    mStutters[slot] = stutter;
+    if (stutter)
+    {
+        mStutterCount++;
+        mTotalStutters++;
+    }
+    mFrames++;
+
+    mTimings[slot] = timing;
+    // NOTE: publishes the slot to copyLatest()
+    mWriteCount.store(writeCount + 1, std::memory_order_release);
+}
+
+FrameTimingSummary FrameTimingHistory::getSummary() const
+{
+    FrameTimingSummary summary;
+    summary.frames = mFrames;
+    summary.stutters = mStutterCount;
+    summary.totalStutters = mTotalStutters;
+    if (mFrames == 0)
+        return summary;
+    summary.p50Ms = _GetPercentile(0.5);
+    summary.p95Ms = _GetPercentile(0.95);
+    summary.p99Ms = _GetPercentile(0.99);
+    summary.p999Ms = _GetPercentile(0.999);
+    summary.average.inputMs = static_cast<float>(mSums[0] / mFrames);
+    summary.average.simulationMs = static_cast<float>(mSums[1] / mFrames);
+    summary.average.ogreMs = static_cast<float>(mSums[2] / mFrames);
+    summary.average.rmluiMs = static_cast<float>(mSums[3] / mFrames);
+    summary.average.swapMs = static_cast<float>(mSums[4] / mFrames);
+    summary.average.totalMs = static_cast<float>(mSums[5] / mFrames);
+    return summary;
+}
+
+size_t FrameTimingHistory::copyLatest(FrameTiming *out, size_t count) const
+{
+    const uint64_t end = mWriteCount.load(std::memory_order_acquire);
+    const uint64_t available = std::min<uint64_t>(end, CAPACITY);
+    count = static_cast<size_t>(std::min<uint64_t>(count, available));
+    uint64_t begin = end - count;
+    for (uint64_t i = begin; i < end; ++i)
+        out[i - begin] = mTimings[i % CAPACITY];
+
+    // the writer may have lapped us while copying, drop whatever it could have overwritten (including the slot it
+    // may be writing right now)
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t after = mWriteCount.load(std::memory_order_relaxed);
+    const uint64_t firstValid = after + 1 > CAPACITY ? after + 1 - CAPACITY : 0;
+    if (firstValid > begin)
+    {
+        const size_t dropped = static_cast<size_t>(std::min<uint64_t>(firstValid - begin, count));
+        std::copy(out + dropped, out + count, out);
+        count -= dropped;
+    }
+    return count;
+}
+
+int FrameTimingHistory::_GetBin(float ms)
+{
+    if (!(ms > HISTOGRAM_MIN_MS))
+        return 0;
+    const float position = std::log(ms / HISTOGRAM_MIN_MS) / std::log(HISTOGRAM_MAX_MS / HISTOGRAM_MIN_MS);
+    return std::clamp(static_cast<int>(position * HISTOGRAM_BINS), 0, HISTOGRAM_BINS - 1);
+}
+
+float FrameTimingHistory::_GetBinValue(int bin)
+{
+    // NOTE: the geometric middle of the bin, so the error is at most half a bin (about 1%)
+    return HISTOGRAM_MIN_MS * std::pow(HISTOGRAM_MAX_MS / HISTOGRAM_MIN_MS, (bin + 0.5f) / HISTOGRAM_BINS);
+}
+
+float FrameTimingHistory::_GetPercentile(double fraction) const
+{
+    const size_t rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(fraction * mFrames)));
+    size_t seen = 0;
+    for (int bin = 0; bin < HISTOGRAM_BINS; ++bin)
+    {
+        seen += mHistogram[bin];
+        if (seen >= rank)
+            return _GetBinValue(bin);
+    }
+    return HISTOGRAM_MAX_MS;
+}
@@ -0,0 +1,68 @@
+#ifndef FRAMETIMINGHISTORY_H
+#define FRAMETIMINGHISTORY_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// CPU time spent in each phase of one frame of the main loop, in milliseconds
+struct FrameTiming
+{
+    float inputMs = 0.0f; // polling and handling SDL events, and --hot-reload reloading what changed
+    float simulationMs = 0.0f; // FPSGame::advance()
+    float ogreMs = 0.0f; // FPSGame::draw(), minus the RmlUi pass
+    float rmluiMs = 0.0f; // updating and rendering the GUI
+    float swapMs = 0.0f; // presenting
+    float totalMs = 0.0f; // the whole frame, not counting the frame limiter's wait
+};
+
+// statistics over the frames currently in the history
+struct FrameTimingSummary
+{
+    size_t frames = 0;
+    float p50Ms = 0.0f;
+    float p95Ms = 0.0f;
+    float p99Ms = 0.0f;
+    float p999Ms = 0.0f;
+    size_t stutters = 0; // frames taking more than STUTTER_FACTOR times the recent average
+    uint64_t totalStutters = 0; // since the start (or the last reset)
+    FrameTiming average;
+};
+
+// fixed-capacity ring of the latest frame timings
+//
+// push() and getSummary() must be called from one thread (the main loop), copyLatest() can be called from any
+// thread without locking; the percentiles come from a histogram of the frames in the ring, which is updated as
+// frames enter and leave it, so nothing is ever sorted
+class FrameTimingHistory
+{
+public:
+    static constexpr size_t CAPACITY = 2048;
+    static constexpr float STUTTER_FACTOR = 2.0f;
+
+    FrameTimingHistory();
+    void push(const FrameTiming &timing);
+    void reset();
+    FrameTimingSummary getSummary() const;
+    // copies up to count of the most recent timings (oldest first) and returns how many were copied
+    size_t copyLatest(FrameTiming *out, size_t count) const;
+protected:
+    static constexpr int HISTOGRAM_BINS = 512; // logarithmic, from HISTOGRAM_MIN_MS to HISTOGRAM_MAX_MS
+    static int _GetBin(float ms);
+    static float _GetBinValue(int bin);
+    float _GetPercentile(double fraction) const;
+protected:
+    std::array<FrameTiming, CAPACITY> mTimings;
+    std::atomic<uint64_t> mWriteCount; // NOTE: the number of frames ever pushed, the next one goes to mWriteCount % CAPACITY
+    // only touched by the writer
+    std::array<bool, CAPACITY> mStutters;
+    std::array<uint32_t, HISTOGRAM_BINS> mHistogram;
+    size_t mFrames;
+    size_t mStutterCount;
+    uint64_t mTotalStutters;
+    double mSums[6]; // NOTE: in FrameTiming's order
+    float mRecentAverageMs; // exponential moving average of totalMs, for detecting stutters
+};
+
+#endif // FRAMETIMINGHISTORY_H
@@ -1,5 +1,6 @@
 #include "GUI.h"
 #include "ShellFileInterface.h"
+#include "Profiler.h"
 
 #include <SDL.h>
 #include <SDL_opengl.h>
@@ -8,70 +9,108 @@
 #include <RmlUi/Debugger.h>
 
 #include <RmlUi_Platform_SDL.h>
+#ifdef ENABLE_RMLUI_CONTEXT
 #include <RmlUi_Renderer_GL3.h>
+#else
+#include "RenderInterface_Ogre.h"
+#endif // ENABLE_RMLUI_CONTEXT
 
+#include <algorithm>
 #include <iostream>
 
 namespace GUI {
 
-GUI::GUI(SDL_Window *window) :
+// the UI files are relative to this, i.e. the project directory when running from a build directory
+static const char DATA_ROOT[] = "../";
+static const char FRAME_STATS_DOCUMENT[] = "data/frame_stats.rml";
+static const char MAIN_MENU_DOCUMENT[] = "data/ui.rml";
+
+GUI::GUI(SDL_Window *window, const Rml::String &uiPack, const Rml::String &glyphCache) :
     mQuit(false),
     mWindow(window),
     mSystemInterface(nullptr),
+    mFileInterface(nullptr),
     mRenderInterface(nullptr),
     mContext(nullptr),
+    _documentCache(DATA_ROOT),
+    _glyphSetCache(glyphCache),
+    _glyphWarmupDocument(nullptr),
+    _glyphWarmupUpdates(0),
     _frameStatsDocument(nullptr),
-    _mainMenuDocument(nullptr)
+    _mainMenuDocument(nullptr),
+    _frameStatsDocumentPath(ShellFileInterface::NormalizePath(FRAME_STATS_DOCUMENT)),
+    _mainMenuDocumentPath(ShellFileInterface::NormalizePath(MAIN_MENU_DOCUMENT))
 {
+    PROFILE_ZONE("GUI::GUI");
     // SDL_GL_MakeCurrent(window, ceguiContext);
     int w = 0, h = 0;
     SDL_GetWindowSize(window, &w, &h);
     // std::cout << "Window size: " << w << "x" << h << std::endl;
 
+#ifdef ENABLE_RMLUI_CONTEXT
     RmlGL3::Initialize();
+#endif // ENABLE_RMLUI_CONTEXT
     SystemInterface_SDL * const sdlInterface = new SystemInterface_SDL();
     mSystemInterface = sdlInterface;
     sdlInterface->SetWindow(window);
+#ifdef ENABLE_RMLUI_CONTEXT
     RenderInterface_GL3 * const renderInterface = new RenderInterface_GL3();
+#else
+    RenderInterface_Ogre * const renderInterface = new RenderInterface_Ogre();
+#endif // ENABLE_RMLUI_CONTEXT
     mRenderInterface = renderInterface;
     renderInterface->SetViewport(w, h);
 
     Rml::SetSystemInterface(mSystemInterface);
     Rml::SetRenderInterface(mRenderInterface);
-    Rml::SetFileInterface(new ShellFileInterface("../"));
+    mFileInterface = new ShellFileInterface(DATA_ROOT, uiPack);
+    Rml::SetFileInterface(mFileInterface);
     Rml::Initialise();
     mContext = Rml::CreateContext("main", Rml::Vector2i(w, h));
     Rml::Debugger::Initialise(mContext);
     // Rml::Debugger::SetVisible(true);
 
-    Rml::LoadFontFace("assets/LatoLatin-Regular.ttf");
+    // NOTE: from the pack the font is used where it is mapped, instead of being read into a copy
+    const Rml::byte *fontData = nullptr;
+    size_t fontSize = 0;
+    if (mFileInterface->GetView("assets/LatoLatin-Regular.ttf", fontData, fontSize))
+        Rml::LoadFontFace(Rml::Span<const Rml::byte>(fontData, fontSize), "LatoLatin", Rml::Style::FontStyle::Normal);
+    else
+        Rml::LoadFontFace("assets/LatoLatin-Regular.ttf");
     
+    // NOTE: a model that can't be created is left out (its publisher does nothing), the documents are still loaded
+    _CreateFrameStatModel();
+    _CreateSceneLoadModel();
+    _CreateFramePacingModel();
+
+    // NOTE: the glyphs (and font effects) of the previous run are rasterized in the first frame, along with the
+    // documents', rather than whenever some text first needs them
+    if (_glyphSetCache.load())
     {
-        Rml::DataModelConstructor constructor = mContext->CreateDataModel("frame_stats");
-        if (!constructor)
-            return; // TODO handle error
-
-        constructor.Bind("fps", &_frameStatData.fps);
-        constructor.Bind("avgTime", &_frameStatData.avgTime);
-        constructor.Bind("bestTime", &_frameStatData.bestTime);
-        constructor.Bind("worstTime", &_frameStatData.worstTime);
-        constructor.Bind("faceCount", &_frameStatData.faceCount);
-        constructor.Bind("vertexCount", &_frameStatData.vertexCount);
-
-        _frameStatModel = constructor.GetModelHandle();
+        _glyphWarmupDocument = _glyphSetCache.loadWarmupDocument(mContext);
+        std::cout << "Warming up " << _glyphSetCache.getNumGlyphSets() << " glyph sets from \"" << glyphCache << "\"" << std::endl;
     }
 
     // TODO handle errors
-    _frameStatsDocument = mContext->LoadDocument("data/frame_stats.rml");
-    _mainMenuDocument = mContext->LoadDocument("data/ui.rml");
+    _frameStatsDocument = _documentCache.loadDocument(mContext, _frameStatsDocumentPath);
+    _mainMenuDocument = _documentCache.loadDocument(mContext, _mainMenuDocumentPath);
     if (_frameStatsDocument)
         _frameStatsDocument->Show();
+    else
+        _failedReloads.push_back(_frameStatsDocumentPath);
     if (_mainMenuDocument)
         _mainMenuDocument->Show();
+    else
+        _failedReloads.push_back(_mainMenuDocumentPath);
 }
 
 GUI::~GUI()
 {
+    if (_glyphSetCache.isEnabled())
+    {
+        _glyphSetCache.collect(mContext);
+        _glyphSetCache.save();
+    }
     Rml::RemoveContext(mContext->GetName()); // NOTE: not really necessary, Rml::Shutdown() will take care of it anyways
     Rml::Shutdown();
     // if (mContext)
@@ -80,10 +119,19 @@ GUI::~GUI()
         delete mRenderInterface;
     if (mSystemInterface)
         delete mSystemInterface;
+    if (mFileInterface)
+        delete mFileInterface; // NOTE: after Rml::Shutdown(), the font may still point into its pack
 }
 
 void GUI::advance(float seconds_elapsed)
 {
+    PROFILE_ZONE("GUI::advance");
+    // NOTE: drawn after the first update, so it can go in the second one
+    if (_glyphWarmupDocument && ++_glyphWarmupUpdates > 1)
+    {
+        _glyphWarmupDocument->Close();
+        _glyphWarmupDocument = nullptr;
+    }
     mContext->Update();
 }
 
@@ -111,9 +159,144 @@ void GUI::handleEvent(const SDL_Event &event)
 
 void GUI::draw()
 {
+    PROFILE_ZONE("GUI::draw");
+#ifdef ENABLE_RMLUI_CONTEXT
     mRenderInterface->BeginFrame();
     mContext->Render();
     mRenderInterface->EndFrame();
+#endif // ENABLE_RMLUI_CONTEXT
+    // NOTE: otherwise the context is rendered by the compositor, as part of FPSGame::draw()
+}
+
+Rml::Vector<Rml::String> GUI::reloadStaleDocuments()
+{
+    PROFILE_ZONE("GUI::reloadStaleDocuments");
+    Rml::Vector<Rml::String> stale = _documentCache.takeStaleDocuments();
+    // NOTE: a document that couldn't be read is no longer tracked by the cache, so whatever change made this get
+    // called might be the one fixing it
+    for (const Rml::String &path : _failedReloads)
+    {
+        if (std::find(stale.begin(), stale.end(), path) == stale.end())
+            stale.push_back(path);
+    }
+    _failedReloads.clear();
+    Rml::Vector<Rml::String> reloaded;
+    for (const Rml::String &path : stale)
+    {
+        Rml::ElementDocument ** const document =
+            path == _frameStatsDocumentPath ? &_frameStatsDocument :
+            path == _mainMenuDocumentPath ? &_mainMenuDocument : nullptr;
+        if (!document)
+            continue;
+        if (Rml::ElementDocument * const reloadedDocument = _ReloadDocument(*document, path))
+        {
+            *document = reloadedDocument;
+            reloaded.push_back(path);
+        }
+        else
+        {
+            _failedReloads.push_back(path);
+        }
+    }
+    return reloaded;
+}
+
+// NOTE: the old document (if any) is only closed once the new one is loaded, and nullptr is returned otherwise
+Rml::ElementDocument * GUI::_ReloadDocument(Rml::ElementDocument *document, const Rml::String &path)
+{
+    Rml::ElementDocument * const reloaded = _documentCache.loadDocument(mContext, path);
+    if (!reloaded)
+    {
+        std::cerr << "warning: kept the previous \"" << path << "\", it is loaded again after the next change" << std::endl;
+        return nullptr;
+    }
+    if (!document || document->IsVisible())
+        reloaded->Show();
+    if (document)
+        document->Close(); // NOTE: RmlUi only destroys it during the next update
+    return reloaded;
+}
+
+void GUI::_CreateFrameStatModel()
+{
+    Rml::DataModelConstructor constructor = mContext->CreateDataModel("frame_stats");
+    if (!constructor)
+    {
+        std::cerr << "error: could not create the \"frame_stats\" data model" << std::endl;
+        return;
+    }
+
+    constructor.Bind("fps", &_frameStatData.fps);
+    constructor.Bind("avgTime", &_frameStatData.avgTime);
+    constructor.Bind("bestTime", &_frameStatData.bestTime);
+    constructor.Bind("worstTime", &_frameStatData.worstTime);
+    constructor.Bind("faceCount", &_frameStatData.faceCount);
+    constructor.Bind("vertexCount", &_frameStatData.vertexCount);
+    constructor.Bind("drawCount", &_frameStatData.drawCount);
+    constructor.Bind("batchCount", &_frameStatData.batchCount);
+    constructor.Bind("sceneUpdateTime", &_frameStatData.sceneUpdateTime);
+    constructor.Bind("sceneThreads", &_frameStatData.sceneThreads);
+    constructor.Bind("p50Time", &_frameStatData.p50Time);
+    constructor.Bind("p95Time", &_frameStatData.p95Time);
+    constructor.Bind("p99Time", &_frameStatData.p99Time);
+    constructor.Bind("p999Time", &_frameStatData.p999Time);
+    constructor.Bind("stutters", &_frameStatData.stutters);
+    constructor.Bind("totalStutters", &_frameStatData.totalStutters);
+    constructor.Bind("inputTime", &_frameStatData.inputTime);
+    constructor.Bind("simulationTime", &_frameStatData.simulationTime);
+    constructor.Bind("ogreTime", &_frameStatData.ogreTime);
+    constructor.Bind("rmluiTime", &_frameStatData.rmluiTime);
+    constructor.Bind("swapTime", &_frameStatData.swapTime);
+    constructor.Bind("gpuSupported", &_frameStatData.gpuSupported);
+    constructor.Bind("gpuOgreTime", &_frameStatData.gpuOgreTime);
+    constructor.Bind("gpuRmlUiTime", &_frameStatData.gpuRmlUiTime);
+    // NOTE: only the graph is left out if the array type can't be registered
+    if (constructor.RegisterArray<Rml::Vector<float>>())
+        constructor.Bind("graph", &_frameStatData.graph);
+    else
+        std::cerr << "error: could not register the frame time graph's array type" << std::endl;
+
+    _frameStatModel = constructor.GetModelHandle();
+}
+
+void GUI::_CreateSceneLoadModel()
+{
+    Rml::DataModelConstructor constructor = mContext->CreateDataModel("scene_load");
+    if (!constructor)
+    {
+        std::cerr << "error: could not create the \"scene_load\" data model" << std::endl;
+        return;
+    }
+
+    constructor.Bind("loading", &_sceneLoadData.loading);
+    constructor.Bind("progress", &_sceneLoadData.progress);
+    constructor.Bind("status", &_sceneLoadData.status);
+    constructor.Bind("loadTime", &_sceneLoadData.loadTime);
+    constructor.Bind("datablocks", &_sceneLoadData.datablocks);
+    constructor.Bind("datablocksSaved", &_sceneLoadData.datablocksSaved);
+    constructor.Bind("items", &_sceneLoadData.items);
+    constructor.Bind("itemsBeforeMerge", &_sceneLoadData.itemsBeforeMerge);
+    constructor.Bind("staticItems", &_sceneLoadData.staticItems);
+
+    _sceneLoadModel = constructor.GetModelHandle();
+}
+
+void GUI::_CreateFramePacingModel()
+{
+    Rml::DataModelConstructor constructor = mContext->CreateDataModel("frame_pacing");
+    if (!constructor)
+    {
+        std::cerr << "error: could not create the \"frame_pacing\" data model" << std::endl;
+        return;
+    }
+
+    constructor.Bind("mode", &_framePacingData.mode);
+    constructor.Bind("targetFps", &_framePacingData.targetFps);
+    constructor.Bind("presentInterval", &_framePacingData.presentInterval);
+    constructor.Bind("presentJitter", &_framePacingData.presentJitter);
+    constructor.Bind("adaptiveSupported", &_framePacingData.adaptiveSupported);
+
+    _framePacingModel = constructor.GetModelHandle();
 }
 
 void GUI::toggleDebug()
@@ -1,7 +1,11 @@
 #ifndef GUI_H
 #define GUI_H
 
+#include "DocumentCache.h"
+#include "GlyphSetCache.h"
+
 #include <RmlUi/Core/DataModelHandle.h>
+#include <RmlUi/Core/Types.h>
 
 // forward declaration to avoid including <SDL.h>
 typedef struct SDL_Window SDL_Window;
@@ -15,10 +19,19 @@ class ElementDocument;
 
 } // namespace Rml
 
+class ShellFileInterface;
+
+#ifdef ENABLE_RMLUI_CONTEXT
 class RenderInterface_GL3;
+#else
+class RenderInterface_Ogre;
+#endif // ENABLE_RMLUI_CONTEXT
 
 namespace GUI {
 
+// the frame time graph goes from 0 to this many ms (NOTE: also written in data/frame_stats.rml)
+static const float GRAPH_MAX_TIME = 50.0f;
+
 struct FrameStatData
 {
 	float fps = 0.0;
@@ -27,36 +40,121 @@ struct FrameStatData
     float worstTime = 0.0;
     int faceCount = 0;
     int vertexCount = 0;
+    int drawCount = 0;
+    int batchCount = 0;
+    float sceneUpdateTime = 0.0; // per frame, averaged since the last update of the panel
+    int sceneThreads = 0;
+    // from FrameTimingHistory, over its last CAPACITY frames
+    float p50Time = 0.0;
+    float p95Time = 0.0;
+    float p99Time = 0.0;
+    float p999Time = 0.0;
+    int stutters = 0;
+    int totalStutters = 0;
+    float inputTime = 0.0; // the average of each phase of the main loop
+    float simulationTime = 0.0;
+    float ogreTime = 0.0;
+    float rmluiTime = 0.0;
+    float swapTime = 0.0;
+    Rml::Vector<float> graph; // the latest frame times, as a percentage of GRAPH_MAX_TIME
+    // GPU time from GpuTimer, per frame, averaged since the last update of the panel
+    bool gpuSupported = false;
+    float gpuOgreTime = 0.0;
+    float gpuRmlUiTime = 0.0;
+};
+
+struct SceneLoadData
+{
+    bool loading = false;
+    float progress = 0.0; // 0.0 to 1.0
+    Rml::String status;
+    float loadTime = 0.0;
+    int datablocks = 0;
+    int datablocksSaved = 0;
+    int items = 0;
+    int itemsBeforeMerge = 0;
+    int staticItems = 0;
+};
+
+// NOTE: mode and targetFps are changed by the user through the GUI, the rest is measured by FramePacer
+struct FramePacingData
+{
+    Rml::String mode; // one of FramePacer's mode names
+    int targetFps = 60;
+    float presentInterval = 0.0; // ms
+    float presentJitter = 0.0; // ms
+    bool adaptiveSupported = true;
 };
 
 class GUI
 {
 public:
-    GUI(SDL_Window *window);
+    // uiPack is a pack of the UI files (see tools/pack_ui_files.py) relative to the data root, empty reads them from disk
+    // glyphCache is where the glyph sets drawn are remembered (and warmed up from at startup), empty doesn't
+    GUI(SDL_Window *window, const Rml::String &uiPack = Rml::String(), const Rml::String &glyphCache = Rml::String());
     ~GUI();
     void advance(float seconds_elapsed);
     void handleEvent(const SDL_Event &event);
     void draw();
     bool getQuit() const {return mQuit;}
     void toggleDebug();
+    Rml::Context * getContext() {return mContext;}
+#ifndef ENABLE_RMLUI_CONTEXT
+    RenderInterface_Ogre * getRenderInterface() {return mRenderInterface;}
+#endif // ENABLE_RMLUI_CONTEXT
     FrameStatData & getFrameStatData() {return _frameStatData;}
     const FrameStatData & getFrameStatData() const {return _frameStatData;}
     Rml::DataModelHandle getFrameStatModel() {return _frameStatModel;}
     const Rml::DataModelHandle getFrameStatModel() const {return _frameStatModel;}
+    SceneLoadData & getSceneLoadData() {return _sceneLoadData;}
+    const SceneLoadData & getSceneLoadData() const {return _sceneLoadData;}
+    Rml::DataModelHandle getSceneLoadModel() {return _sceneLoadModel;}
+    const Rml::DataModelHandle getSceneLoadModel() const {return _sceneLoadModel;}
+    FramePacingData & getFramePacingData() {return _framePacingData;}
+    const FramePacingData & getFramePacingData() const {return _framePacingData;}
+    Rml::DataModelHandle getFramePacingModel() {return _framePacingModel;}
+    const Rml::DataModelHandle getFramePacingModel() const {return _framePacingModel;}
     Rml::ElementDocument * getMainMenuDocument() {return _mainMenuDocument;}
     const Rml::ElementDocument * getMainMenuDocument() const {return _mainMenuDocument;}
     Rml::ElementDocument * getFrameStatsDocument() {return _frameStatsDocument;}
     const Rml::ElementDocument * getFrameStatsDocument() const {return _frameStatsDocument;}
+    DocumentCache & getDocumentCache() {return _documentCache;}
+    // loads the documents whose files (or the files they link to) changed on disk again, returns the paths of the
+    // ones that were reloaded; a document that can't be loaded keeps the old one, and is tried again on the next call
+    // NOTE: the reloaded documents are new elements, whatever was attached to the old ones has to be attached again
+    Rml::Vector<Rml::String> reloadStaleDocuments();
+protected:
+    void _CreateFrameStatModel();
+    void _CreateSceneLoadModel();
+    void _CreateFramePacingModel();
+    Rml::ElementDocument * _ReloadDocument(Rml::ElementDocument *document, const Rml::String &path);
 protected:
     bool mQuit;
     SDL_Window *mWindow;
     Rml::SystemInterface *mSystemInterface;
+    ShellFileInterface *mFileInterface;
+#ifdef ENABLE_RMLUI_CONTEXT
     RenderInterface_GL3 *mRenderInterface;
+#else
+    RenderInterface_Ogre *mRenderInterface; // NOTE: draws through Ogre, see CompositorPassRmlUi
+#endif // ENABLE_RMLUI_CONTEXT
     Rml::Context *mContext;
+    DocumentCache _documentCache;
+    GlyphSetCache _glyphSetCache;
+    Rml::ElementDocument *_glyphWarmupDocument; // closed once it was drawn
+    int _glyphWarmupUpdates;
     FrameStatData _frameStatData;
     Rml::DataModelHandle _frameStatModel;
+    SceneLoadData _sceneLoadData;
+    Rml::DataModelHandle _sceneLoadModel;
+    FramePacingData _framePacingData;
+    Rml::DataModelHandle _framePacingModel;
     Rml::ElementDocument *_frameStatsDocument;
     Rml::ElementDocument *_mainMenuDocument;
+    // NOTE: the documents are reloaded by path, they might not exist (yet) if they couldn't be loaded
+    Rml::String _frameStatsDocumentPath;
+    Rml::String _mainMenuDocumentPath;
+    Rml::Vector<Rml::String> _failedReloads; // to try again
 };
 
 } // namespace GUI
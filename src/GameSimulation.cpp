@@ -0,0 +1,208 @@
+#include "GameSimulation.h"
+#include "Profiler.h"
+
+#include <OgreQuaternion.h>
+
+#include <algorithm>
+
+static const float METERS_PER_SECOND = 25.0f;
+static const float DEGREES_PER_SECOND = 50.0f; // looking around with the arrow keys
+// after a hitch longer than this many ticks the simulation skips ahead instead of trying to catch up
+static const int MAX_CATCH_UP_TICKS = 10;
+
+GameState interpolate(const GameState &a, const GameState &b, float t)
+{
+    GameState result;
+    result.position = a.position + (b.position - a.position) * t;
+    result.pitch = a.pitch + (b.pitch - a.pitch) * t;
+    result.yaw = a.yaw + (b.yaw - a.yaw) * t;
+    return result;
+}
+
+GameSimulation::GameSimulation(const GameState &initialState, double tickRate) :
+    mTickRate(tickRate),
+    mTickDuration(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / tickRate))),
+    mState(initialState),
+    mTick(0),
+    mNextTickTime(Clock::now() + mTickDuration),
+    mInput({{}, 0.0f, 0.0f}),
+    mStopping(false)
+{
+    std::shared_ptr<GameSnapshot> snapshot = std::make_shared<GameSnapshot>();
+    snapshot->tick = mTick;
+    snapshot->time = mNextTickTime - mTickDuration;
+    snapshot->state = mState;
+    mLatestSnapshot = std::move(snapshot);
+}
+
+GameSimulation::~GameSimulation()
+{
+    stop();
+}
+
+void GameSimulation::start()
+{
+    if (mThread.joinable())
+        return;
+    mStopping = false;
+    mNextTickTime = Clock::now() + mTickDuration;
+    mThread = std::thread(&GameSimulation::_ThreadMain, this);
+}
+
+void GameSimulation::stop()
+{
+    if (!mThread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mWakeMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+    mThread.join();
+}
+
+void GameSimulation::setKey(GameKey key, bool down)
+{
+    std::lock_guard<std::mutex> lock(mInputMutex);
+    mInput.keys[key] = down;
+}
+
+void GameSimulation::addLook(float yawDegrees, float pitchDegrees)
+{
+    // NOTE: accumulated until the next tick consumes it
+    std::lock_guard<std::mutex> lock(mInputMutex);
+    mInput.lookYaw += yawDegrees;
+    mInput.lookPitch += pitchDegrees;
+}
+
+void GameSimulation::update(Clock::time_point now)
+{
+    if (!mThread.joinable())
+        _RunTicks(now);
+}
+
+void GameSimulation::restartClock(Clock::time_point now)
+{
+    if (mThread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mInputMutex);
+        mInput = {{}, 0.0f, 0.0f};
+    }
+    mNextTickTime = now + mTickDuration;
+    std::shared_ptr<GameSnapshot> snapshot = std::make_shared<GameSnapshot>();
+    snapshot->tick = mTick;
+    snapshot->time = now;
+    snapshot->state = mState;
+    std::lock_guard<std::mutex> lock(mSnapshotMutex);
+    mPreviousSnapshot.reset();
+    mLatestSnapshot = std::move(snapshot);
+}
+
+std::shared_ptr<const GameSnapshot> GameSimulation::getLatestSnapshot() const
+{
+    std::lock_guard<std::mutex> lock(mSnapshotMutex);
+    return mLatestSnapshot;
+}
+
+GameState GameSimulation::getInterpolatedState(Clock::time_point now) const
+{
+    std::shared_ptr<const GameSnapshot> previous, latest;
+    {
+        std::lock_guard<std::mutex> lock(mSnapshotMutex);
+        previous = mPreviousSnapshot;
+        latest = mLatestSnapshot;
+    }
+    if (!previous)
+        return latest->state;
+    // NOTE: clamped, so a late tick holds the latest state instead of extrapolating past it
+    const float t = static_cast<float>(std::chrono::duration<double>(now - latest->time) / std::chrono::duration<double>(mTickDuration));
+    return interpolate(previous->state, latest->state, std::clamp(t, 0.0f, 1.0f));
+}
+
+void GameSimulation::_Tick(GameState &state, const Input &input, double seconds)
+{
+    // looking, with the mouse and the arrow keys
+    {
+        float up_down = 0.0f;
+        float left_right = 0.0f;
+        if (input.keys[KEY_LOOK_UP])
+            up_down -= 1.0f;
+        if (input.keys[KEY_LOOK_DOWN])
+            up_down += 1.0f;
+        if (input.keys[KEY_LOOK_LEFT])
+            left_right -= 1.0f;
+        if (input.keys[KEY_LOOK_RIGHT])
+            left_right += 1.0f;
+        state.yaw += input.lookYaw - left_right * DEGREES_PER_SECOND * static_cast<float>(seconds);
+        state.pitch += input.lookPitch - up_down * DEGREES_PER_SECOND * static_cast<float>(seconds);
+        state.pitch = std::clamp(state.pitch, -89.0f, 89.0f);
+    }
+
+    // walking
+    {
+        Ogre::Vector3 move(Ogre::Vector3::ZERO);
+        if (input.keys[KEY_FORWARD]) move.z -= 1;
+        if (input.keys[KEY_LEFT]) move.x -= 1;
+        if (input.keys[KEY_BACK]) move.z += 1;
+        if (input.keys[KEY_RIGHT]) move.x += 1;
+
+        if (move != Ogre::Vector3::ZERO)
+        {
+            move.normalise();
+            const Ogre::Quaternion qPitch(Ogre::Degree(state.pitch), Ogre::Vector3::UNIT_X);
+            const Ogre::Quaternion qYaw(Ogre::Degree(state.yaw), Ogre::Vector3::UNIT_Y);
+            const Ogre::Vector3 dir = (qYaw * qPitch) * move;
+            state.position += dir * METERS_PER_SECOND * static_cast<float>(seconds);
+        }
+    }
+}
+
+void GameSimulation::_RunTicks(Clock::time_point now)
+{
+    const double tickSeconds = 1.0 / mTickRate;
+    for (int ticks = 0; mNextTickTime <= now; ++ticks)
+    {
+        if (ticks == MAX_CATCH_UP_TICKS)
+        {
+            mNextTickTime = now + mTickDuration;
+            break;
+        }
+
+        Input input;
+        {
+            std::lock_guard<std::mutex> lock(mInputMutex);
+            input = mInput;
+            mInput.lookYaw = 0.0f;
+            mInput.lookPitch = 0.0f;
+        }
+        PROFILE_ZONE("GameSimulation tick");
+        _Tick(mState, input, tickSeconds);
+        mTick++;
+
+        std::shared_ptr<GameSnapshot> snapshot = std::make_shared<GameSnapshot>();
+        snapshot->tick = mTick;
+        snapshot->time = mNextTickTime;
+        snapshot->state = mState;
+        {
+            std::lock_guard<std::mutex> lock(mSnapshotMutex);
+            mPreviousSnapshot = std::move(mLatestSnapshot);
+            mLatestSnapshot = std::move(snapshot);
+        }
+        mNextTickTime += mTickDuration;
+    }
+}
+
+void GameSimulation::_ThreadMain()
+{
+    Profiler::setThreadName("Simulation");
+    std::unique_lock<std::mutex> lock(mWakeMutex);
+    while (!mStopping)
+    {
+        lock.unlock();
+        _RunTicks(Clock::now());
+        lock.lock();
+        // NOTE: waits for the next tick on a steady clock, not a fixed sleep, so the ticks don't drift
+        mWake.wait_until(lock, mNextTickTime, [this]() {return mStopping;});
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef GAMESIMULATION_H
+#define GAMESIMULATION_H
+
+#include <OgreVector3.h>
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// everything the game logic owns, the renderer only ever gets copies of it
+struct GameState
+{
+    Ogre::Vector3 position = Ogre::Vector3::ZERO;
+    float pitch = 0.0f; // degrees
+    float yaw = 0.0f; // degrees
+};
+
+// linear interpolation between two states, t = 0 gives a and t = 1 gives b
+GameState interpolate(const GameState &a, const GameState &b, float t);
+
+// published after every tick and never modified afterwards, so the render thread can hold on to it without locking
+struct GameSnapshot
+{
+    uint64_t tick = 0;
+    std::chrono::steady_clock::time_point time; // when the tick was due
+    GameState state;
+};
+
+enum GameKey
+{
+    KEY_FORWARD,
+    KEY_LEFT,
+    KEY_BACK,
+    KEY_RIGHT,
+    KEY_LOOK_UP,
+    KEY_LOOK_LEFT,
+    KEY_LOOK_DOWN,
+    KEY_LOOK_RIGHT,
+    KEY_COUNT
+};
+
+// the game logic, advanced in fixed steps ("ticks") so it behaves the same regardless of the frame rate
+//
+// it either runs on its own thread after start(), so rendering spikes can't slow it down (and its hitches can't
+// drop frames), or is ticked from the main loop with update(); the renderer uses getInterpolatedState() in
+// both cases, which blends the two latest snapshots and therefore lags one tick behind the simulation
+class GameSimulation
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr double DEFAULT_TICK_RATE = 60.0;
+
+    GameSimulation(const GameState &initialState, double tickRate = DEFAULT_TICK_RATE);
+    ~GameSimulation(); // NOTE: stops the thread
+    void start();
+    void stop();
+    bool isThreaded() const {return mThread.joinable();}
+    double getTickRate() const {return mTickRate;}
+
+    // input, called from the thread handling the SDL events
+    void setKey(GameKey key, bool down);
+    void addLook(float yawDegrees, float pitchDegrees);
+
+    // runs the ticks that are due by now, only when not threaded
+    void update(Clock::time_point now);
+    // makes now the time of the latest snapshot and forgets the input, only when not threaded (so a session replayed
+    // with the same deltas from here on ticks exactly like the recorded one did)
+    void restartClock(Clock::time_point now);
+    std::shared_ptr<const GameSnapshot> getLatestSnapshot() const;
+    GameState getInterpolatedState(Clock::time_point now) const;
+protected:
+    struct Input
+    {
+        std::array<bool, KEY_COUNT> keys;
+        float lookYaw;
+        float lookPitch;
+    };
+    static void _Tick(GameState &state, const Input &input, double seconds);
+    void _RunTicks(Clock::time_point now);
+    void _ThreadMain();
+protected:
+    const double mTickRate;
+    const Clock::duration mTickDuration;
+    // only touched by whoever runs the ticks
+    GameState mState;
+    uint64_t mTick;
+    Clock::time_point mNextTickTime;
+    // shared with the event thread
+    mutable std::mutex mInputMutex;
+    Input mInput;
+    // shared with the render thread
+    mutable std::mutex mSnapshotMutex;
+    std::shared_ptr<const GameSnapshot> mPreviousSnapshot;
+    std::shared_ptr<const GameSnapshot> mLatestSnapshot;
+    // the thread, if any
+    std::thread mThread;
+    std::mutex mWakeMutex;
+    std::condition_variable mWake;
+    bool mStopping;
+};
+
+#endif // GAMESIMULATION_H
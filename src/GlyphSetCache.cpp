@@ -0,0 +1,183 @@
+#include "GlyphSetCache.h"
+#include "Profiler.h"
+
+#include <RmlUi/Core/ComputedValues.h>
+#include <RmlUi/Core/Context.h>
+#include <RmlUi/Core/ElementDocument.h>
+#include <RmlUi/Core/ElementText.h>
+#include <RmlUi/Core/Property.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <tuple>
+
+namespace GUI {
+
+// the warm-up document is this far to the left of the window, so nothing it draws can be seen
+static const char WARMUP_DOCUMENT_STYLE[] =
+    "body { position: absolute; left: -10000px; top: 0px; width: 4000px; pointer-events: none; }\n"
+    "div { display: block; }\n";
+
+// the characters of UTF-8 text, each as the sequence of bytes it's encoded with, except for whitespace
+static void addCharacters(const Rml::String &text, std::set<Rml::String> &characters)
+{
+    size_t start = 0;
+    while (start < text.size())
+    {
+        size_t end = start + 1;
+        while (end < text.size() && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80)
+            end++; // a continuation byte
+        const char c = text[start];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+            characters.insert(text.substr(start, end - start));
+        start = end;
+    }
+}
+
+static Rml::String escapeText(const Rml::String &text)
+{
+    Rml::String result;
+    for (const char c : text)
+    {
+        if (c == '<')
+            result += "&lt;";
+        else if (c == '>')
+            result += "&gt;";
+        else if (c == '&')
+            result += "&amp;";
+        else
+            result += c;
+    }
+    return result;
+}
+
+bool GlyphSetCache::Key::operator<(const Key &other) const
+{
+    return std::tie(family, style, weight, size, effect) < std::tie(other.family, other.style, other.weight, other.size, other.effect);
+}
+
+GlyphSetCache::GlyphSetCache(const Rml::String &filename) :
+    mFilename(filename)
+{
+}
+
+bool GlyphSetCache::load()
+{
+    if (!isEnabled())
+        return false;
+    std::ifstream file(mFilename);
+    if (!file)
+        return false; // NOTE: not an error, there was no previous run
+    Rml::String line;
+    while (std::getline(file, line))
+    {
+        // family, style, weight, size, effect, characters
+        Rml::String fields[6];
+        size_t numFields = 0, start = 0;
+        while (numFields < 5)
+        {
+            const size_t tab = line.find('\t', start);
+            if (tab == Rml::String::npos)
+                break;
+            fields[numFields++] = line.substr(start, tab - start);
+            start = tab + 1;
+        }
+        if (numFields != 5)
+        {
+            std::cerr << "warning: skipping a broken line in the glyph cache \"" << mFilename << "\"" << std::endl;
+            continue;
+        }
+        fields[5] = line.substr(start);
+        Key key;
+        key.family = fields[0];
+        key.style = fields[1];
+        key.weight = std::atoi(fields[2].c_str());
+        key.size = static_cast<float>(std::atof(fields[3].c_str()));
+        key.effect = fields[4];
+        addCharacters(fields[5], mGlyphSets[key]);
+    }
+    return true;
+}
+
+bool GlyphSetCache::save() const
+{
+    if (!isEnabled())
+        return false;
+    std::ofstream file(mFilename, std::ios::trunc);
+    for (const auto &glyphSet : mGlyphSets)
+    {
+        const Key &key = glyphSet.first;
+        file << key.family << '\t' << key.style << '\t' << key.weight << '\t' << key.size << '\t' << key.effect << '\t';
+        for (const Rml::String &character : glyphSet.second)
+            file << character;
+        file << '\n';
+    }
+    if (!file)
+    {
+        std::cerr << "error: could not write the glyph cache \"" << mFilename << "\"" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void GlyphSetCache::collect(Rml::Context *context)
+{
+    PROFILE_ZONE("GlyphSetCache::collect");
+    for (int i = 0; i < context->GetNumDocuments(); ++i)
+        _Collect(context->GetDocument(i));
+}
+
+Rml::ElementDocument * GlyphSetCache::loadWarmupDocument(Rml::Context *context) const
+{
+    PROFILE_ZONE("GlyphSetCache::loadWarmupDocument");
+    if (mGlyphSets.empty())
+        return nullptr;
+    Rml::String rml = "<rml><head><style>";
+    rml += WARMUP_DOCUMENT_STYLE;
+    rml += "</style></head><body>";
+    for (const auto &glyphSet : mGlyphSets)
+    {
+        if (glyphSet.second.empty())
+            continue;
+        const Key &key = glyphSet.first;
+        char size[32];
+        snprintf(size, sizeof(size), "%gpx", key.size);
+        rml += "<div style=\"font-family: " + key.family + "; font-style: " + key.style + "; font-weight: " + std::to_string(key.weight) + "; font-size: " + size + ";";
+        if (!key.effect.empty())
+            rml += " font-effect: " + key.effect + ";";
+        rml += "\">";
+        for (const Rml::String &character : glyphSet.second)
+            rml += escapeText(character);
+        rml += "</div>";
+    }
+    rml += "</body></rml>";
+    Rml::ElementDocument * const document = context->LoadDocumentFromMemory(rml, "[glyph warm-up]");
+    if (document)
+        document->Show();
+    return document;
+}
+
+void GlyphSetCache::_Collect(Rml::Element *element)
+{
+    if (Rml::ElementText * const text = dynamic_cast<Rml::ElementText *>(element))
+    {
+        const Rml::ComputedValues &computed = text->GetComputedValues();
+        Key key;
+        key.family = computed.font_family();
+        key.style = computed.font_style() == Rml::Style::FontStyle::Italic ? "italic" : "normal";
+        key.weight = computed.font_weight() == Rml::Style::FontWeight::Auto ? 400 : static_cast<int>(computed.font_weight());
+        key.size = computed.font_size();
+        // NOTE: kept as written in the style sheet, it's parsed again by the warm-up document
+        const Rml::Property * const effect = text->GetProperty(Rml::PropertyId::FontEffect);
+        if (computed.has_font_effect() && effect)
+            key.effect = effect->ToString();
+        if (!key.family.empty() && !text->GetText().empty())
+            addCharacters(text->GetText(), mGlyphSets[key]);
+    }
+    for (int i = 0; i < element->GetNumChildren(); ++i)
+        _Collect(element->GetChild(i));
+}
+
+} // namespace GUI
@@ -0,0 +1,58 @@
+#ifndef GLYPHSETCACHE_H
+#define GLYPHSETCACHE_H
+
+#include <RmlUi/Core/Types.h>
+
+#include <map>
+#include <set>
+
+namespace Rml {
+
+class Context;
+class Element;
+class ElementDocument;
+
+} // namespace Rml
+
+namespace GUI {
+
+// the glyph sets the documents draw text with (a font face at a size with a font effect, and the characters drawn
+// with it), remembered between runs so they can be rasterized at startup instead of when the text first shows up
+//
+// RmlUi's font engine rasterizes the glyphs of a face/size when a string first uses them, and generates the layers
+// of a font effect (e.g. an outline) for every size it's used at, which is a hitch in the frame it happens in; a
+// warm-up document draws every remembered glyph set once, off screen, during the first frame
+// NOTE: the file is plain text, one glyph set per line: family, style, weight, size (px), effect and characters
+class GlyphSetCache
+{
+public:
+    explicit GlyphSetCache(const Rml::String &filename = Rml::String());
+    bool isEnabled() const {return !mFilename.empty();}
+    // reads the glyph sets of a previous run, a missing file is just empty
+    bool load();
+    bool save() const;
+    // adds the glyph sets of the text in every document of context
+    void collect(Rml::Context *context);
+    size_t getNumGlyphSets() const {return mGlyphSets.size();}
+    // loads (and shows) a document drawing every glyph set off screen, nullptr if there are none
+    // NOTE: it should be closed once it was drawn
+    Rml::ElementDocument * loadWarmupDocument(Rml::Context *context) const;
+protected:
+    struct Key
+    {
+        Rml::String family;
+        Rml::String style;
+        int weight;
+        float size;
+        Rml::String effect; // the font-effect value, empty for none
+        bool operator<(const Key &other) const;
+    };
+    void _Collect(Rml::Element *element);
+protected:
+    Rml::String mFilename;
+    std::map<Key, std::set<Rml::String> > mGlyphSets; // the characters of each, as UTF-8 sequences
+};
+
+} // namespace GUI
+
+#endif // GLYPHSETCACHE_H
@@ -0,0 +1,145 @@
+#include "GpuTimer.h"
+#include "Profiler.h"
+
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+#include <algorithm>
+#include <iostream>
+
+// NOTE: loaded with SDL_GL_GetProcAddress(), SDL_opengl.h only declares OpenGL 1.x functions
+static PFNGLGENQUERIESPROC pglGenQueries = nullptr;
+static PFNGLDELETEQUERIESPROC pglDeleteQueries = nullptr;
+static PFNGLQUERYCOUNTERPROC pglQueryCounter = nullptr;
+static PFNGLGETQUERYIVPROC pglGetQueryiv = nullptr;
+static PFNGLGETQUERYOBJECTIVPROC pglGetQueryObjectiv = nullptr;
+static PFNGLGETQUERYOBJECTUI64VPROC pglGetQueryObjectui64v = nullptr;
+static PFNGLGETINTEGER64VPROC pglGetInteger64v = nullptr;
+
+static bool loadFunctions()
+{
+    pglGenQueries = reinterpret_cast<PFNGLGENQUERIESPROC>(SDL_GL_GetProcAddress("glGenQueries"));
+    pglDeleteQueries = reinterpret_cast<PFNGLDELETEQUERIESPROC>(SDL_GL_GetProcAddress("glDeleteQueries"));
+    pglQueryCounter = reinterpret_cast<PFNGLQUERYCOUNTERPROC>(SDL_GL_GetProcAddress("glQueryCounter"));
+    pglGetQueryiv = reinterpret_cast<PFNGLGETQUERYIVPROC>(SDL_GL_GetProcAddress("glGetQueryiv"));
+    pglGetQueryObjectiv = reinterpret_cast<PFNGLGETQUERYOBJECTIVPROC>(SDL_GL_GetProcAddress("glGetQueryObjectiv"));
+    pglGetQueryObjectui64v = reinterpret_cast<PFNGLGETQUERYOBJECTUI64VPROC>(SDL_GL_GetProcAddress("glGetQueryObjectui64v"));
+    pglGetInteger64v = reinterpret_cast<PFNGLGETINTEGER64VPROC>(SDL_GL_GetProcAddress("glGetInteger64v"));
+    return pglGenQueries && pglDeleteQueries && pglQueryCounter && pglGetQueryiv && pglGetQueryObjectiv && pglGetQueryObjectui64v && pglGetInteger64v;
+}
+
+GpuTimer::GpuTimer(size_t numTimestamps) :
+    mSupported(false),
+    mNumTimestamps(std::min(numTimestamps, MAX_TIMESTAMPS)),
+    mCurrentFrame(FRAMES_IN_FLIGHT - 1),
+    mResultsNs(mNumTimestamps, 0),
+    mResultsWritten(0),
+    mResultsHaveClockOffset(false),
+    mResultsClockOffsetNs(0)
+{
+    // NOTE: timer queries are core since OpenGL 3.3 (ARB_timer_query), Mesa's llvmpipe has them too, but an
+    // implementation is allowed to report 0 bits for the timestamp counter, which means it can't do them
+    if (!loadFunctions())
+    {
+        std::cerr << "warning: GL timer queries aren't available, no GPU timings" << std::endl;
+        return;
+    }
+    GLint counterBits = 0;
+    pglGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counterBits);
+    if (counterBits == 0)
+    {
+        std::cerr << "warning: the GL implementation has no timestamp counter, no GPU timings" << std::endl;
+        return;
+    }
+    for (Frame &frame : mFrames)
+    {
+        frame.queries.resize(mNumTimestamps);
+        pglGenQueries(static_cast<GLsizei>(mNumTimestamps), frame.queries.data());
+    }
+    mSupported = true;
+}
+
+GpuTimer::~GpuTimer()
+{
+    if (!mSupported)
+        return;
+    for (Frame &frame : mFrames)
+        pglDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+}
+
+bool GpuTimer::beginFrame()
+{
+    if (!mSupported)
+        return false;
+    mCurrentFrame = (mCurrentFrame + 1) % FRAMES_IN_FLIGHT;
+    Frame &frame = mFrames[mCurrentFrame];
+    // the oldest frame in flight, its queries are about to be reused
+    const bool gotResults = frame.pending && _ReadResults(frame);
+    frame.pending = false;
+    frame.written = 0;
+
+    // the GPU's clock has an arbitrary origin, lining it up with the profiler's is only needed for captures
+    frame.hasClockOffset = Profiler::isCapturing();
+    if (frame.hasClockOffset)
+    {
+        GLint64 gpuTime = 0;
+        pglGetInteger64v(GL_TIMESTAMP, &gpuTime);
+        frame.clockOffsetNs = static_cast<int64_t>(Profiler::getTimeNs()) - gpuTime;
+    }
+    return gotResults;
+}
+
+void GpuTimer::timestamp(size_t index)
+{
+    if (!mSupported || index >= mNumTimestamps)
+        return;
+    Frame &frame = mFrames[mCurrentFrame];
+    pglQueryCounter(frame.queries[index], GL_TIMESTAMP);
+    frame.written |= uint64_t(1) << index;
+    frame.pending = true;
+}
+
+bool GpuTimer::getElapsedMs(size_t from, size_t to, float &ms) const
+{
+    if (from >= mNumTimestamps || to >= mNumTimestamps)
+        return false;
+    if (!(mResultsWritten & (uint64_t(1) << from)) || !(mResultsWritten & (uint64_t(1) << to)))
+        return false;
+    ms = static_cast<float>(static_cast<double>(mResultsNs[to] - mResultsNs[from]) / 1000000.0);
+    return true;
+}
+
+bool GpuTimer::getProfilerTimeNs(size_t index, unsigned long long &ns) const
+{
+    if (index >= mNumTimestamps || !mResultsHaveClockOffset || !(mResultsWritten & (uint64_t(1) << index)))
+        return false;
+    ns = static_cast<unsigned long long>(static_cast<int64_t>(mResultsNs[index]) + mResultsClockOffsetNs);
+    return true;
+}
+
+bool GpuTimer::_ReadResults(Frame &frame)
+{
+    // NOTE: checking every query, only asking for results that are there is what keeps this from stalling
+    for (size_t i = 0; i < mNumTimestamps; ++i)
+    {
+        if (!(frame.written & (uint64_t(1) << i)))
+            continue;
+        GLint available = 0;
+        pglGetQueryObjectiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+    }
+    for (size_t i = 0; i < mNumTimestamps; ++i)
+    {
+        if (frame.written & (uint64_t(1) << i))
+        {
+            GLuint64 result = 0;
+            pglGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &result);
+            mResultsNs[i] = result;
+        }
+    }
+    mResultsWritten = frame.written;
+    mResultsHaveClockOffset = frame.hasClockOffset;
+    mResultsClockOffsetNs = frame.clockOffsetNs;
+    return true;
+}
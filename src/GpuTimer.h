@@ -0,0 +1,58 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// measures GPU time with GL timestamp queries, in the GL context that is current when it is created
+//
+// every frame gets its own set of queries and the results are read FRAMES_IN_FLIGHT frames later, when the GPU
+// is done with them, so reading them never stalls the pipeline (a frame whose results still aren't ready by
+// then is dropped instead of waited for)
+class GpuTimer
+{
+public:
+    static const size_t FRAMES_IN_FLIGHT = 3;
+    static const size_t MAX_TIMESTAMPS = 64;
+
+    explicit GpuTimer(size_t numTimestamps);
+    ~GpuTimer(); // NOTE: the context has to be current
+    GpuTimer(const GpuTimer &) = delete;
+    GpuTimer & operator=(const GpuTimer &) = delete;
+    // false if the context doesn't have timestamp queries, then everything else does nothing
+    bool isSupported() const {return mSupported;}
+
+    // call once per frame before the first timestamp(), returns true if the results of an earlier frame came in
+    bool beginFrame();
+    // records the time at which the GPU gets to this point of the command stream
+    void timestamp(size_t index);
+
+    // from the latest frame with results, false if it didn't record both timestamps
+    bool getElapsedMs(size_t from, size_t to, float &ms) const;
+    // in Profiler::getTimeNs() time, only known for frames that started while the profiler was capturing
+    bool getProfilerTimeNs(size_t index, unsigned long long &ns) const;
+protected:
+    struct Frame
+    {
+        std::vector<unsigned int> queries;
+        uint64_t written = 0; // bit i is set if timestamp i was recorded
+        bool pending = false;
+        bool hasClockOffset = false;
+        int64_t clockOffsetNs = 0; // profiler time - GPU time
+    };
+    bool _ReadResults(Frame &frame);
+protected:
+    bool mSupported;
+    size_t mNumTimestamps;
+    std::array<Frame, FRAMES_IN_FLIGHT> mFrames;
+    size_t mCurrentFrame;
+    // the latest results
+    std::vector<uint64_t> mResultsNs;
+    uint64_t mResultsWritten;
+    bool mResultsHaveClockOffset;
+    int64_t mResultsClockOffsetNs;
+};
+
+#endif // GPUTIMER_H
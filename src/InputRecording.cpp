@@ -0,0 +1,275 @@
+#include "InputRecording.h"
+
+#include <SDL.h>
+
+#include <cstring>
+#include <iostream>
+
+static const char MAGIC[4] = {'F', 'P', 'S', 'I'};
+static const uint32_t VERSION = 1;
+// anything above these is a broken (or not an input) recording, rather than something to allocate memory for
+static const uint32_t MAX_SCENE_PATH_LENGTH = 4096;
+static const uint32_t MAX_EVENTS_PER_FRAME = 4096;
+
+template <typename T>
+static void append(std::string &buffer, T value)
+{
+    buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+static bool read(std::istream &in, T &value)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+static void appendEvent(std::string &buffer, const SDL_Event &event)
+{
+    append<uint32_t>(buffer, event.type);
+    switch (event.type)
+    {
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+            append<uint8_t>(buffer, event.key.state);
+            append<uint8_t>(buffer, event.key.repeat);
+            append<int32_t>(buffer, event.key.keysym.scancode);
+            append<int32_t>(buffer, event.key.keysym.sym);
+            append<uint16_t>(buffer, event.key.keysym.mod);
+            break;
+        case SDL_TEXTINPUT:
+        {
+            const uint8_t length = static_cast<uint8_t>(strnlen(event.text.text, sizeof(event.text.text)));
+            append<uint8_t>(buffer, length);
+            buffer.append(event.text.text, length);
+            break;
+        }
+        case SDL_MOUSEMOTION:
+            append<uint32_t>(buffer, event.motion.state);
+            append<int32_t>(buffer, event.motion.x);
+            append<int32_t>(buffer, event.motion.y);
+            append<int32_t>(buffer, event.motion.xrel);
+            append<int32_t>(buffer, event.motion.yrel);
+            break;
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+            append<uint8_t>(buffer, event.button.button);
+            append<uint8_t>(buffer, event.button.state);
+            append<uint8_t>(buffer, event.button.clicks);
+            append<int32_t>(buffer, event.button.x);
+            append<int32_t>(buffer, event.button.y);
+            break;
+        case SDL_MOUSEWHEEL:
+            append<int32_t>(buffer, event.wheel.x);
+            append<int32_t>(buffer, event.wheel.y);
+            append<uint32_t>(buffer, event.wheel.direction);
+            append<float>(buffer, event.wheel.preciseX);
+            append<float>(buffer, event.wheel.preciseY);
+            break;
+    }
+}
+
+static bool readEvent(std::istream &in, uint32_t windowId, SDL_Event &event)
+{
+    uint32_t type = 0;
+    if (!read(in, type))
+        return false;
+    std::memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.common.timestamp = SDL_GetTicks();
+    bool ok = true;
+    switch (type)
+    {
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+        {
+            int32_t scancode = 0, sym = 0;
+            event.key.windowID = windowId;
+            ok = read(in, event.key.state) && read(in, event.key.repeat) && read(in, scancode) && read(in, sym) && read(in, event.key.keysym.mod);
+            event.key.keysym.scancode = static_cast<SDL_Scancode>(scancode);
+            event.key.keysym.sym = sym;
+            break;
+        }
+        case SDL_TEXTINPUT:
+        {
+            uint8_t length = 0;
+            event.text.windowID = windowId;
+            ok = read(in, length) && length < sizeof(event.text.text) && in.read(event.text.text, length);
+            break;
+        }
+        case SDL_MOUSEMOTION:
+            event.motion.windowID = windowId;
+            ok = read(in, event.motion.state) && read(in, event.motion.x) && read(in, event.motion.y) && read(in, event.motion.xrel) && read(in, event.motion.yrel);
+            break;
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+            event.button.windowID = windowId;
+            ok = read(in, event.button.button) && read(in, event.button.state) && read(in, event.button.clicks) && read(in, event.button.x) && read(in, event.button.y);
+            break;
+        case SDL_MOUSEWHEEL:
+            event.wheel.windowID = windowId;
+            ok = read(in, event.wheel.x) && read(in, event.wheel.y) && read(in, event.wheel.direction) && read(in, event.wheel.preciseX) && read(in, event.wheel.preciseY);
+            break;
+        default:
+            ok = false; // NOTE: never written, so the log is broken
+            break;
+    }
+    return ok;
+}
+
+bool InputRecorder::open(const std::string &filename, const InputRecordingHeader &header)
+{
+    if (header.scenePath.size() > MAX_SCENE_PATH_LENGTH)
+    {
+        std::cerr << "error: can't record input in \"" << header.scenePath << "\", the path is too long" << std::endl;
+        return false;
+    }
+    mFile.open(filename, std::ios::binary | std::ios::trunc);
+    if (!mFile)
+    {
+        std::cerr << "error: could not create the input recording \"" << filename << "\"" << std::endl;
+        return false;
+    }
+    mFilename = filename;
+    mNumFrames = 0;
+    mBuffer.clear();
+    mBuffer.append(MAGIC, sizeof(MAGIC));
+    append<uint32_t>(mBuffer, VERSION);
+    append<double>(mBuffer, header.tickRate);
+    append<uint32_t>(mBuffer, static_cast<uint32_t>(header.scenePath.size()));
+    mBuffer.append(header.scenePath);
+    mFile.write(mBuffer.data(), mBuffer.size());
+    return static_cast<bool>(mFile);
+}
+
+bool InputRecorder::isRecorded(const SDL_Event &event)
+{
+    switch (event.type)
+    {
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+        case SDL_TEXTINPUT:
+        case SDL_MOUSEMOTION:
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+        case SDL_MOUSEWHEEL:
+            return true;
+    }
+    return false;
+}
+
+void InputRecorder::recordFrame(std::chrono::nanoseconds delta, const std::vector<SDL_Event> &events)
+{
+    if (!mFile.is_open())
+        return;
+    // NOTE: the events are counted before writing them, so there is one write per frame
+    uint32_t numEvents = 0;
+    for (const SDL_Event &event : events)
+        numEvents += isRecorded(event) ? 1 : 0;
+    // NOTE: a replay rejects more than this as a broken log, so the rest of such a frame's events are dropped
+    if (numEvents > MAX_EVENTS_PER_FRAME)
+    {
+        std::cerr << "warning: dropped " << numEvents - MAX_EVENTS_PER_FRAME << " events of frame " << mNumFrames << " from the input recording" << std::endl;
+        numEvents = MAX_EVENTS_PER_FRAME;
+    }
+    mBuffer.clear();
+    append<int64_t>(mBuffer, delta.count());
+    append<uint32_t>(mBuffer, numEvents);
+    uint32_t numWritten = 0;
+    for (const SDL_Event &event : events)
+    {
+        if (numWritten < numEvents && isRecorded(event))
+        {
+            appendEvent(mBuffer, event);
+            numWritten++;
+        }
+    }
+    mFile.write(mBuffer.data(), mBuffer.size());
+    mNumFrames++;
+}
+
+bool InputRecorder::close()
+{
+    if (!mFile.is_open())
+        return true;
+    mFile.close();
+    if (!mFile)
+    {
+        std::cerr << "error: could not write the input recording \"" << mFilename << "\"" << std::endl;
+        return false;
+    }
+    std::cout << "Recorded " << mNumFrames << " frames of input to \"" << mFilename << "\"" << std::endl;
+    return true;
+}
+
+bool InputReplayer::open(const std::string &filename)
+{
+    mFile.open(filename, std::ios::binary);
+    if (!mFile)
+    {
+        std::cerr << "error: could not open the input recording \"" << filename << "\"" << std::endl;
+        return false;
+    }
+    mFilename = filename;
+    mNumFrames = 0;
+    char magic[sizeof(MAGIC)];
+    uint32_t version = 0, scenePathLength = 0;
+    if (!mFile.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || !read(mFile, version))
+    {
+        std::cerr << "error: \"" << filename << "\" isn't an input recording" << std::endl;
+        return false;
+    }
+    if (version != VERSION)
+    {
+        std::cerr << "error: the input recording \"" << filename << "\" is version " << version << ", only version " << VERSION << " is supported" << std::endl;
+        return false;
+    }
+    if (!read(mFile, mHeader.tickRate) || !read(mFile, scenePathLength))
+    {
+        std::cerr << "error: the input recording \"" << filename << "\" is truncated" << std::endl;
+        return false;
+    }
+    if (scenePathLength > MAX_SCENE_PATH_LENGTH)
+    {
+        std::cerr << "error: the input recording \"" << filename << "\" is broken, its scene path is " << scenePathLength << " bytes long" << std::endl;
+        return false;
+    }
+    mHeader.scenePath.resize(scenePathLength);
+    if (!mFile.read(&mHeader.scenePath[0], scenePathLength))
+    {
+        std::cerr << "error: the input recording \"" << filename << "\" is truncated" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool InputReplayer::readFrame(uint32_t windowId, std::chrono::nanoseconds &delta, std::vector<SDL_Event> &events)
+{
+    events.clear();
+    int64_t deltaNs = 0;
+    uint32_t numEvents = 0;
+    if (!mFile.is_open() || !read(mFile, deltaNs))
+        return false; // the end
+    if (!read(mFile, numEvents))
+    {
+        std::cerr << "warning: the input recording \"" << mFilename << "\" ends in the middle of frame " << mNumFrames << std::endl;
+        return false;
+    }
+    if (numEvents > MAX_EVENTS_PER_FRAME)
+    {
+        std::cerr << "warning: the input recording \"" << mFilename << "\" is broken in frame " << mNumFrames << std::endl;
+        return false;
+    }
+    delta = std::chrono::nanoseconds(deltaNs);
+    events.resize(numEvents);
+    for (SDL_Event &event : events)
+    {
+        if (!readEvent(mFile, windowId, event))
+        {
+            std::cerr << "warning: the input recording \"" << mFilename << "\" is broken in frame " << mNumFrames << std::endl;
+            events.clear();
+            return false;
+        }
+    }
+    mNumFrames++;
+    return true;
+}
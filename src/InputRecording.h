@@ -0,0 +1,57 @@
+#ifndef INPUTRECORDING_H
+#define INPUTRECORDING_H
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// forward declaration to avoid including <SDL.h>
+typedef union SDL_Event SDL_Event;
+
+// what a replay has to match for the recorded input to do the same thing again
+struct InputRecordingHeader
+{
+    std::string scenePath;
+    double tickRate = 60.0;
+};
+
+// a session's input as a compact binary log: per frame, the game time that passed since the previous frame and
+// the SDL events handled in it
+//
+// only keyboard, text, mouse motion/button/wheel events are kept, and only the fields that are used (everything
+// else, i.e. window events, belongs to the machine the session runs on rather than to the session)
+// NOTE: the numbers are written in the machine's byte order, logs are meant to be replayed on the same platform
+class InputRecorder
+{
+public:
+    bool open(const std::string &filename, const InputRecordingHeader &header);
+    bool isOpen() const {return mFile.is_open();}
+    static bool isRecorded(const SDL_Event &event);
+    void recordFrame(std::chrono::nanoseconds delta, const std::vector<SDL_Event> &events);
+    size_t getNumFrames() const {return mNumFrames;}
+    bool close(); // returns false if anything failed to be written
+protected:
+    std::ofstream mFile;
+    std::string mFilename;
+    std::string mBuffer;
+    size_t mNumFrames = 0;
+};
+
+class InputReplayer
+{
+public:
+    bool open(const std::string &filename);
+    const InputRecordingHeader & getHeader() const {return mHeader;}
+    // the next frame, with the events addressed to windowId, false at the end of the log (or if it is broken)
+    bool readFrame(uint32_t windowId, std::chrono::nanoseconds &delta, std::vector<SDL_Event> &events);
+    size_t getNumFramesRead() const {return mNumFrames;}
+protected:
+    std::ifstream mFile;
+    std::string mFilename;
+    InputRecordingHeader mHeader;
+    size_t mNumFrames = 0;
+};
+
+#endif // INPUTRECORDING_H
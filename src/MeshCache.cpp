@@ -0,0 +1,419 @@
+#include "MeshCache.h"
+#include "SceneData.h"
+#include "VertexFormat.h"
+#include "Profiler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h> // for open()
+#include <sys/mman.h> // for mmap()
+#include <sys/stat.h> // for fstat()
+#include <unistd.h> // for close()
+
+namespace MeshCache {
+
+static const char MAGIC[4] = {'O', 'M', 'C', 'H'};
+static const size_t DATA_ALIGNMENT = 16; // vertex/index blobs are aligned so they can be used straight from the mapping
+static const uint32_t MAX_LODS = 16; // anything above this is a corrupt file
+
+// the smallest each record can be in the file (i.e. with empty strings, no data and no LODs)
+static const size_t MIN_MATERIAL_BYTES = sizeof(uint32_t) + sizeof(SceneMaterialData::diffuse) + sizeof(SceneMaterialData::emissive) + 2 * sizeof(float);
+static const size_t MIN_MESH_BYTES = 6 * sizeof(uint32_t) + sizeof(SceneMeshData::aabbMin) + sizeof(SceneMeshData::aabbMax) + 2 * sizeof(uint64_t);
+static const size_t MIN_NODE_BYTES = sizeof(int32_t) + sizeof(SceneNodeData::position) + sizeof(SceneNodeData::orientation) + sizeof(SceneNodeData::scale) + sizeof(uint32_t);
+static const size_t MIN_LIGHT_BYTES = 2 * sizeof(uint32_t) + sizeof(SceneLightData::position) + sizeof(SceneLightData::direction) +
+    sizeof(SceneLightData::diffuse) + sizeof(SceneLightData::specular) + 5 * sizeof(float);
+
+struct FileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t importFlags;
+    uint32_t optionFlags;
+    uint64_t sourceHash;
+    uint32_t numMaterials;
+    uint32_t numMeshes;
+    uint32_t numNodes;
+    uint32_t numLights;
+    uint32_t numSourceItems;
+};
+
+// whether every index is below vertexCount, an index past the vertex buffer would make the GPU read out of bounds
+// NOTE: the index data is aligned to DATA_ALIGNMENT in the mapping, so it can be read in place
+static bool indicesInRange(const void *data, uint32_t indexCount, uint32_t indexSize, uint32_t vertexCount)
+{
+    if (!data)
+        return true; // NOTE: the file is truncated, which is reported once everything was read
+    for (uint32_t i = 0; i < indexCount; ++i)
+    {
+        const uint32_t index = indexSize == 2 ? static_cast<const uint16_t *>(data)[i] : static_cast<const uint32_t *>(data)[i];
+        if (index >= vertexCount)
+            return false;
+    }
+    return true;
+}
+
+class Writer
+{
+public:
+    void write(const void *data, size_t size)
+    {
+        const uint8_t * const bytes = static_cast<const uint8_t *>(data);
+        mBuffer.insert(mBuffer.end(), bytes, bytes + size);
+    }
+    template <typename T>
+    void write(const T &value) {write(&value, sizeof(T));}
+    void writeString(const std::string &str)
+    {
+        write(static_cast<uint32_t>(str.size()));
+        write(str.data(), str.size());
+    }
+    void align()
+    {
+        while (mBuffer.size() % DATA_ALIGNMENT)
+            mBuffer.push_back(0);
+    }
+    const std::vector<uint8_t> & getBuffer() const {return mBuffer;}
+protected:
+    std::vector<uint8_t> mBuffer;
+};
+
+class Reader
+{
+public:
+    Reader(const uint8_t *data, size_t size) : mData(data), mSize(size), mOffset(0), mOk(true) {}
+    const void * read(size_t size)
+    {
+        if (!mOk || size > mSize - mOffset)
+        {
+            mOk = false;
+            return nullptr;
+        }
+        const void * const result = mData + mOffset;
+        mOffset += size;
+        return result;
+    }
+    template <typename T>
+    T read()
+    {
+        T value{};
+        if (const void * const src = read(sizeof(T)))
+            memcpy(&value, src, sizeof(T));
+        return value;
+    }
+    std::string readString()
+    {
+        const uint32_t length = read<uint32_t>();
+        const void * const src = read(length);
+        return src ? std::string(static_cast<const char *>(src), length) : std::string();
+    }
+    void align()
+    {
+        mOffset = (mOffset + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+        if (mOffset > mSize)
+            mOk = false;
+    }
+    bool ok() const {return mOk;}
+    // whether what is left could hold count records of at least recordSize bytes each, so a corrupt count is
+    // rejected before anything is allocated for it
+    bool canHold(uint64_t count, size_t recordSize) const {return mOk && count <= (mSize - mOffset) / recordSize;}
+protected:
+    const uint8_t *mData;
+    size_t mSize;
+    size_t mOffset;
+    bool mOk;
+};
+
+std::string getCachePath(const std::string &sourceFilename)
+{
+    return sourceFilename + ".meshcache";
+}
+
+bool hashFile(const std::string &filename, uint64_t &hash)
+{
+    PROFILE_ZONE("MeshCache::hashFile");
+    FILE * const fp = fopen(filename.c_str(), "rb");
+    if (!fp)
+        return false;
+
+    hash = 0xcbf29ce484222325ull;
+    uint8_t buffer[64 * 1024];
+    size_t bytesRead = 0;
+    while ((bytesRead = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+    {
+        for (size_t i = 0; i < bytesRead; ++i)
+        {
+            hash ^= buffer[i];
+            hash *= 0x100000001b3ull;
+        }
+    }
+    const bool ok = !ferror(fp);
+    fclose(fp);
+    return ok;
+}
+
+bool load(const std::string &cachePath, uint64_t sourceHash, uint32_t importFlags, uint32_t optionFlags, SceneData &scene)
+{
+    PROFILE_ZONE("MeshCache::load");
+    const int fd = open(cachePath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(FileHeader)))
+    {
+        close(fd);
+        return false;
+    }
+    const size_t fileSize = static_cast<size_t>(st.st_size);
+    void * const mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // NOTE: the mapping stays valid after closing the descriptor
+    if (mapped == MAP_FAILED)
+        return false;
+    std::shared_ptr<const void> mapping(mapped, [fileSize](const void *ptr) {
+        munmap(const_cast<void *>(ptr), fileSize);
+    });
+
+    Reader reader(static_cast<const uint8_t *>(mapped), fileSize);
+    const FileHeader header = reader.read<FileHeader>();
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION ||
+        header.importFlags != importFlags ||
+        header.optionFlags != optionFlags ||
+        header.sourceHash != sourceHash)
+    {
+        return false;
+    }
+
+    // NOTE: the header can match and the rest still be damaged (or cut short), every count is checked against what
+    // is left before anything is allocated for it
+    const auto truncated = [&cachePath]() {
+        std::cerr << "Mesh cache \"" << cachePath << "\" is truncated, ignoring it" << std::endl;
+        return false;
+    };
+    SceneData result;
+    if (!reader.canHold(header.numMaterials, MIN_MATERIAL_BYTES))
+        return truncated();
+    result.materials.resize(header.numMaterials);
+    for (SceneMaterialData &material : result.materials)
+    {
+        material.name = reader.readString();
+        for (float &c : material.diffuse) c = reader.read<float>();
+        for (float &c : material.emissive) c = reader.read<float>();
+        material.roughness = reader.read<float>();
+        material.metalness = reader.read<float>();
+        if (!reader.ok())
+            return truncated();
+    }
+
+    if (!reader.canHold(header.numMeshes, MIN_MESH_BYTES))
+        return truncated();
+    result.meshes.resize(header.numMeshes);
+    for (SceneMeshData &mesh : result.meshes)
+    {
+        mesh.name = reader.readString();
+        mesh.materialIndex = reader.read<uint32_t>();
+        mesh.vertexCount = reader.read<uint32_t>();
+        mesh.vertexFlags = reader.read<uint32_t>();
+        mesh.indexCount = reader.read<uint32_t>();
+        mesh.indexSize = reader.read<uint32_t>();
+        for (float &v : mesh.aabbMin) v = reader.read<float>();
+        for (float &v : mesh.aabbMax) v = reader.read<float>();
+        const uint64_t vertexBytes = reader.read<uint64_t>();
+        const uint64_t indexBytes = reader.read<uint64_t>();
+        reader.align();
+        mesh.vertexData = reader.read(vertexBytes);
+        reader.align();
+        mesh.indexData = reader.read(indexBytes);
+        if (!reader.ok())
+            return truncated();
+        if (mesh.materialIndex >= header.numMaterials ||
+            (mesh.indexSize != 2 && mesh.indexSize != 4) ||
+            vertexBytes != static_cast<uint64_t>(mesh.vertexCount) * VertexFormat::getStride(mesh.vertexFlags) ||
+            indexBytes != static_cast<uint64_t>(mesh.indexCount) * mesh.indexSize)
+            return false;
+        if (!indicesInRange(mesh.indexData, mesh.indexCount, mesh.indexSize, mesh.vertexCount))
+        {
+            std::cerr << "Mesh cache \"" << cachePath << "\" has indices past the vertices of \"" << mesh.name << "\", ignoring it" << std::endl;
+            return false;
+        }
+
+        const uint32_t numLods = reader.read<uint32_t>();
+        if (numLods > MAX_LODS)
+            return false;
+        mesh.lods.resize(numLods);
+        for (SceneLodData &lod : mesh.lods)
+        {
+            lod.distance = reader.read<float>();
+            lod.indexCount = reader.read<uint32_t>();
+            const uint64_t lodIndexBytes = reader.read<uint64_t>();
+            reader.align();
+            lod.indexData = reader.read(lodIndexBytes);
+            if (!reader.ok())
+                return truncated();
+            if (lodIndexBytes != static_cast<uint64_t>(lod.indexCount) * mesh.indexSize)
+                return false;
+            if (!indicesInRange(lod.indexData, lod.indexCount, mesh.indexSize, mesh.vertexCount))
+            {
+                std::cerr << "Mesh cache \"" << cachePath << "\" has LOD indices past the vertices of \"" << mesh.name << "\", ignoring it" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    if (!reader.canHold(header.numNodes, MIN_NODE_BYTES))
+        return truncated();
+    result.nodes.resize(header.numNodes);
+    for (size_t i = 0; i < result.nodes.size(); ++i)
+    {
+        SceneNodeData &node = result.nodes[i];
+        node.parentIndex = reader.read<int32_t>();
+        for (float &v : node.position) v = reader.read<float>();
+        for (float &v : node.orientation) v = reader.read<float>();
+        for (float &v : node.scale) v = reader.read<float>();
+        const uint32_t numMeshIndices = reader.read<uint32_t>();
+        if (!reader.canHold(numMeshIndices, sizeof(uint32_t)))
+            return truncated();
+        node.meshIndices.resize(numMeshIndices);
+        for (uint32_t &index : node.meshIndices)
+        {
+            index = reader.read<uint32_t>();
+            if (index >= header.numMeshes)
+                return false;
+        }
+        if (!reader.ok())
+            return truncated();
+        if (node.parentIndex >= static_cast<int32_t>(i))
+            return false;
+    }
+
+    if (!reader.canHold(header.numLights, MIN_LIGHT_BYTES))
+        return truncated();
+    result.lights.resize(header.numLights);
+    for (SceneLightData &light : result.lights)
+    {
+        light.name = reader.readString();
+        light.type = static_cast<SceneLightType>(reader.read<uint32_t>());
+        for (float &v : light.position) v = reader.read<float>();
+        for (float &v : light.direction) v = reader.read<float>();
+        for (float &v : light.diffuse) v = reader.read<float>();
+        for (float &v : light.specular) v = reader.read<float>();
+        light.innerCone = reader.read<float>();
+        light.outerCone = reader.read<float>();
+        light.attenuationConstant = reader.read<float>();
+        light.attenuationLinear = reader.read<float>();
+        light.attenuationQuadratic = reader.read<float>();
+        if (!reader.ok())
+            return truncated();
+    }
+
+    result.numSourceItems = header.numSourceItems;
+    result.mapping = std::move(mapping);
+    scene = std::move(result);
+    return true;
+}
+
+bool save(const std::string &cachePath, uint64_t sourceHash, uint32_t importFlags, uint32_t optionFlags, const SceneData &scene)
+{
+    PROFILE_ZONE("MeshCache::save");
+    Writer writer;
+
+    FileHeader header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.importFlags = importFlags;
+    header.optionFlags = optionFlags;
+    header.sourceHash = sourceHash;
+    header.numMaterials = static_cast<uint32_t>(scene.materials.size());
+    header.numMeshes = static_cast<uint32_t>(scene.meshes.size());
+    header.numNodes = static_cast<uint32_t>(scene.nodes.size());
+    header.numLights = static_cast<uint32_t>(scene.lights.size());
+    header.numSourceItems = scene.numSourceItems;
+    writer.write(header);
+
+    for (const SceneMaterialData &material : scene.materials)
+    {
+        writer.writeString(material.name);
+        writer.write(material.diffuse, sizeof(material.diffuse));
+        writer.write(material.emissive, sizeof(material.emissive));
+        writer.write(material.roughness);
+        writer.write(material.metalness);
+    }
+
+    for (const SceneMeshData &mesh : scene.meshes)
+    {
+        const uint64_t vertexBytes = mesh.ownedVertexData.size();
+        const uint64_t indexBytes = mesh.ownedIndexData.size();
+        writer.writeString(mesh.name);
+        writer.write(mesh.materialIndex);
+        writer.write(mesh.vertexCount);
+        writer.write(mesh.vertexFlags);
+        writer.write(mesh.indexCount);
+        writer.write(mesh.indexSize);
+        writer.write(mesh.aabbMin, sizeof(mesh.aabbMin));
+        writer.write(mesh.aabbMax, sizeof(mesh.aabbMax));
+        writer.write(vertexBytes);
+        writer.write(indexBytes);
+        writer.align();
+        writer.write(mesh.ownedVertexData.data(), vertexBytes);
+        writer.align();
+        writer.write(mesh.ownedIndexData.data(), indexBytes);
+
+        writer.write(static_cast<uint32_t>(mesh.lods.size()));
+        for (const SceneLodData &lod : mesh.lods)
+        {
+            const uint64_t lodIndexBytes = lod.ownedIndexData.size();
+            writer.write(lod.distance);
+            writer.write(lod.indexCount);
+            writer.write(lodIndexBytes);
+            writer.align();
+            writer.write(lod.ownedIndexData.data(), lodIndexBytes);
+        }
+    }
+
+    for (const SceneNodeData &node : scene.nodes)
+    {
+        writer.write(node.parentIndex);
+        writer.write(node.position, sizeof(node.position));
+        writer.write(node.orientation, sizeof(node.orientation));
+        writer.write(node.scale, sizeof(node.scale));
+        writer.write(static_cast<uint32_t>(node.meshIndices.size()));
+        writer.write(node.meshIndices.data(), node.meshIndices.size() * sizeof(uint32_t));
+    }
+
+    for (const SceneLightData &light : scene.lights)
+    {
+        writer.writeString(light.name);
+        writer.write(static_cast<uint32_t>(light.type));
+        writer.write(light.position, sizeof(light.position));
+        writer.write(light.direction, sizeof(light.direction));
+        writer.write(light.diffuse, sizeof(light.diffuse));
+        writer.write(light.specular, sizeof(light.specular));
+        writer.write(light.innerCone);
+        writer.write(light.outerCone);
+        writer.write(light.attenuationConstant);
+        writer.write(light.attenuationLinear);
+        writer.write(light.attenuationQuadratic);
+    }
+
+    const std::string tempPath = cachePath + ".tmp";
+    FILE * const fp = fopen(tempPath.c_str(), "wb");
+    if (!fp)
+    {
+        std::cerr << "Could not write mesh cache \"" << tempPath << "\"" << std::endl;
+        return false;
+    }
+    const std::vector<uint8_t> &buffer = writer.getBuffer();
+    const bool written = fwrite(buffer.data(), 1, buffer.size(), fp) == buffer.size();
+    const bool closed = fclose(fp) == 0;
+    if (!written || !closed || rename(tempPath.c_str(), cachePath.c_str()) != 0)
+    {
+        std::cerr << "Could not write mesh cache \"" << cachePath << "\"" << std::endl;
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace MeshCache
@@ -0,0 +1,29 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <cstdint>
+#include <string>
+
+struct SceneData;
+
+namespace MeshCache {
+
+// bump this whenever the layout of the cache file (or of SceneData) changes
+static const uint32_t VERSION = 6;
+
+// the cache lives next to the source asset, i.e. "level.glb" -> "level.glb.meshcache"
+std::string getCachePath(const std::string &sourceFilename);
+
+// FNV-1a hash of the whole source file, returns false if it couldn't be read
+bool hashFile(const std::string &filename, uint64_t &hash);
+
+// memory maps the cache file, the vertex/index data of the resulting meshes point directly into the mapping
+// returns false if the file is missing, corrupt or was made from a different source file / import flags / options / version
+bool load(const std::string &cachePath, uint64_t sourceHash, uint32_t importFlags, uint32_t optionFlags, SceneData &scene);
+
+// writes to a temporary file first and renames it, so a crash never leaves a half written cache behind
+bool save(const std::string &cachePath, uint64_t sourceHash, uint32_t importFlags, uint32_t optionFlags, const SceneData &scene);
+
+} // namespace MeshCache
+
+#endif // MESHCACHE_H
@@ -0,0 +1,270 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace MeshOptimizer {
+
+CacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, size_t cacheSize)
+{
+    CacheStats stats;
+    if (indices.size() < 3 || cacheSize == 0)
+        return stats;
+
+    // NOTE: a FIFO is what most GPUs behave like, timestamps make the lookup O(1)
+    std::vector<size_t> insertedAt(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t misses = 0;
+    size_t uniqueVertices = 0;
+    for (const uint32_t index : indices) {
+        if (!referenced[index]) {
+            referenced[index] = true;
+            uniqueVertices++;
+        }
+        if (insertedAt[index] == 0 || misses - insertedAt[index] + 1 > cacheSize) {
+            misses++;
+            insertedAt[index] = misses;
+        }
+    }
+    stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / uniqueVertices;
+    return stats;
+}
+
+// the cache that is modelled while ordering, and the scores from Forsyth's article as constant tables (computed
+// with double precision and rounded to float), so the order doesn't depend on the math library's std::pow()
+static const int SCORING_CACHE_SIZE = 32;
+// a vertex's score for its position in the cache: the vertices of the last triangle get a fixed 0.75, so the strip
+// doesn't just bounce back and forth, the rest pow(1 - (position - 3) / (SCORING_CACHE_SIZE - 3), 1.5)
+static const float CACHE_POSITION_SCORES[SCORING_CACHE_SIZE] = {
+    0.75f, 0.75f, 0.75f, 1.0f, 0.948724329f, 0.898356378f, 0.848912716f, 0.800410926f,
+    0.752869785f, 0.706309021f, 0.660749793f, 0.616214573f, 0.572727442f, 0.530314386f, 0.489003271f, 0.448824316f,
+    0.409810394f, 0.371997386f, 0.335424721f, 0.30013597f, 0.266179651f, 0.233610317f, 0.202489734f, 0.172888756f,
+    0.144889861f, 0.118590541f, 0.0941087231f, 0.0715909302f, 0.0512262993f, 0.0332724564f, 0.0181112327f, 0.00640328741f,
+};
+// the boost for vertices with few triangles left, so they don't end up as lonely triangles later:
+// 2 * pow(remainingTriangles, -0.5), and the last one for any vertex with more triangles than that
+static const uint32_t VALENCE_TABLE_SIZE = 64;
+static const float VALENCE_BOOST_SCORES[VALENCE_TABLE_SIZE] = {
+    0.0f, 2.0f, 1.41421354f, 1.15470052f, 1.0f, 0.89442718f, 0.816496611f, 0.755928934f,
+    0.707106769f, 0.666666687f, 0.632455528f, 0.603022695f, 0.577350259f, 0.554700196f, 0.534522474f, 0.516397774f,
+    0.5f, 0.485071242f, 0.471404523f, 0.458831459f, 0.44721359f, 0.436435789f, 0.426401436f, 0.417028815f,
+    0.408248305f, 0.400000006f, 0.392232269f, 0.384900182f, 0.377964467f, 0.371390671f, 0.365148365f, 0.35921061f,
+    0.353553385f, 0.34815532f, 0.342997164f, 0.33806169f, 0.333333343f, 0.328797966f, 0.324442834f, 0.320256293f,
+    0.316227764f, 0.312347531f, 0.308606714f, 0.304997146f, 0.301511347f, 0.298142403f, 0.294883907f, 0.291729987f,
+    0.288675129f, 0.285714298f, 0.282842726f, 0.28005603f, 0.277350098f, 0.274721116f, 0.272165537f, 0.269679934f,
+    0.267261237f, 0.264906466f, 0.262612879f, 0.260377824f, 0.258198887f, 0.256073773f, 0.254000247f, 0.251976311f,
+};
+
+static float vertexScore(int cachePosition, uint32_t remainingTriangles)
+{
+    if (remainingTriangles == 0)
+        return -1.0f; // nothing left to draw with this vertex
+    const float score = cachePosition >= 0 ? CACHE_POSITION_SCORES[cachePosition] : 0.0f;
+    return score + VALENCE_BOOST_SCORES[std::min(remainingTriangles, VALENCE_TABLE_SIZE - 1)];
+}
+
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // vertex -> triangles adjacency, remainingTriangles[v] counts how many of them are left
+    std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+        triangleOffsets[indices[i] + 1]++;
+    for (size_t i = 0; i < vertexCount; ++i)
+        triangleOffsets[i + 1] += triangleOffsets[i];
+    std::vector<uint32_t> remainingTriangles(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i)
+        remainingTriangles[i] = triangleOffsets[i + 1] - triangleOffsets[i];
+    std::vector<uint32_t> vertexTriangles(triangleCount * 3);
+    {
+        std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; ++i)
+            vertexTriangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i)
+        vertexScores[i] = vertexScore(-1, remainingTriangles[i]);
+    std::vector<float> triangleScores(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+
+    // NOTE: the cache has room for the three vertices of the new triangle on top of SCORING_CACHE_SIZE
+    std::vector<uint32_t> cache, newCache;
+    cache.reserve(SCORING_CACHE_SIZE + 3);
+    newCache.reserve(SCORING_CACHE_SIZE + 3);
+    std::vector<int> cachePositions(vertexCount, -1);
+
+    size_t bestTriangle = 0;
+    for (size_t t = 1; t < triangleCount; ++t) {
+        if (triangleScores[t] > triangleScores[bestTriangle])
+            bestTriangle = t;
+    }
+    size_t scanCursor = 0; // used to find a triangle when none of the cached vertices has any left
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+        const uint32_t *triangle = &indices[bestTriangle * 3];
+        emitted[bestTriangle] = true;
+        result.insert(result.end(), triangle, triangle + 3);
+
+        // the triangle's vertices go to the front of the LRU cache, and have one triangle less to go
+        newCache.assign(triangle, triangle + 3);
+        for (const uint32_t vertex : cache) {
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+                newCache.push_back(vertex);
+        }
+        for (int j = 0; j < 3; ++j) {
+            const uint32_t vertex = triangle[j];
+            // move the emitted triangle to the end of the vertex's list, out of the remaining range
+            uint32_t * const begin = &vertexTriangles[triangleOffsets[vertex]];
+            uint32_t * const end = begin + remainingTriangles[vertex];
+            std::iter_swap(std::find(begin, end, static_cast<uint32_t>(bestTriangle)), end - 1);
+            remainingTriangles[vertex]--;
+        }
+
+        // update the scores of everything that was or is in the cache, and find the best triangle among theirs
+        for (const uint32_t vertex : cache)
+            cachePositions[vertex] = -1;
+        for (size_t i = 0; i < newCache.size(); ++i) {
+            const uint32_t vertex = newCache[i];
+            cachePositions[vertex] = i < static_cast<size_t>(SCORING_CACHE_SIZE) ? static_cast<int>(i) : -1;
+            vertexScores[vertex] = vertexScore(cachePositions[vertex], remainingTriangles[vertex]);
+        }
+        float bestScore = -1.0f;
+        bool found = false;
+        for (const uint32_t vertex : newCache) {
+            for (uint32_t k = 0; k < remainingTriangles[vertex]; ++k) {
+                const uint32_t t = vertexTriangles[triangleOffsets[vertex] + k];
+                const float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+                triangleScores[t] = score;
+                if (score > bestScore || (score == bestScore && t < bestTriangle)) {
+                    bestScore = score;
+                    bestTriangle = t;
+                    found = true;
+                }
+            }
+        }
+        if (newCache.size() > static_cast<size_t>(SCORING_CACHE_SIZE))
+            newCache.resize(SCORING_CACHE_SIZE);
+        std::swap(cache, newCache);
+
+        if (!found) {
+            while (scanCursor < triangleCount && emitted[scanCursor])
+                scanCursor++;
+            bestTriangle = scanCursor;
+        }
+    }
+    indices = std::move(result);
+}
+
+void optimizeOverdraw(std::vector<uint32_t> &indices, const float *positions, size_t vertexCount, float threshold)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2)
+        return;
+
+    // a cluster starts wherever the cache order already has a hard break (all three vertices missing the cache),
+    // so reordering whole clusters barely changes the ACMR
+    std::vector<size_t> clusterStarts;
+    {
+        std::vector<size_t> insertedAt(vertexCount, 0);
+        size_t misses = 0;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            int triangleMisses = 0;
+            for (int j = 0; j < 3; ++j) {
+                const uint32_t vertex = indices[t * 3 + j];
+                if (insertedAt[vertex] == 0 || misses - insertedAt[vertex] + 1 > DEFAULT_CACHE_SIZE) {
+                    misses++;
+                    insertedAt[vertex] = misses;
+                    triangleMisses++;
+                }
+            }
+            if (triangleMisses == 3)
+                clusterStarts.push_back(t);
+        }
+    }
+    if (clusterStarts.size() < 2)
+        return;
+    clusterStarts.push_back(triangleCount);
+
+    double meshCentroid[3] = {0.0, 0.0, 0.0};
+    double meshArea = 0.0;
+    struct Cluster
+    {
+        size_t start, end;
+        double centroid[3];
+        double normal[3];
+        float sortKey;
+    };
+    std::vector<Cluster> clusters(clusterStarts.size() - 1);
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        Cluster &cluster = clusters[c];
+        cluster.start = clusterStarts[c];
+        cluster.end = clusterStarts[c + 1];
+        double area = 0.0;
+        for (int axis = 0; axis < 3; ++axis)
+            cluster.centroid[axis] = cluster.normal[axis] = 0.0;
+        for (size_t t = cluster.start; t < cluster.end; ++t) {
+            const float *p0 = &positions[indices[t * 3] * 3];
+            const float *p1 = &positions[indices[t * 3 + 1] * 3];
+            const float *p2 = &positions[indices[t * 3 + 2] * 3];
+            const double e1[3] = {double(p1[0]) - p0[0], double(p1[1]) - p0[1], double(p1[2]) - p0[2]};
+            const double e2[3] = {double(p2[0]) - p0[0], double(p2[1]) - p0[1], double(p2[2]) - p0[2]};
+            const double n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            const double triangleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) * 0.5;
+            for (int axis = 0; axis < 3; ++axis) {
+                cluster.centroid[axis] += (double(p0[axis]) + p1[axis] + p2[axis]) / 3.0 * triangleArea;
+                cluster.normal[axis] += n[axis];
+            }
+            area += triangleArea;
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            meshCentroid[axis] += cluster.centroid[axis];
+            cluster.centroid[axis] = area > 0.0 ? cluster.centroid[axis] / area : 0.0;
+        }
+        meshArea += area;
+    }
+    for (double &v : meshCentroid)
+        v = meshArea > 0.0 ? v / meshArea : 0.0;
+
+    // clusters on the outside facing away from the center are the most likely to occlude the others
+    for (Cluster &cluster : clusters) {
+        const double length = std::sqrt(cluster.normal[0] * cluster.normal[0] + cluster.normal[1] * cluster.normal[1] + cluster.normal[2] * cluster.normal[2]);
+        double key = 0.0;
+        for (int axis = 0; axis < 3; ++axis)
+            key += (cluster.centroid[axis] - meshCentroid[axis]) * (length > 0.0 ? cluster.normal[axis] / length : 0.0);
+        cluster.sortKey = static_cast<float>(key);
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) {return a.sortKey > b.sortKey;});
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (const Cluster &cluster : clusters)
+        result.insert(result.end(), indices.begin() + cluster.start * 3, indices.begin() + cluster.end * 3);
+
+    if (analyzeVertexCache(result, vertexCount).acmr <= analyzeVertexCache(indices, vertexCount).acmr * threshold)
+        indices = std::move(result);
+}
+
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t> &indices, size_t vertexCount, size_t &newVertexCount)
+{
+    std::vector<uint32_t> remap(vertexCount, REMAP_UNUSED);
+    uint32_t nextVertex = 0;
+    for (uint32_t &index : indices) {
+        if (remap[index] == REMAP_UNUSED)
+            remap[index] = nextVertex++;
+        index = remap[index];
+    }
+    newVertexCount = nextVertex;
+    return remap;
+}
+
+} // namespace MeshOptimizer
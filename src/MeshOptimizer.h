@@ -0,0 +1,43 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// index/vertex reordering for GPU efficiency, run on every mesh after importing (replacing aiProcess_ImproveCacheLocality)
+//
+// everything in here is deterministic: the same input gives the same output in every run of the same build, and the
+// vertex cache ordering only uses constant score tables and float additions, so it is the same with any math library
+// NOTE: optimizeOverdraw() computes areas and normals with sqrt() and products, which a compiler contracting them
+// into FMA instructions (e.g. GCC on AArch64) can round differently, so its output can differ between builds
+namespace MeshOptimizer {
+
+// how well an index buffer uses the post-transform vertex cache, simulated as a FIFO of the given size
+struct CacheStats
+{
+    float acmr = 0.0f; // average cache miss ratio: vertex shader invocations per triangle (0.5 is ideal, 3 is the worst)
+    float atvr = 0.0f; // average transformed vertex ratio: invocations per referenced vertex (1 is ideal)
+};
+
+static const size_t DEFAULT_CACHE_SIZE = 16;
+
+CacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, size_t cacheSize = DEFAULT_CACHE_SIZE);
+
+// reorders the triangles for the vertex cache, using Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+// reorders clusters of (already cache optimized) triangles so the ones facing outwards come first, which
+// lets the depth test reject more of the rest; the new order is only kept if its ACMR is at most threshold
+// times the old one
+void optimizeOverdraw(std::vector<uint32_t> &indices, const float *positions, size_t vertexCount, float threshold = 1.05f);
+
+// renumbers the vertices in the order the indices first use them (unreferenced ones are dropped), so vertex
+// fetches walk the vertex buffer linearly; rewrites indices and returns remap[oldVertex] = newVertex
+// (REMAP_UNUSED for dropped vertices), newVertexCount receives the number of vertices that are left
+static const uint32_t REMAP_UNUSED = 0xFFFFFFFFu;
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t> &indices, size_t vertexCount, size_t &newVertexCount);
+
+} // namespace MeshOptimizer
+
+#endif // MESHOPTIMIZER_H
@@ -0,0 +1,237 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace MeshSimplifier {
+
+// symmetric 4x4 matrix summing the squared distances to a set of planes, weighted by triangle area
+struct Quadric
+{
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+    double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+    double a22 = 0.0, a23 = 0.0;
+    double a33 = 0.0;
+    double weight = 0.0;
+
+    void addPlane(double nx, double ny, double nz, double d, double w)
+    {
+        a00 += w * nx * nx; a01 += w * nx * ny; a02 += w * nx * nz; a03 += w * nx * d;
+        a11 += w * ny * ny; a12 += w * ny * nz; a13 += w * ny * d;
+        a22 += w * nz * nz; a23 += w * nz * d;
+        a33 += w * d * d;
+        weight += w;
+    }
+    void add(const Quadric &other)
+    {
+        a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+        a11 += other.a11; a12 += other.a12; a13 += other.a13;
+        a22 += other.a22; a23 += other.a23;
+        a33 += other.a33;
+        weight += other.weight;
+    }
+    // sum of the weighted squared distances of p to the planes
+    double evaluate(const float *p) const
+    {
+        const double x = p[0], y = p[1], z = p[2];
+        return a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x +
+               a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y +
+               a22 * z * z + 2.0 * a23 * z +
+               a33;
+    }
+};
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    double error; // average squared distance
+};
+
+struct PositionKey
+{
+    uint32_t bits[3];
+    bool operator==(const PositionKey &other) const {return memcmp(bits, other.bits, sizeof(bits)) == 0;}
+};
+
+struct PositionKeyHash
+{
+    size_t operator()(const PositionKey &key) const
+    {
+        return (key.bits[0] * 73856093u) ^ (key.bits[1] * 19349663u) ^ (key.bits[2] * 83492791u);
+    }
+};
+
+static void triangleNormal(const float *p0, const float *p1, const float *p2, double normal[3])
+{
+    const double e1[3] = {double(p1[0]) - p0[0], double(p1[1]) - p0[1], double(p1[2]) - p0[2]};
+    const double e2[3] = {double(p2[0]) - p0[0], double(p2[1]) - p0[1], double(p2[2]) - p0[2]};
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// vertices that must never be collapsed away: the ones on borders and attribute seams
+static std::vector<bool> findLockedVertices(const float *positions, size_t vertexCount, const std::vector<uint32_t> &indices)
+{
+    std::vector<bool> locked(vertexCount, false);
+
+    std::unordered_map<PositionKey, uint32_t, PositionKeyHash> firstAtPosition;
+    firstAtPosition.reserve(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        PositionKey key;
+        memcpy(key.bits, &positions[i * 3], sizeof(key.bits));
+        auto result = firstAtPosition.emplace(key, static_cast<uint32_t>(i));
+        if (!result.second) {
+            locked[i] = true;
+            locked[result.first->second] = true;
+        }
+    }
+
+    // an edge used by only one triangle is a border, the opposite direction is missing
+    std::unordered_map<uint64_t, uint32_t> edgeCounts;
+    edgeCounts.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        for (int e = 0; e < 3; ++e) {
+            const uint32_t a = indices[i + e], b = indices[i + (e + 1) % 3];
+            edgeCounts[(uint64_t(std::min(a, b)) << 32) | std::max(a, b)]++;
+        }
+    }
+    for (const auto &edge : edgeCounts) {
+        if (edge.second == 1) {
+            locked[edge.first >> 32] = true;
+            locked[edge.first & 0xFFFFFFFFu] = true;
+        }
+    }
+    return locked;
+}
+
+std::vector<uint32_t> simplify(const float *positions, size_t vertexCount, const std::vector<uint32_t> &indices, size_t targetIndexCount, float maxError)
+{
+    std::vector<uint32_t> result(indices);
+    if (result.size() <= targetIndexCount)
+        return result;
+
+    const std::vector<bool> locked = findLockedVertices(positions, vertexCount, indices);
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i + 2 < result.size(); i += 3) {
+        const float *p0 = &positions[result[i] * 3];
+        double normal[3];
+        triangleNormal(p0, &positions[result[i + 1] * 3], &positions[result[i + 2] * 3], normal);
+        const double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length <= 0.0)
+            continue;
+        for (double &n : normal)
+            n /= length;
+        const double d = -(normal[0] * p0[0] + normal[1] * p0[1] + normal[2] * p0[2]);
+        for (int j = 0; j < 3; ++j)
+            quadrics[result[i + j]].addPlane(normal[0], normal[1], normal[2], d, length * 0.5);
+    }
+
+    const double maxErrorSquared = double(maxError) * maxError;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+    std::vector<uint32_t> vertexTriangles;
+    std::vector<Collapse> collapses;
+
+    while (result.size() > targetIndexCount) {
+        // vertex -> triangles adjacency of the current triangles
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (const uint32_t index : result)
+            triangleOffsets[index + 1]++;
+        for (size_t i = 0; i < vertexCount; ++i)
+            triangleOffsets[i + 1] += triangleOffsets[i];
+        vertexTriangles.resize(result.size());
+        {
+            std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); ++i)
+                vertexTriangles[cursor[result[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        // every edge can be collapsed in either direction, unless the vertex that goes away is locked
+        collapses.clear();
+        for (size_t i = 0; i + 2 < result.size(); i += 3) {
+            for (int e = 0; e < 3; ++e) {
+                const uint32_t a = result[i + e], b = result[i + (e + 1) % 3];
+                for (int direction = 0; direction < 2; ++direction) {
+                    const uint32_t from = direction ? b : a, to = direction ? a : b;
+                    if (locked[from])
+                        continue;
+                    Quadric quadric = quadrics[from];
+                    quadric.add(quadrics[to]);
+                    const double error = quadric.weight > 0.0 ? std::max(0.0, quadric.evaluate(&positions[to * 3])) / quadric.weight : 0.0;
+                    collapses.push_back({from, to, error});
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+            return a.error < b.error || (a.error == b.error && (a.from < b.from || (a.from == b.from && a.to < b.to)));
+        });
+
+        // each collapse removes about two triangles, and a vertex can only take part in one collapse per pass
+        const size_t collapsesNeeded = std::max<size_t>(1, (result.size() - targetIndexCount) / 6);
+        size_t collapsesDone = 0;
+        for (size_t i = 0; i < vertexCount; ++i)
+            remap[i] = static_cast<uint32_t>(i);
+        std::fill(touched.begin(), touched.end(), false);
+        for (const Collapse &collapse : collapses) {
+            if (collapse.error > maxErrorSquared || collapsesDone >= collapsesNeeded)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+
+            // moving "from" onto "to" must not flip (or squash) any of the triangles that stay
+            bool flips = false;
+            for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && !flips; ++t) {
+                const uint32_t *triangle = &result[vertexTriangles[t] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                    continue;
+                const float *before[3], *after[3];
+                for (int j = 0; j < 3; ++j) {
+                    before[j] = &positions[triangle[j] * 3];
+                    after[j] = triangle[j] == collapse.from ? &positions[collapse.to * 3] : before[j];
+                }
+                double oldNormal[3], newNormal[3];
+                triangleNormal(before[0], before[1], before[2], oldNormal);
+                triangleNormal(after[0], after[1], after[2], newNormal);
+                const double dot = oldNormal[0] * newNormal[0] + oldNormal[1] * newNormal[1] + oldNormal[2] * newNormal[2];
+                const double newLengthSquared = newNormal[0] * newNormal[0] + newNormal[1] * newNormal[1] + newNormal[2] * newNormal[2];
+                const double oldLengthSquared = oldNormal[0] * oldNormal[0] + oldNormal[1] * oldNormal[1] + oldNormal[2] * oldNormal[2];
+                // NOTE: also rejects large rotations, small ones add up over several collapses
+                flips = newLengthSquared <= 0.0 || dot <= 0.5 * std::sqrt(oldLengthSquared * newLengthSquared);
+            }
+            if (flips)
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            // NOTE: everything around "from" changes shape, so its neighbours wait for the next pass
+            for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; ++t) {
+                const uint32_t *triangle = &result[vertexTriangles[t] * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+            }
+            collapsesDone++;
+        }
+        if (collapsesDone == 0)
+            break;
+
+        // apply the collapses and drop the triangles that became degenerate
+        size_t writeIndex = 0;
+        for (size_t i = 0; i + 2 < result.size(); i += 3) {
+            const uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            result[writeIndex++] = a;
+            result[writeIndex++] = b;
+            result[writeIndex++] = c;
+        }
+        result.resize(writeIndex);
+    }
+    return result;
+}
+
+} // namespace MeshSimplifier
@@ -0,0 +1,22 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// quadric error metric edge collapse, used to generate LODs at import time
+//
+// the result only references vertices of the input, so every LOD can share the vertex buffer of the full mesh
+// NOTE: vertices on open borders and on attribute seams (several vertices at the same position) never move,
+// so cracks can't open up, at the cost of simplifying less around them
+namespace MeshSimplifier {
+
+// positions are x, y, z floats, indices a triangle list
+// stops once the index count is at or below targetIndexCount, or when the next collapse would move the
+// surface further than maxError (in the units of the positions)
+std::vector<uint32_t> simplify(const float *positions, size_t vertexCount, const std::vector<uint32_t> &indices, size_t targetIndexCount, float maxError);
+
+} // namespace MeshSimplifier
+
+#endif // MESHSIMPLIFIER_H
@@ -0,0 +1,268 @@
+#include "Profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Profiler {
+
+// per thread and per capture, the rest of the zones are dropped (and counted)
+static const size_t MAX_EVENTS_PER_THREAD = 1 << 16;
+
+struct Event
+{
+    const char *name;
+    uint64_t startNs;
+    uint64_t endNs;
+};
+
+// only ever written by the thread it belongs to, read by endCapture() up to count
+struct ThreadBuffer
+{
+    uint32_t id = 0;
+    std::string name; // NOTE: guarded by gBuffersMutex
+    std::unique_ptr<Event[]> events; // allocated by the first zone recorded in this thread
+    std::atomic<size_t> count{0};
+    std::atomic<size_t> dropped{0};
+    std::atomic<uint32_t> generation{0}; // the capture the events belong to
+    bool isTrack = false; // not a thread, see recordZone()
+};
+
+static const std::chrono::steady_clock::time_point gEpoch = std::chrono::steady_clock::now();
+static std::atomic<bool> gCapturing(false);
+static std::atomic<uint32_t> gGeneration(0);
+static std::mutex gBuffersMutex;
+// NOTE: shared, so the events of threads that exited before the capture was written aren't lost; the buffers of
+// threads that exited (only gBuffers still holds them) are dropped by the next beginCapture()
+static std::vector<std::shared_ptr<ThreadBuffer>> gBuffers;
+static uint32_t gNextBufferId = 1; // NOTE: guarded by gBuffersMutex, ids aren't reused once a buffer is dropped
+
+static uint64_t nowNs()
+{
+    // NOTE: + 1 so 0 can mean "not recording"
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - gEpoch).count()) + 1;
+}
+
+// NOTE: the caller has to hold gBuffersMutex
+static std::shared_ptr<ThreadBuffer> addBuffer(const std::string &name)
+{
+    std::shared_ptr<ThreadBuffer> buffer = std::make_shared<ThreadBuffer>();
+    buffer->id = gNextBufferId++;
+    buffer->name = name;
+    gBuffers.push_back(buffer);
+    return buffer;
+}
+
+static ThreadBuffer & getThreadBuffer()
+{
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if (!buffer)
+    {
+        std::lock_guard<std::mutex> lock(gBuffersMutex);
+        buffer = addBuffer(std::string());
+    }
+    return *buffer;
+}
+
+static ThreadBuffer & getTrackBuffer(const char *track)
+{
+    // NOTE: tracks are few and looked up once per zone, a linear search is fine
+    std::lock_guard<std::mutex> lock(gBuffersMutex);
+    for (const std::shared_ptr<ThreadBuffer> &buffer : gBuffers)
+    {
+        if (buffer->isTrack && buffer->name == track)
+            return *buffer;
+    }
+    std::shared_ptr<ThreadBuffer> buffer = addBuffer(track);
+    buffer->isTrack = true;
+    return *buffer;
+}
+
+static void recordEvent(ThreadBuffer &buffer, const char *name, uint64_t startNs, uint64_t endNs)
+{
+    const uint32_t generation = gGeneration.load(std::memory_order_acquire);
+    if (buffer.generation.load(std::memory_order_relaxed) != generation)
+    {
+        // the first zone of this thread in a new capture drops the events of the previous one
+        buffer.count.store(0, std::memory_order_relaxed);
+        buffer.dropped.store(0, std::memory_order_relaxed);
+        buffer.generation.store(generation, std::memory_order_release);
+    }
+    if (!buffer.events)
+        buffer.events.reset(new Event[MAX_EVENTS_PER_THREAD]);
+    const size_t count = buffer.count.load(std::memory_order_relaxed);
+    if (count == MAX_EVENTS_PER_THREAD)
+    {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[count] = {name, startNs, endNs};
+    // NOTE: publishes the event to endCapture()
+    buffer.count.store(count + 1, std::memory_order_release);
+}
+
+static void writeJsonString(std::ostream &out, const char *text)
+{
+    out << '"';
+    for (const char *c = text; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            out << '\\' << *c;
+        else if (static_cast<unsigned char>(*c) < 0x20)
+            out << ' ';
+        else
+            out << *c;
+    }
+    out << '"';
+}
+
+Zone::Zone(const char *name) :
+    mName(name),
+    mStartNs(gCapturing.load(std::memory_order_relaxed) ? nowNs() : 0)
+{
+}
+
+Zone::~Zone()
+{
+    if (mStartNs)
+        recordEvent(getThreadBuffer(), mName, mStartNs, nowNs());
+}
+
+void setThreadName(const std::string &name)
+{
+    ThreadBuffer &buffer = getThreadBuffer();
+    std::lock_guard<std::mutex> lock(gBuffersMutex);
+    buffer.name = name;
+}
+
+void beginCapture()
+{
+    {
+        // the threads that exited since the last capture, their events (and names) were written or are dropped now
+        // NOTE: a live thread's thread_local holds another reference, the tracks are kept for their names
+        std::lock_guard<std::mutex> lock(gBuffersMutex);
+        gBuffers.erase(std::remove_if(gBuffers.begin(), gBuffers.end(), [](const std::shared_ptr<ThreadBuffer> &buffer) {
+            return !buffer->isTrack && buffer.use_count() == 1;
+        }), gBuffers.end());
+    }
+    gGeneration.fetch_add(1, std::memory_order_release);
+    gCapturing.store(true, std::memory_order_release);
+}
+
+bool isCapturing()
+{
+    return gCapturing.load(std::memory_order_relaxed);
+}
+
+unsigned long long getTimeNs()
+{
+    return nowNs();
+}
+
+void recordZone(const char *track, const char *name, unsigned long long startNs, unsigned long long endNs)
+{
+    if (isCapturing() && startNs && endNs >= startNs)
+        recordEvent(getTrackBuffer(track), name, startNs, endNs);
+}
+
+bool endCapture(const std::string &path)
+{
+    gCapturing.store(false, std::memory_order_release);
+    const uint32_t generation = gGeneration.load(std::memory_order_acquire);
+
+    std::ofstream out(path);
+    if (!out)
+    {
+        std::cerr << "error: could not write the profiler capture to \"" << path << "\"" << std::endl;
+        return false;
+    }
+    // NOTE: the trace-event timestamps are in microseconds, the fractional part keeps the nanoseconds
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    size_t numEvents = 0, numDropped = 0;
+    std::lock_guard<std::mutex> lock(gBuffersMutex);
+    for (const std::shared_ptr<ThreadBuffer> &buffer : gBuffers)
+    {
+        if (!buffer->name.empty())
+        {
+            out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":";
+            writeJsonString(out, buffer->name.c_str());
+            out << "}}";
+            first = false;
+        }
+        // NOTE: a thread that hasn't recorded anything since the capture started still holds an older one
+        if (buffer->generation.load(std::memory_order_acquire) != generation)
+            continue;
+        const size_t count = buffer->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Event &event = buffer->events[i];
+            out << (first ? "" : ",") << "\n{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                << ",\"ts\":" << event.startNs / 1000.0
+                << ",\"dur\":" << (event.endNs - event.startNs) / 1000.0 << "}";
+            first = false;
+        }
+        numEvents += count;
+        numDropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    out << "\n]}\n";
+    out.close();
+    if (!out)
+    {
+        std::cerr << "error: could not write the profiler capture to \"" << path << "\"" << std::endl;
+        return false;
+    }
+    std::cout << "Profiler: wrote " << numEvents << " zones to \"" << path << "\"" << std::endl;
+    if (numDropped)
+        std::cerr << "warning: the profiler dropped " << numDropped << " zones, more than " << MAX_EVENTS_PER_THREAD << " per thread" << std::endl;
+    return true;
+}
+
+} // namespace Profiler
+
+#else
+
+namespace Profiler {
+
+void setThreadName(const std::string &)
+{
+}
+
+void beginCapture()
+{
+}
+
+bool isCapturing()
+{
+    return false;
+}
+
+bool endCapture(const std::string &)
+{
+    return false;
+}
+
+unsigned long long getTimeNs()
+{
+    return 0;
+}
+
+void recordZone(const char *, const char *, unsigned long long, unsigned long long)
+{
+}
+
+} // namespace Profiler
+
+#endif // ENABLE_PROFILER
@@ -0,0 +1,54 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+
+// a scoped-zone CPU profiler: PROFILE_ZONE("name") records the time until the end of the enclosing scope
+//
+// every thread records into its own buffer, so zones never lock; nothing is recorded unless a capture is running,
+// and a capture is written as Chrome trace-event JSON (chrome://tracing or https://ui.perfetto.dev)
+//
+// without ENABLE_PROFILER (a CMake option) the macros compile to nothing and the functions do nothing
+namespace Profiler {
+
+// zone names must be string literals (or otherwise outlive the capture), they aren't copied
+class Zone
+{
+public:
+#ifdef ENABLE_PROFILER
+    explicit Zone(const char *name);
+    ~Zone();
+protected:
+    const char *mName;
+    unsigned long long mStartNs; // NOTE: 0 when there was no capture running at the start of the zone
+#else
+    explicit Zone(const char *) {}
+#endif // ENABLE_PROFILER
+};
+
+// names the calling thread in the capture (e.g. "Main", "Worker 1")
+void setThreadName(const std::string &name);
+// drops whatever was recorded before and starts recording
+void beginCapture();
+bool isCapturing();
+// stops recording and writes the capture to path, returns false on failure
+bool endCapture(const std::string &path);
+// the clock of the zones, in nanoseconds
+unsigned long long getTimeNs();
+// records a zone measured some other way (e.g. by GpuTimer) on a track of its own, e.g. "GPU"
+// NOTE: from one thread per track, like the zones
+void recordZone(const char *track, const char *name, unsigned long long startNs, unsigned long long endNs);
+
+} // namespace Profiler
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#else
+#define PROFILE_ZONE(name) do {} while (false)
+#define PROFILE_FUNCTION() do {} while (false)
+#endif // ENABLE_PROFILER
+
+#endif // PROFILER_H
@@ -0,0 +1,577 @@
+#include "RenderInterface_Ogre.h"
+
+#include <OgreRoot.h>
+#include <OgreRenderSystem.h>
+#include <OgreRenderSystemCapabilities.h>
+#include <OgreRenderPassDescriptor.h>
+#include <OgreHighLevelGpuProgramManager.h>
+#include <OgreHlmsManager.h>
+#include <OgreHlmsSamplerblock.h>
+#include <OgreTextureGpuManager.h>
+#include <OgreStagingTexture.h>
+#include <OgrePixelFormatGpuUtils.h>
+#include <OgreImage2.h>
+#include <OgreDataStream.h>
+#include <OgreException.h>
+#include <OgreMatrix4.h>
+#include <Vao/OgreVaoManager.h>
+#include <Vao/OgreIndirectBufferPacked.h>
+#include <Vao/OgreVertexArrayObject.h>
+#include <CommandBuffer/OgreCbDrawCall.h>
+
+#include <RmlUi/Core/Core.h>
+#include <RmlUi/Core/FileInterface.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// NOTE: Ogre's GL3+ render system binds vertex attributes by name: "vertex" is VES_POSITION, "colour" VES_DIFFUSE and "uv0" the first VES_TEXTURE_COORDINATES
+static const char VERTEX_SHADER_SOURCE[] = R"(#version 330 core
+in vec2 vertex;
+in vec4 colour;
+in vec2 uv0;
+
+uniform mat4 projection;
+uniform vec4 translation;
+
+out vec2 fragUv;
+out vec4 fragColour;
+
+void main()
+{
+    fragUv = uv0;
+    fragColour = colour;
+    gl_Position = projection * vec4(vertex + translation.xy, 0.0, 1.0);
+}
+)";
+
+// RmlUi colours and textures are premultiplied sRGB, but the window is sRGB with gamma conversion enabled,
+// so the colour is converted to (premultiplied) linear and the hardware converts it back when writing
+static const char PIXEL_SHADER_SOURCE[] = R"(#version 330 core
+uniform sampler2D tex;
+
+in vec2 fragUv;
+in vec4 fragColour;
+
+out vec4 outColour;
+
+void main()
+{
+    vec4 colour = texture(tex, fragUv) * fragColour;
+    vec3 straight = colour.a > 0.0 ? colour.rgb / colour.a : vec3(0.0);
+    outColour = vec4(pow(straight, vec3(2.2)) * colour.a, colour.a);
+}
+)";
+
+// the layer texture already has what PIXEL_SHADER_SOURCE wrote into it, premultiplied linear colour
+static const char COMPOSITE_PIXEL_SHADER_SOURCE[] = R"(#version 330 core
+uniform sampler2D tex;
+
+in vec2 fragUv;
+in vec4 fragColour;
+
+out vec4 outColour;
+
+void main()
+{
+    outColour = texture(tex, fragUv);
+}
+)";
+
+static_assert(sizeof(Rml::Vertex) == 20, "the vertex layout below has to match Rml::Vertex");
+
+static Ogre::VertexElement2Vec getVertexElements()
+{
+    Ogre::VertexElement2Vec vertexElements;
+    vertexElements.push_back(Ogre::VertexElement2(Ogre::VET_FLOAT2, Ogre::VES_POSITION));
+    vertexElements.push_back(Ogre::VertexElement2(Ogre::VET_UBYTE4_NORM, Ogre::VES_DIFFUSE));
+    vertexElements.push_back(Ogre::VertexElement2(Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES));
+    return vertexElements;
+}
+
+// the part of the PSO that depends on the render target, filled in like Hlms does for its own passes
+static Ogre::HlmsPassPso getPassPso(Ogre::RenderSystem *renderSystem, const Ogre::RenderPassDescriptor *renderPassDesc, const Ogre::TextureGpu *anyTarget)
+{
+    Ogre::HlmsPassPso passPso;
+    // NOTE: HlmsPassPso is compared with memcmp, so the padding has to be zeroed too
+    memset(&passPso, 0, sizeof(passPso));
+    passPso.stencilParams = renderSystem->getStencilBufferParams();
+    for (size_t i = 0; i < renderPassDesc->getNumColourEntries(); ++i)
+    {
+        if (renderPassDesc->mColour[i].texture)
+            passPso.colourFormat[i] = renderPassDesc->mColour[i].texture->getPixelFormat();
+    }
+    if (renderPassDesc->mDepth.texture)
+        passPso.depthFormat = renderPassDesc->mDepth.texture->getPixelFormat();
+    passPso.sampleDescription = anyTarget->getSampleDescription();
+    passPso.adapterId = 1; // NOTE: same as Hlms, there is only ever one adapter
+    return passPso;
+}
+
+bool RenderInterface_Ogre::DrawCommand::operator==(const DrawCommand &other) const
+{
+    return geometry == other.geometry && translation == other.translation && texture == other.texture &&
+        scissorEnabled == other.scissorEnabled && (!scissorEnabled || scissorRegion == other.scissorRegion);
+}
+
+RenderInterface_Ogre::RenderInterface_Ogre() :
+    mRenderSystem(Ogre::Root::getSingleton().getRenderSystem()),
+    mIndirectBuffers(mRenderSystem->getCapabilities()->hasCapability(Ogre::RSC_INDIRECT_BUFFER)),
+    mViewportWidth(1),
+    mViewportHeight(1),
+    mPsoCreated(false),
+    mSamplerblock(nullptr),
+    mWhiteTexture(nullptr),
+    mRenderPassDesc(nullptr),
+    mAnyTarget(nullptr),
+    mMipLevel(0),
+    mScissorEnabled(false),
+    mScissorRegion(0.0f, 0.0f, 1.0f, 1.0f),
+    mRetained(false),
+    mRecording(false),
+    mLayerDirty(true),
+    mLayerTexture(nullptr),
+    mLayerPassDesc(nullptr),
+    mLayerQuad(0),
+    mLayerPsoCreated(false),
+    mCompositePsoCreated(false),
+    mNumLayerUpdates(0)
+{
+    _CreateShaders();
+
+    Ogre::HlmsManager * const hlmsManager = Ogre::Root::getSingleton().getHlmsManager();
+    mPso.initialize();
+    mPso.vertexShader = mVertexShader;
+    mPso.pixelShader = mPixelShader;
+    mPso.operationType = Ogre::OT_TRIANGLE_LIST;
+    mPso.vertexElements.push_back(getVertexElements());
+    {
+        Ogre::HlmsMacroblock macroblock;
+        macroblock.mDepthCheck = false;
+        macroblock.mDepthWrite = false;
+        macroblock.mCullMode = Ogre::CULL_NONE;
+        macroblock.mScissorTestEnabled = true; // NOTE: with the scissor region covering the whole viewport when RmlUi disables it
+        mPso.macroblock = hlmsManager->getMacroblock(macroblock);
+    }
+    {
+        Ogre::HlmsBlendblock blendblock;
+        blendblock.mSourceBlendFactor = Ogre::SBF_ONE;
+        blendblock.mDestBlendFactor = Ogre::SBF_ONE_MINUS_SOURCE_ALPHA;
+        blendblock.mSourceBlendFactorAlpha = Ogre::SBF_ONE;
+        blendblock.mDestBlendFactorAlpha = Ogre::SBF_ONE_MINUS_SOURCE_ALPHA;
+        blendblock.mSeparateBlend = false;
+        mPso.blendblock = hlmsManager->getBlendblock(blendblock);
+    }
+    {
+        Ogre::HlmsSamplerblock samplerblock;
+        samplerblock.mMinFilter = Ogre::FO_LINEAR;
+        samplerblock.mMagFilter = Ogre::FO_LINEAR;
+        samplerblock.mMipFilter = Ogre::FO_NONE;
+        samplerblock.setAddressingMode(Ogre::TAM_CLAMP);
+        mSamplerblock = hlmsManager->getSamplerblock(samplerblock);
+    }
+    // NOTE: the blending is the same, premultiplied "over" blending onto a cleared layer and then the layer onto
+    // the window gives the same result as blending everything onto the window
+    mLayerPso = mPso;
+    mCompositePso = mPso;
+    mCompositePso.pixelShader = mCompositePixelShader;
+
+    const Rml::byte white[4] = {255, 255, 255, 255};
+    mWhiteTexture = _CreateTexture(white, 1, 1, sizeof(white));
+}
+
+RenderInterface_Ogre::~RenderInterface_Ogre()
+{
+    // NOTE: the geometry and textures RmlUi created are already released by Rml::Shutdown()
+    _DestroyLayer();
+    if (mPsoCreated)
+        mRenderSystem->_hlmsPipelineStateObjectDestroyed(&mPso);
+    if (mLayerPsoCreated)
+        mRenderSystem->_hlmsPipelineStateObjectDestroyed(&mLayerPso);
+    if (mCompositePsoCreated)
+        mRenderSystem->_hlmsPipelineStateObjectDestroyed(&mCompositePso);
+    mRenderSystem->getTextureGpuManager()->destroyTexture(mWhiteTexture);
+    Ogre::HlmsManager * const hlmsManager = Ogre::Root::getSingleton().getHlmsManager();
+    hlmsManager->destroySamplerblock(mSamplerblock);
+    hlmsManager->destroyBlendblock(mPso.blendblock);
+    hlmsManager->destroyMacroblock(mPso.macroblock);
+}
+
+void RenderInterface_Ogre::SetViewport(int width, int height)
+{
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    if (width == mViewportWidth && height == mViewportHeight)
+        return;
+    mViewportWidth = width;
+    mViewportHeight = height;
+    _DestroyLayer(); // NOTE: made again at the new size when needed
+}
+
+void RenderInterface_Ogre::BeginFrame(Ogre::RenderPassDescriptor *renderPassDesc, Ogre::TextureGpu *anyTarget, Ogre::uint8 mipLevel)
+{
+    mRenderPassDesc = renderPassDesc;
+    mAnyTarget = anyTarget;
+    mMipLevel = mipLevel;
+    mScissorEnabled = false;
+    _UpdatePso(mPso, mPsoCreated, mRenderPassDesc, mAnyTarget);
+    _ApplyScissor();
+    _SetPso(mPso);
+}
+
+void RenderInterface_Ogre::EndFrame()
+{
+    mRenderPassDesc = nullptr;
+    mAnyTarget = nullptr;
+}
+
+void RenderInterface_Ogre::SetRetained(bool retained)
+{
+    mRetained = retained;
+    if (!retained)
+        _DestroyLayer();
+}
+
+void RenderInterface_Ogre::BeginRecording()
+{
+    mRecording = true;
+    mCommands.clear();
+    mScissorEnabled = false;
+}
+
+bool RenderInterface_Ogre::EndRecording()
+{
+    mRecording = false;
+    if (!mLayerTexture)
+        _CreateLayer();
+    if (!mLayerDirty && mCommands == mLayerCommands)
+        return false;
+
+    // draw the recorded calls into the layer, like BeginFrame() and RenderGeometry() do into the window
+    mRenderPassDesc = mLayerPassDesc;
+    mAnyTarget = mLayerTexture;
+    mMipLevel = 0;
+    _UpdatePso(mLayerPso, mLayerPsoCreated, mLayerPassDesc, mLayerTexture);
+    mScissorEnabled = false;
+    _ApplyScissor();
+    mRenderSystem->executeRenderPassDescriptorDelayedActions(); // NOTE: clears the layer
+    // NOTE: drawn upside down if the render system stores render targets that way (i.e. OpenGL), like Ogre does
+    // with its own cameras; the scissor rectangle is only converted to the render system's convention for windows
+    _SetPso(mLayerPso, mLayerTexture->requiresTextureFlipping());
+    for (const DrawCommand &command : mCommands)
+    {
+        if (command.scissorEnabled != mScissorEnabled || (command.scissorEnabled && command.scissorRegion != mScissorRegion))
+        {
+            mScissorEnabled = command.scissorEnabled;
+            mScissorRegion = command.scissorRegion;
+            _ApplyScissor();
+        }
+        _Draw(command.geometry, command.translation, command.texture);
+    }
+    mRenderSystem->endRenderPassDescriptor();
+    mRenderPassDesc = nullptr;
+    mAnyTarget = nullptr;
+
+    mLayerCommands.swap(mCommands);
+    mLayerDirty = false;
+    mNumLayerUpdates++;
+    return true;
+}
+
+void RenderInterface_Ogre::DrawLayer()
+{
+    if (!mLayerTexture || !mRenderPassDesc)
+        return;
+    _UpdatePso(mCompositePso, mCompositePsoCreated, mRenderPassDesc, mAnyTarget);
+    _SetPso(mCompositePso);
+    _Draw(reinterpret_cast<const Geometry *>(mLayerQuad), Rml::Vector2f(0.0f, 0.0f), reinterpret_cast<Rml::TextureHandle>(mLayerTexture));
+}
+
+Rml::CompiledGeometryHandle RenderInterface_Ogre::CompileGeometry(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices)
+{
+    if (vertices.empty() || indices.empty())
+        return 0;
+    Ogre::VaoManager * const vaoManager = mRenderSystem->getVaoManager();
+    // NOTE: immutable buffers copy the data right away, RmlUi doesn't keep it around for us
+    Ogre::VertexBufferPacked * const vb = vaoManager->createVertexBuffer(
+        getVertexElements(), vertices.size(), Ogre::BT_IMMUTABLE, const_cast<Rml::Vertex *>(vertices.data()), false);
+    Ogre::IndexBufferPacked * const ib = vaoManager->createIndexBuffer(
+        Ogre::IndexBufferPacked::IT_32BIT, indices.size(), Ogre::BT_IMMUTABLE, const_cast<int *>(indices.data()), false);
+    Ogre::VertexArrayObject * const vao = vaoManager->createVertexArrayObject({vb}, ib, Ogre::OT_TRIANGLE_LIST);
+
+    // NOTE: the buffers are suballocated from bigger ones, hence the offsets
+    Ogre::CbDrawIndexed drawIndexed;
+    drawIndexed.primCount = static_cast<Ogre::uint32>(indices.size());
+    drawIndexed.instanceCount = 1u;
+    drawIndexed.firstVertexIndex = static_cast<Ogre::uint32>(ib->_getFinalBufferStart());
+    drawIndexed.baseVertex = static_cast<Ogre::uint32>(vb->_getFinalBufferStart());
+    drawIndexed.baseInstance = 0u;
+    Ogre::IndirectBufferPacked * const indirectBuffer = vaoManager->createIndirectBuffer(
+        sizeof(Ogre::CbDrawIndexed), Ogre::BT_IMMUTABLE, &drawIndexed, false);
+    return reinterpret_cast<Rml::CompiledGeometryHandle>(new Geometry{vao, indirectBuffer});
+}
+
+void RenderInterface_Ogre::RenderGeometry(Rml::CompiledGeometryHandle handle, Rml::Vector2f translation, Rml::TextureHandle texture)
+{
+    if (!handle)
+        return;
+    const Geometry * const geometry = reinterpret_cast<const Geometry *>(handle);
+    if (mRecording)
+    {
+        mCommands.push_back({geometry, translation, texture, mScissorEnabled, mScissorRegion});
+        return;
+    }
+    if (mRenderPassDesc)
+        _Draw(geometry, translation, texture);
+}
+
+void RenderInterface_Ogre::ReleaseGeometry(Rml::CompiledGeometryHandle handle)
+{
+    Geometry * const geometry = reinterpret_cast<Geometry *>(handle);
+    if (!geometry)
+        return;
+    mLayerDirty = true;
+    Ogre::VaoManager * const vaoManager = mRenderSystem->getVaoManager();
+    Ogre::VertexBufferPacked * const vb = geometry->vao->getVertexBuffers()[0];
+    Ogre::IndexBufferPacked * const ib = geometry->vao->getIndexBuffer();
+    vaoManager->destroyVertexArrayObject(geometry->vao);
+    vaoManager->destroyVertexBuffer(vb);
+    vaoManager->destroyIndexBuffer(ib);
+    vaoManager->destroyIndirectBuffer(geometry->indirectBuffer);
+    delete geometry;
+}
+
+Rml::TextureHandle RenderInterface_Ogre::LoadTexture(Rml::Vector2i &texture_dimensions, const Rml::String &source)
+{
+    // read through RmlUi's file interface, so the path resolves the same way as for documents
+    Rml::FileInterface * const fileInterface = Rml::GetFileInterface();
+    const Rml::FileHandle file = fileInterface->Open(source);
+    if (!file)
+    {
+        std::cerr << "error: couldn't open texture \"" << source << "\"" << std::endl;
+        return 0;
+    }
+    std::vector<char> fileData(fileInterface->Length(file));
+    const size_t bytesRead = fileInterface->Read(fileData.data(), fileData.size(), file);
+    fileInterface->Close(file);
+    if (bytesRead != fileData.size())
+    {
+        std::cerr << "error: couldn't read texture \"" << source << "\"" << std::endl;
+        return 0;
+    }
+
+    const size_t extensionPos = source.rfind('.');
+    const Ogre::String extension = extensionPos != Rml::String::npos ? source.substr(extensionPos + 1) : Ogre::String();
+    Ogre::Image2 image;
+    try
+    {
+        // NOTE: the stream doesn't own the data, fileData outlives it
+        Ogre::DataStreamPtr stream(OGRE_NEW Ogre::MemoryDataStream(fileData.data(), fileData.size(), false, true));
+        image.load(stream, extension);
+    }
+    catch (const Ogre::Exception &e)
+    {
+        std::cerr << "error: couldn't decode texture \"" << source << "\": " << e.getDescription() << std::endl;
+        return 0;
+    }
+
+    // convert to RGBA8 and premultiply the alpha, which is what RmlUi expects from textures
+    const Ogre::uint32 width = image.getWidth();
+    const Ogre::uint32 height = image.getHeight();
+    std::vector<Rml::byte> pixels(size_t(width) * height * 4);
+    Ogre::TextureBox dstBox(width, height, 1u, 1u, 4u, width * 4u, width * height * 4u);
+    dstBox.data = pixels.data();
+    Ogre::PixelFormatGpuUtils::bulkPixelConversion(image.getData(0), image.getPixelFormat(), dstBox, Ogre::PFG_RGBA8_UNORM);
+    for (size_t i = 0; i < pixels.size(); i += 4)
+    {
+        const unsigned int alpha = pixels[i + 3];
+        for (size_t j = 0; j < 3; ++j)
+            pixels[i + j] = static_cast<Rml::byte>((pixels[i + j] * alpha + 127u) / 255u);
+    }
+
+    texture_dimensions = Rml::Vector2i(static_cast<int>(width), static_cast<int>(height));
+    return reinterpret_cast<Rml::TextureHandle>(_CreateTexture(pixels.data(), width, height, width * 4u));
+}
+
+Rml::TextureHandle RenderInterface_Ogre::GenerateTexture(Rml::Span<const Rml::byte> source_data, Rml::Vector2i source_dimensions)
+{
+    return reinterpret_cast<Rml::TextureHandle>(_CreateTexture(source_data.data(), source_dimensions.x, source_dimensions.y, size_t(source_dimensions.x) * 4u));
+}
+
+void RenderInterface_Ogre::ReleaseTexture(Rml::TextureHandle texture_handle)
+{
+    if (Ogre::TextureGpu * const texture = reinterpret_cast<Ogre::TextureGpu *>(texture_handle))
+    {
+        mLayerDirty = true;
+        mRenderSystem->getTextureGpuManager()->destroyTexture(texture);
+    }
+}
+
+void RenderInterface_Ogre::EnableScissorRegion(bool enable)
+{
+    if (enable == mScissorEnabled)
+        return;
+    mScissorEnabled = enable;
+    _ApplyScissor();
+}
+
+void RenderInterface_Ogre::SetScissorRegion(Rml::Rectanglei region)
+{
+    mScissorRegion = Ogre::Vector4(
+        static_cast<Ogre::Real>(region.Left()) / mViewportWidth,
+        static_cast<Ogre::Real>(region.Top()) / mViewportHeight,
+        static_cast<Ogre::Real>(region.Width()) / mViewportWidth,
+        static_cast<Ogre::Real>(region.Height()) / mViewportHeight);
+    if (mScissorEnabled)
+        _ApplyScissor();
+}
+
+void RenderInterface_Ogre::_CreateShaders()
+{
+    Ogre::HighLevelGpuProgramManager &programManager = Ogre::HighLevelGpuProgramManager::getSingleton();
+    const Ogre::String &group = Ogre::ResourceGroupManager::INTERNAL_RESOURCE_GROUP_NAME;
+
+    Ogre::HighLevelGpuProgramPtr vertexShader = programManager.createProgram("RmlUi/VertexShader", group, "glsl", Ogre::GPT_VERTEX_PROGRAM);
+    vertexShader->setSource(VERTEX_SHADER_SOURCE);
+    vertexShader->load();
+    mVertexShader = vertexShader;
+    mVertexParams = vertexShader->createParameters();
+
+    Ogre::HighLevelGpuProgramPtr pixelShader = programManager.createProgram("RmlUi/PixelShader", group, "glsl", Ogre::GPT_FRAGMENT_PROGRAM);
+    pixelShader->setSource(PIXEL_SHADER_SOURCE);
+    pixelShader->load();
+    mPixelShader = pixelShader;
+
+    Ogre::HighLevelGpuProgramPtr compositePixelShader = programManager.createProgram("RmlUi/CompositePixelShader", group, "glsl", Ogre::GPT_FRAGMENT_PROGRAM);
+    compositePixelShader->setSource(COMPOSITE_PIXEL_SHADER_SOURCE);
+    compositePixelShader->load();
+    mCompositePixelShader = compositePixelShader;
+}
+
+void RenderInterface_Ogre::_UpdatePso(Ogre::HlmsPso &pso, bool &created, const Ogre::RenderPassDescriptor *renderPassDesc, const Ogre::TextureGpu *anyTarget)
+{
+    // the PSO only has to be recreated when the render target's formats change, i.e. practically never
+    const Ogre::HlmsPassPso passPso = getPassPso(mRenderSystem, renderPassDesc, anyTarget);
+    if (created && pso.pass == passPso)
+        return;
+    if (created)
+        mRenderSystem->_hlmsPipelineStateObjectDestroyed(&pso);
+    pso.pass = passPso;
+    mRenderSystem->_hlmsPipelineStateObjectCreated(&pso);
+    created = true;
+}
+
+void RenderInterface_Ogre::_SetPso(Ogre::HlmsPso &pso, bool flipY)
+{
+    mRenderSystem->_setPipelineStateObject(&pso);
+    mRenderSystem->_setHlmsSamplerblock(0, mSamplerblock);
+
+    // RmlUi's coordinates are in pixels with the origin in the top left corner
+    const float yScale = flipY ? 2.0f / mViewportHeight : -2.0f / mViewportHeight;
+    const Ogre::Matrix4 projection(
+        2.0f / mViewportWidth, 0.0f, 0.0f, -1.0f,
+        0.0f, yScale, 0.0f, flipY ? -1.0f : 1.0f,
+        0.0f, 0.0f, -1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f);
+    mVertexParams->setNamedConstant("projection", projection);
+}
+
+void RenderInterface_Ogre::_ApplyScissor()
+{
+    if (!mRenderPassDesc)
+        return;
+    // NOTE: beginning the pass that is already active only changes the viewport and scissor, it doesn't flush or clear anything
+    const Ogre::Vector4 viewport(0.0f, 0.0f, 1.0f, 1.0f);
+    const Ogre::Vector4 scissor = mScissorEnabled ? mScissorRegion : viewport;
+    mRenderSystem->beginRenderPassDescriptor(mRenderPassDesc, mAnyTarget, mMipLevel, &viewport, &scissor, 1u, false, false);
+}
+
+void RenderInterface_Ogre::_Draw(const Geometry *geometry, Rml::Vector2f translation, Rml::TextureHandle texture)
+{
+    const float translationValues[4] = {translation.x, translation.y, 0.0f, 0.0f};
+    mVertexParams->setNamedConstant("translation", translationValues, 1, 4);
+    mRenderSystem->bindGpuProgramParameters(Ogre::GPT_VERTEX_PROGRAM, mVertexParams, Ogre::GPV_ALL);
+    mRenderSystem->_setTexture(0, texture ? reinterpret_cast<Ogre::TextureGpu *>(texture) : mWhiteTexture, false);
+    mRenderSystem->_setVertexArrayObject(geometry->vao);
+
+    // the draw call's parameters are read from the indirect buffer, like the ones of the draw calls Ogre's render
+    // queue makes; the offset is the one of the (suballocated) buffer in the buffer bound, which is 0 for the ones
+    // in system memory
+    mRenderSystem->_setIndirectBuffer(geometry->indirectBuffer);
+    void * const offset = reinterpret_cast<void *>(geometry->indirectBuffer->_getFinalBufferStart());
+    const Ogre::CbDrawCallIndexed drawCall(0, geometry->vao, offset);
+    if (mIndirectBuffers)
+        mRenderSystem->_render(&drawCall);
+    else
+        mRenderSystem->_renderEmulated(&drawCall);
+}
+
+void RenderInterface_Ogre::_CreateLayer()
+{
+    Ogre::TextureGpuManager * const textureManager = mRenderSystem->getTextureGpuManager();
+    mLayerTexture = textureManager->createTexture(
+        "RmlUi/Layer", Ogre::GpuPageOutStrategy::Discard, Ogre::TextureFlags::RenderToTexture, Ogre::TextureTypes::Type2D);
+    // NOTE: sRGB like the window, so the blending happens in linear space in both
+    mLayerTexture->setResolution(static_cast<Ogre::uint32>(mViewportWidth), static_cast<Ogre::uint32>(mViewportHeight));
+    mLayerTexture->setPixelFormat(Ogre::PFG_RGBA8_UNORM_SRGB);
+    mLayerTexture->scheduleTransitionTo(Ogre::GpuResidency::Resident);
+
+    mLayerPassDesc = mRenderSystem->createRenderPassDescriptor();
+    mLayerPassDesc->mColour[0].texture = mLayerTexture;
+    mLayerPassDesc->mColour[0].loadAction = Ogre::LoadAction::Clear;
+    mLayerPassDesc->mColour[0].storeAction = Ogre::StoreAction::Store;
+    mLayerPassDesc->mColour[0].clearColour = Ogre::ColourValue(0.0f, 0.0f, 0.0f, 0.0f);
+    mLayerPassDesc->entriesModified(Ogre::RenderPassDescriptor::All);
+
+    // covers the viewport (NOTE: EndRecording() draws the layer upside down when the render system needs it, so the
+    // texture's first row is always the top one)
+    const float width = static_cast<float>(mViewportWidth);
+    const float height = static_cast<float>(mViewportHeight);
+    const Rml::ColourbPremultiplied white(255, 255, 255, 255);
+    const Rml::Vertex vertices[4] = {
+        {Rml::Vector2f(0.0f, 0.0f), white, Rml::Vector2f(0.0f, 0.0f)},
+        {Rml::Vector2f(width, 0.0f), white, Rml::Vector2f(1.0f, 0.0f)},
+        {Rml::Vector2f(width, height), white, Rml::Vector2f(1.0f, 1.0f)},
+        {Rml::Vector2f(0.0f, height), white, Rml::Vector2f(0.0f, 1.0f)}};
+    const int indices[6] = {0, 1, 2, 0, 2, 3};
+    mLayerQuad = CompileGeometry(Rml::Span<const Rml::Vertex>(vertices, 4), Rml::Span<const int>(indices, 6));
+    mLayerCommands.clear();
+    mLayerDirty = true;
+}
+
+void RenderInterface_Ogre::_DestroyLayer()
+{
+    if (!mLayerTexture)
+        return;
+    ReleaseGeometry(mLayerQuad);
+    mLayerQuad = 0;
+    mRenderSystem->destroyRenderPassDescriptor(mLayerPassDesc);
+    mLayerPassDesc = nullptr;
+    mRenderSystem->getTextureGpuManager()->destroyTexture(mLayerTexture);
+    mLayerTexture = nullptr;
+}
+
+Ogre::TextureGpu * RenderInterface_Ogre::_CreateTexture(const Rml::byte *data, int width, int height, size_t bytesPerRow)
+{
+    static unsigned int textureCounter = 0;
+    Ogre::TextureGpuManager * const textureManager = mRenderSystem->getTextureGpuManager();
+    Ogre::TextureGpu * const texture = textureManager->createTexture(
+        "RmlUi/Texture" + std::to_string(textureCounter++), Ogre::GpuPageOutStrategy::Discard, Ogre::TextureFlags::ManualTexture, Ogre::TextureTypes::Type2D);
+    // NOTE: not an sRGB format, the shader does the conversion after blending with the vertex colour
+    texture->setResolution(static_cast<Ogre::uint32>(width), static_cast<Ogre::uint32>(height));
+    texture->setPixelFormat(Ogre::PFG_RGBA8_UNORM);
+    texture->scheduleTransitionTo(Ogre::GpuResidency::Resident);
+
+    Ogre::StagingTexture * const stagingTexture = textureManager->getStagingTexture(texture->getWidth(), texture->getHeight(), 1u, 1u, Ogre::PFG_RGBA8_UNORM);
+    stagingTexture->startMapRegion();
+    Ogre::TextureBox box = stagingTexture->mapRegion(texture->getWidth(), texture->getHeight(), 1u, 1u, Ogre::PFG_RGBA8_UNORM);
+    box.copyFrom(data, texture->getWidth(), texture->getHeight(), bytesPerRow);
+    stagingTexture->stopMapRegion();
+    stagingTexture->upload(box, texture, 0u);
+    textureManager->removeStagingTexture(stagingTexture);
+    texture->notifyDataIsReady();
+    return texture;
+}
@@ -0,0 +1,128 @@
+#ifndef RENDERINTERFACE_OGRE_H
+#define RENDERINTERFACE_OGRE_H
+
+#include <RmlUi/Core/RenderInterface.h>
+
+#include <OgreGpuProgram.h>
+#include <OgreHlmsPso.h>
+#include <OgreVector4.h>
+
+#include <vector>
+
+namespace Ogre {
+
+class IndirectBufferPacked;
+class RenderSystem;
+class RenderPassDescriptor;
+class TextureGpu;
+class VertexArrayObject;
+struct HlmsSamplerblock;
+
+} // namespace Ogre
+
+// RmlUi render interface that draws through Ogre-Next's RenderSystem, so the UI shares the GL context
+// (and the frame) with the 3D scene instead of needing a second context like RenderInterface_GL3
+//
+// the drawing itself happens inside CompositorPassRmlUi, which calls BeginFrame(), Rml::Context::Render()
+// and EndFrame() while the window's render pass is active
+// NOTE: only what the RmlUi GL3 backend calls the "basic" interface is implemented, i.e. no clip masks,
+// transforms, layers or filters
+//
+// in retained mode, Context::Render() only records the draw calls, and they are only drawn (into a texture the size
+// of the viewport) when they differ from the ones drawn last time, or geometry/textures were released since; every
+// frame the texture is then drawn as a single quad, which is all a static UI costs
+class RenderInterface_Ogre : public Rml::RenderInterface
+{
+public:
+    RenderInterface_Ogre();
+    ~RenderInterface_Ogre();
+
+    void SetViewport(int width, int height);
+    // renderPassDesc/anyTarget/mipLevel are the ones of the compositor pass currently executing
+    void BeginFrame(Ogre::RenderPassDescriptor *renderPassDesc, Ogre::TextureGpu *anyTarget, Ogre::uint8 mipLevel);
+    void EndFrame();
+
+    void SetRetained(bool retained);
+    bool IsRetained() const {return mRetained;}
+    // Context::Render() has to be called between these in retained mode, EndRecording() draws the layer texture
+    // again if needed and returns whether it did
+    // NOTE: outside of any render pass, as the layer has its own
+    void BeginRecording();
+    bool EndRecording();
+    // draws the layer texture, between BeginFrame() and EndFrame() instead of Context::Render()
+    void DrawLayer();
+    // how many times the layer texture was drawn again, since the start
+    size_t GetNumLayerUpdates() const {return mNumLayerUpdates;}
+
+    // -- Inherited from Rml::RenderInterface --
+    Rml::CompiledGeometryHandle CompileGeometry(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices) override;
+    void RenderGeometry(Rml::CompiledGeometryHandle handle, Rml::Vector2f translation, Rml::TextureHandle texture) override;
+    void ReleaseGeometry(Rml::CompiledGeometryHandle handle) override;
+
+    Rml::TextureHandle LoadTexture(Rml::Vector2i &texture_dimensions, const Rml::String &source) override;
+    Rml::TextureHandle GenerateTexture(Rml::Span<const Rml::byte> source_data, Rml::Vector2i source_dimensions) override;
+    void ReleaseTexture(Rml::TextureHandle texture_handle) override;
+
+    void EnableScissorRegion(bool enable) override;
+    void SetScissorRegion(Rml::Rectanglei region) override;
+protected:
+    // what a CompiledGeometryHandle points to: the VAO and the indirect buffer with its draw call's parameters,
+    // which never change once the (immutable) buffers exist
+    struct Geometry
+    {
+        Ogre::VertexArrayObject *vao;
+        Ogre::IndirectBufferPacked *indirectBuffer;
+    };
+    // a draw call recorded in retained mode
+    struct DrawCommand
+    {
+        const Geometry *geometry;
+        Rml::Vector2f translation;
+        Rml::TextureHandle texture;
+        bool scissorEnabled;
+        Ogre::Vector4 scissorRegion;
+        bool operator==(const DrawCommand &other) const;
+    };
+    void _CreateShaders();
+    void _UpdatePso(Ogre::HlmsPso &pso, bool &created, const Ogre::RenderPassDescriptor *renderPassDesc, const Ogre::TextureGpu *anyTarget);
+    void _SetPso(Ogre::HlmsPso &pso, bool flipY = false);
+    void _ApplyScissor();
+    void _Draw(const Geometry *geometry, Rml::Vector2f translation, Rml::TextureHandle texture);
+    void _CreateLayer();
+    void _DestroyLayer();
+    Ogre::TextureGpu * _CreateTexture(const Rml::byte *data, int width, int height, size_t bytesPerRow);
+protected:
+    Ogre::RenderSystem *mRenderSystem;
+    bool mIndirectBuffers; // RSC_INDIRECT_BUFFER, otherwise the indirect buffers are in system memory and the draw calls emulated
+    int mViewportWidth, mViewportHeight;
+    Ogre::GpuProgramPtr mVertexShader;
+    Ogre::GpuProgramPtr mPixelShader;
+    Ogre::GpuProgramPtr mCompositePixelShader; // draws the layer texture as is
+    Ogre::GpuProgramParametersSharedPtr mVertexParams;
+    Ogre::HlmsPso mPso;
+    bool mPsoCreated;
+    const Ogre::HlmsSamplerblock *mSamplerblock;
+    Ogre::TextureGpu *mWhiteTexture; // bound for geometry without a texture, so there is only one shader
+    // state of the frame in progress
+    Ogre::RenderPassDescriptor *mRenderPassDesc;
+    Ogre::TextureGpu *mAnyTarget;
+    Ogre::uint8 mMipLevel;
+    bool mScissorEnabled;
+    Ogre::Vector4 mScissorRegion; // normalized, like Ogre viewports
+    // retained mode
+    bool mRetained;
+    bool mRecording;
+    bool mLayerDirty; // geometry or textures were released (so a recorded pointer may now be another one)
+    std::vector<DrawCommand> mCommands;
+    std::vector<DrawCommand> mLayerCommands; // the ones in the layer texture
+    Ogre::TextureGpu *mLayerTexture;
+    Ogre::RenderPassDescriptor *mLayerPassDesc;
+    Rml::CompiledGeometryHandle mLayerQuad;
+    Ogre::HlmsPso mLayerPso; // the same as mPso, but for the layer texture's format
+    bool mLayerPsoCreated;
+    Ogre::HlmsPso mCompositePso;
+    bool mCompositePsoCreated;
+    size_t mNumLayerUpdates;
+};
+
+#endif // RENDERINTERFACE_OGRE_H
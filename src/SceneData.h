@@ -0,0 +1,97 @@
+#ifndef SCENEDATA_H
+#define SCENEDATA_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// CPU side representation of an imported scene, this is what the Assimp importer produces
+// and what the mesh cache stores, so that building the Ogre scene doesn't depend on Assimp
+
+struct SceneMaterialData
+{
+    std::string name;
+    float diffuse[3] = {1.0f, 1.0f, 1.0f};
+    float emissive[3] = {0.0f, 0.0f, 0.0f};
+    float roughness = 1.0f;
+    float metalness = 0.0f;
+};
+
+// which channels a mesh's interleaved vertices have, and how they are stored (see VertexFormat.h)
+enum SceneVertexFlags : uint32_t
+{
+    VERTEX_HAS_UV = 1u << 0,
+    VERTEX_HAS_TANGENT = 1u << 1,
+    VERTEX_COMPACT = 1u << 2
+};
+
+// a simplified version of a mesh, its indices reference the vertices of the full resolution mesh
+struct SceneLodData
+{
+    float distance = 0.0f; // camera distance from which this LOD is used
+    uint32_t indexCount = 0; // NOTE: same index size as the mesh
+    const void *indexData = nullptr;
+    std::vector<uint8_t> ownedIndexData;
+};
+
+struct SceneMeshData
+{
+    std::string name;
+    uint32_t materialIndex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t vertexFlags = 0; // SceneVertexFlags
+    uint32_t indexCount = 0;
+    uint32_t indexSize = 2; // bytes per index, 2 or 4
+    float aabbMin[3] = {0.0f, 0.0f, 0.0f};
+    float aabbMax[3] = {0.0f, 0.0f, 0.0f};
+    // NOTE: these either point into the owned buffers below, or into a memory mapped cache file
+    const void *vertexData = nullptr;
+    const void *indexData = nullptr;
+    std::vector<uint8_t> ownedVertexData;
+    std::vector<uint8_t> ownedIndexData;
+    std::vector<SceneLodData> lods; // ordered by distance, empty if LODs weren't generated
+};
+
+struct SceneNodeData
+{
+    int32_t parentIndex = -1; // -1 means the node is attached to the parent node given to the loader
+    float position[3] = {0.0f, 0.0f, 0.0f};
+    float orientation[4] = {1.0f, 0.0f, 0.0f, 0.0f}; // w, x, y, z
+    float scale[3] = {1.0f, 1.0f, 1.0f};
+    std::vector<uint32_t> meshIndices;
+};
+
+enum class SceneLightType : uint32_t
+{
+    Directional = 0,
+    Point = 1,
+    Spot = 2
+};
+
+struct SceneLightData
+{
+    std::string name;
+    SceneLightType type = SceneLightType::Point;
+    float position[3] = {0.0f, 0.0f, 0.0f};
+    float direction[3] = {0.0f, 0.0f, -1.0f};
+    float diffuse[3] = {1.0f, 1.0f, 1.0f};
+    float specular[3] = {1.0f, 1.0f, 1.0f};
+    float innerCone = 0.0f;
+    float outerCone = 0.0f;
+    float attenuationConstant = 1.0f;
+    float attenuationLinear = 0.0f;
+    float attenuationQuadratic = 0.0f;
+};
+
+struct SceneData
+{
+    std::vector<SceneMaterialData> materials;
+    std::vector<SceneMeshData> meshes;
+    std::vector<SceneNodeData> nodes; // NOTE: parents always come before their children
+    std::vector<SceneLightData> lights;
+    uint32_t numSourceItems = 0; // node/mesh pairs in the source file, more than the nodes reference once meshes got merged
+    std::shared_ptr<const void> mapping; // keeps the memory mapped cache file alive (if any)
+};
+
+#endif // SCENEDATA_H
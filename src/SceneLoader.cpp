@@ -1,3 +1,12 @@
+#include "SceneLoader.h"
+#include "SceneData.h"
+#include "MeshCache.h"
+#include "WorkerPool.h"
+#include "VertexFormat.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "Profiler.h"
+
 #include <OgreRoot.h>
 #include <OgreSceneManager.h>
 #include <OgreItem.h>
@@ -5,6 +14,7 @@
 #include <OgreMesh2.h>
 #include <OgreSubMesh2.h>
 // #include <OgreRenderOperation.h>
+#include <OgreLodStrategyManager.h>
 #include <OgreHlmsManager.h>
 #include <OgreHlmsPbsDatablock.h>
 #include <OgreHlmsPbs.h>
@@ -13,57 +23,804 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <string>
+#include <unordered_set>
+
+static const unsigned int ASSIMP_IMPORT_FLAGS =
+    aiProcess_Triangulate |
+    aiProcess_GenSmoothNormals |
+    aiProcess_CalcTangentSpace |
+    aiProcess_JoinIdenticalVertices |
+    aiProcess_RemoveRedundantMaterials |
+    aiProcess_SortByPType;
 
-static void processAssimpLights(const aiScene* scene, Ogre::SceneManager* sceneMgr)
+// NOTE: aiProcess_PreTransformVertices bakes every node's transform into its own copy of the mesh,
+// which throws away exactly the sharing that instancing relies on
+static unsigned int getImportFlags(const SceneLoadOptions &options)
+{
+    return options.instancing ? ASSIMP_IMPORT_FLAGS : ASSIMP_IMPORT_FLAGS | aiProcess_PreTransformVertices;
+}
+
+// the most vertices a 16-bit index buffer can address
+// NOTE: index 0xFFFF is left out on purpose, as it is the primitive restart index for 16-bit buffers
+static const uint32_t MAX_16BIT_VERTICES = std::numeric_limits<uint16_t>::max();
+
+// every LOD level aims for half the triangles of the one before, and may deviate twice as far from the full mesh,
+// while also switching in at twice the distance, so the error stays about the same size on screen
+static const size_t MAX_LOD_LEVELS = 4;
+static const float LOD_ERROR_PER_RADIUS = 0.01f; // allowed error of the first LOD, relative to the mesh's bounding radius
+static const float LOD_DISTANCE_PER_RADIUS = 8.0f; // distance (in bounding radii) at which the first LOD is used
+static const float LOD_MIN_REDUCTION = 0.8f; // a level that keeps more than this fraction of the previous level's indices isn't worth it
+
+// the options that change the converted data, these become part of the mesh cache key
+static uint32_t getOptionFlags(const SceneLoadOptions &options)
+{
+    uint32_t flags = 0;
+    if (options.splitLargeMeshes) flags |= 1u << 0;
+    if (options.vertexCompression == VertexCompression::Compact) flags |= 1u << 1;
+    if (options.instancing) flags |= 1u << 2;
+    if (options.mergeStaticMeshes) flags |= 1u << 3;
+    if (options.generateLods) flags |= 1u << 4;
+    if (options.optimizeMeshes) flags |= 1u << 5;
+    return flags;
+}
+
+typedef std::chrono::steady_clock LoadClock;
+
+static double millisecondsSince(LoadClock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(LoadClock::now() - start).count();
+}
+
+// the transform from a node's space to the scene's space
+static aiMatrix4x4 getGlobalTransform(const aiNode* node)
+{
+    aiMatrix4x4 transform;
+    for (; node; node = node->mParent)
+        transform = node->mTransformation * transform;
+    return transform;
+}
+
+// NOTE: without aiProcess_PreTransformVertices light positions/directions are relative to the node with the same name
+static void importAssimpLights(const aiScene* scene, bool transformToScene, SceneData &sceneData)
 {
-    std::cout << "LIGHTS:" << std::endl;
     for (unsigned int i = 0; i < scene->mNumLights; ++i)
     {
         const aiLight* aiLight = scene->mLights[i];
-        std::cout << "\tLIGHT " << i << " aiLight->mType = " << aiLight->mType << std::endl;
-        Ogre::String lightName = aiLight->mName.C_Str();
-
-        Ogre::Light* light = sceneMgr->createLight();
-        light->setName(lightName);
+        SceneLightData light;
+        light.name = aiLight->mName.C_Str();
 
         switch (aiLight->mType)
         {
         case aiLightSource_DIRECTIONAL:
-            light->setType(Ogre::Light::LT_DIRECTIONAL);
+            light.type = SceneLightType::Directional;
             break;
         case aiLightSource_POINT:
+            light.type = SceneLightType::Point;
+            break;
+        case aiLightSource_SPOT:
+            light.type = SceneLightType::Spot;
+            light.innerCone = aiLight->mAngleInnerCone;
+            light.outerCone = aiLight->mAngleOuterCone;
+            break;
+        default:
+            continue; // Skip unsupported types
+        }
+
+        aiVector3D position = aiLight->mPosition;
+        aiVector3D direction = aiLight->mDirection;
+        const aiNode * const lightNode = transformToScene ? scene->mRootNode->FindNode(aiLight->mName) : nullptr;
+        if (lightNode) {
+            const aiMatrix4x4 transform = getGlobalTransform(lightNode);
+            position = transform * position;
+            direction = aiMatrix3x3(transform) * direction;
+        }
+
+        light.position[0] = position.x;
+        light.position[1] = position.y;
+        light.position[2] = position.z;
+        light.direction[0] = direction.x;
+        light.direction[1] = direction.y;
+        light.direction[2] = direction.z;
+        light.diffuse[0] = aiLight->mColorDiffuse.r;
+        light.diffuse[1] = aiLight->mColorDiffuse.g;
+        light.diffuse[2] = aiLight->mColorDiffuse.b;
+        light.specular[0] = aiLight->mColorSpecular.r;
+        light.specular[1] = aiLight->mColorSpecular.g;
+        light.specular[2] = aiLight->mColorSpecular.b;
+        light.attenuationConstant = aiLight->mAttenuationConstant;
+        light.attenuationLinear = aiLight->mAttenuationLinear;
+        light.attenuationQuadratic = aiLight->mAttenuationQuadratic;
+
+        sceneData.lights.push_back(light);
+    }
+}
+
+static void importAssimpMaterials(const aiScene* scene, SceneData &sceneData)
+{
+    sceneData.materials.resize(scene->mNumMaterials);
+    for (unsigned int i = 0; i < scene->mNumMaterials; ++i)
+    {
+        const aiMaterial * const aiMat = scene->mMaterials[i];
+        SceneMaterialData &material = sceneData.materials[i];
+        material.name = aiMat->GetName().C_Str();
+
+        aiColor4D diffuseColor(1.0f, 1.0f, 1.0f, 1.0f);
+        if (AI_SUCCESS != aiGetMaterialColor(aiMat, AI_MATKEY_BASE_COLOR, &diffuseColor))
+        {
+            // Fall back to diffuse if base color isn't set
+            aiGetMaterialColor(aiMat, AI_MATKEY_COLOR_DIFFUSE, &diffuseColor);
+        }
+        material.diffuse[0] = diffuseColor.r;
+        material.diffuse[1] = diffuseColor.g;
+        material.diffuse[2] = diffuseColor.b;
+
+        aiColor4D emissiveColor(0.0f, 0.0f, 0.0f, 1.0f);
+        if (AI_SUCCESS == aiGetMaterialColor(aiMat, AI_MATKEY_COLOR_EMISSIVE, &emissiveColor))
+        {
+            material.emissive[0] = emissiveColor.r;
+            material.emissive[1] = emissiveColor.g;
+            material.emissive[2] = emissiveColor.b;
+        }
+        aiGetMaterialFloat(aiMat, AI_MATKEY_ROUGHNESS_FACTOR, &material.roughness);
+        aiGetMaterialFloat(aiMat, AI_MATKEY_METALLIC_FACTOR, &material.metalness);
+    }
+}
+
+// the datablock name is derived from the material parameters, so identical materials share a datablock,
+// even when they come from different aiMaterials or different files
+static Ogre::String getDatablockName(const SceneMaterialData &materialData)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto hashFloats = [&hash](const float *values, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            // NOTE: quantized, so values that only differ by float noise still end up sharing a datablock
+            const int32_t quantized = static_cast<int32_t>(std::lround(values[i] * 4096.0f));
+            for (size_t byte = 0; byte < sizeof(quantized); ++byte) {
+                hash ^= (static_cast<uint32_t>(quantized) >> (byte * 8)) & 0xFF;
+                hash *= 0x100000001b3ull;
+            }
+        }
+    };
+    hashFloats(materialData.diffuse, 3);
+    hashFloats(materialData.emissive, 3);
+    hashFloats(&materialData.roughness, 1);
+    hashFloats(&materialData.metalness, 1);
+
+    char name[64];
+    snprintf(name, sizeof(name), "SceneMaterial/%016llx", static_cast<unsigned long long>(hash));
+    return name;
+}
+
+// intermediate, uncompressed form of a mesh used while converting, before it gets packed into a SceneMeshData
+struct WorkingMesh
+{
+    std::vector<float> positions; // x, y, z
+    std::vector<float> normals; // x, y, z
+    std::vector<float> uvs; // u, v (optional)
+    std::vector<float> tangents; // x, y, z, handedness (optional, only together with uvs)
+    std::vector<uint32_t> indices;
+    uint32_t materialIndex = 0;
+
+    uint32_t getVertexCount() const {return static_cast<uint32_t>(positions.size() / 3);}
+    bool hasUvs() const {return !uvs.empty();}
+    bool hasTangents() const {return !tangents.empty();}
+
+    // copies vertex "vertex" of "source" to the end of this mesh
+    void appendVertex(const WorkingMesh &source, uint32_t vertex)
+    {
+        positions.insert(positions.end(), &source.positions[vertex * 3], &source.positions[vertex * 3] + 3);
+        normals.insert(normals.end(), &source.normals[vertex * 3], &source.normals[vertex * 3] + 3);
+        if (source.hasUvs())
+            uvs.insert(uvs.end(), &source.uvs[vertex * 2], &source.uvs[vertex * 2] + 2);
+        if (source.hasTangents())
+            tangents.insert(tangents.end(), &source.tangents[vertex * 4], &source.tangents[vertex * 4] + 4);
+    }
+};
+
+static void readAssimpMesh(const aiMesh* aiMesh, WorkingMesh &mesh)
+{
+    mesh.materialIndex = aiMesh->mMaterialIndex;
+    const bool hasUvs = aiMesh->HasTextureCoords(0);
+    const bool hasTangents = hasUvs && aiMesh->HasTangentsAndBitangents();
+
+    mesh.positions.reserve(aiMesh->mNumVertices * 3);
+    mesh.normals.reserve(aiMesh->mNumVertices * 3);
+    for (unsigned int i = 0; i < aiMesh->mNumVertices; ++i) {
+        const aiVector3D &v = aiMesh->mVertices[i];
+        mesh.positions.insert(mesh.positions.end(), {v.x, v.y, v.z});
+
+        if (aiMesh->HasNormals()) {
+            const aiVector3D &n = aiMesh->mNormals[i];
+            mesh.normals.insert(mesh.normals.end(), {n.x, n.y, n.z});
+        } else {
+            mesh.normals.insert(mesh.normals.end(), {0.0f, 1.0f, 0.0f});
+        }
+
+        if (hasUvs) {
+            const aiVector3D &uv = aiMesh->mTextureCoords[0][i];
+            mesh.uvs.insert(mesh.uvs.end(), {uv.x, uv.y});
+        }
+
+        if (hasTangents) {
+            // the bitangent is reconstructed in the shader, only its direction relative to the normal is kept
+            const aiVector3D &t = aiMesh->mTangents[i];
+            const aiVector3D n = aiMesh->HasNormals() ? aiMesh->mNormals[i] : aiVector3D(0.0f, 1.0f, 0.0f);
+            const float handedness = ((n ^ t) * aiMesh->mBitangents[i]) < 0.0f ? -1.0f : 1.0f;
+            mesh.tangents.insert(mesh.tangents.end(), {t.x, t.y, t.z, handedness});
+        }
+    }
+
+    mesh.indices.reserve(aiMesh->mNumFaces * 3);
+    for (unsigned int i = 0; i < aiMesh->mNumFaces; ++i) {
+        const aiFace &face = aiMesh->mFaces[i];
+        mesh.indices.insert(mesh.indices.end(), face.mIndices, face.mIndices + 3);
+    }
+}
+
+// splits a mesh into parts that each reference at most maxVertices vertices, so they all fit 16-bit indices
+static std::vector<WorkingMesh> splitMesh(const WorkingMesh &mesh, uint32_t maxVertices)
+{
+    std::vector<WorkingMesh> parts;
+    static const uint32_t UNUSED = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> remap(mesh.getVertexCount(), UNUSED);
+    std::vector<uint32_t> usedVertices; // so the remap table can be reset without touching every vertex
+
+    WorkingMesh part;
+    auto finishPart = [&]() {
+        part.materialIndex = mesh.materialIndex;
+        parts.push_back(std::move(part));
+        part = WorkingMesh();
+        for (const uint32_t vertex : usedVertices)
+            remap[vertex] = UNUSED;
+        usedVertices.clear();
+    };
+
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        uint32_t newVertices = 0;
+        for (size_t j = 0; j < 3; ++j) {
+            if (remap[mesh.indices[i + j]] == UNUSED)
+                newVertices++;
+        }
+        if (part.getVertexCount() + newVertices > maxVertices)
+            finishPart();
+
+        for (size_t j = 0; j < 3; ++j) {
+            const uint32_t vertex = mesh.indices[i + j];
+            if (remap[vertex] == UNUSED) {
+                remap[vertex] = part.getVertexCount();
+                usedVertices.push_back(vertex);
+                part.appendVertex(mesh, vertex);
+            }
+            part.indices.push_back(remap[vertex]);
+        }
+    }
+    if (!part.indices.empty() || parts.empty())
+        finishPart();
+    return parts;
+}
+
+template <typename T>
+static void writeVertexValue(uint8_t *&cursor, T value)
+{
+    memcpy(cursor, &value, sizeof(T));
+    cursor += sizeof(T);
+}
+
+// scales a direction by 1/scale and renormalizes it, to cancel out the node scale that undoes position quantization
+static void compensateDirection(const float *direction, const float scale[3], float result[3])
+{
+    float length = 0.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+        result[axis] = direction[axis] / scale[axis];
+        length += result[axis] * result[axis];
+    }
+    length = std::sqrt(length);
+    for (int axis = 0; axis < 3; ++axis)
+        result[axis] = length > 0.0f ? result[axis] / length : 0.0f;
+}
+
+static void packIndices(const std::vector<uint32_t> &indices, uint32_t indexSize, std::vector<uint8_t> &result)
+{
+    result.resize(indices.size() * indexSize);
+    if (indexSize == 2) {
+        uint16_t * const indices16 = reinterpret_cast<uint16_t *>(result.data());
+        for (size_t i = 0; i < indices.size(); ++i)
+            indices16[i] = static_cast<uint16_t>(indices[i]);
+    } else {
+        memcpy(result.data(), indices.data(), result.size());
+    }
+}
+
+// interleaves the vertices, computes the bounds and picks the smallest index type that can address every vertex
+static void packMesh(const WorkingMesh &workingMesh, const std::string &name, VertexCompression compression, SceneMeshData &mesh)
+{
+    mesh.name = name;
+    mesh.materialIndex = workingMesh.materialIndex;
+    mesh.vertexCount = workingMesh.getVertexCount();
+    mesh.indexCount = static_cast<uint32_t>(workingMesh.indices.size());
+    mesh.indexSize = mesh.vertexCount <= MAX_16BIT_VERTICES ? 2 : 4;
+    mesh.vertexFlags = 0;
+    if (workingMesh.hasUvs())
+        mesh.vertexFlags |= VERTEX_HAS_UV;
+    if (workingMesh.hasTangents())
+        mesh.vertexFlags |= VERTEX_HAS_TANGENT;
+    if (compression == VertexCompression::Compact)
+        mesh.vertexFlags |= VERTEX_COMPACT;
+
+    float minBounds[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    float maxBounds[3] = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+    for (uint32_t i = 0; i < mesh.vertexCount; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            minBounds[axis] = std::min(minBounds[axis], workingMesh.positions[i * 3 + axis]);
+            maxBounds[axis] = std::max(maxBounds[axis], workingMesh.positions[i * 3 + axis]);
+        }
+    }
+    if (mesh.vertexCount > 0) {
+        memcpy(mesh.aabbMin, minBounds, sizeof(minBounds));
+        memcpy(mesh.aabbMax, maxBounds, sizeof(maxBounds));
+    }
+
+    const uint32_t stride = VertexFormat::getStride(mesh.vertexFlags);
+    mesh.ownedVertexData.resize(static_cast<size_t>(mesh.vertexCount) * stride);
+    uint8_t *cursor = mesh.ownedVertexData.data();
+    if (mesh.vertexFlags & VERTEX_COMPACT) {
+        float scale[3];
+        VertexFormat::getQuantizationScale(mesh.aabbMin, mesh.aabbMax, scale);
+        for (uint32_t i = 0; i < mesh.vertexCount; ++i) {
+            for (int axis = 0; axis < 3; ++axis)
+                writeVertexValue(cursor, VertexFormat::packUnorm16((workingMesh.positions[i * 3 + axis] - mesh.aabbMin[axis]) / scale[axis]));
+            writeVertexValue(cursor, VertexFormat::packUnorm16(1.0f));
+
+            // the frame's normal and tangent are both pre-divided by the node scale, see compensateDirection()
+            float normal[3];
+            float tangent[3] = {0.0f, 0.0f, 0.0f};
+            float reflection = 1.0f;
+            compensateDirection(&workingMesh.normals[i * 3], scale, normal);
+            if (mesh.vertexFlags & VERTEX_HAS_TANGENT) {
+                compensateDirection(&workingMesh.tangents[i * 4], scale, tangent);
+                reflection = workingMesh.tangents[i * 4 + 3];
+            }
+            int16_t qTangent[4];
+            VertexFormat::packQTangent(normal, tangent, reflection, qTangent);
+            for (int component = 0; component < 4; ++component)
+                writeVertexValue(cursor, qTangent[component]);
+
+            if (mesh.vertexFlags & VERTEX_HAS_UV) {
+                writeVertexValue(cursor, VertexFormat::floatToHalf(workingMesh.uvs[i * 2 + 0]));
+                writeVertexValue(cursor, VertexFormat::floatToHalf(workingMesh.uvs[i * 2 + 1]));
+            }
+        }
+    } else {
+        for (uint32_t i = 0; i < mesh.vertexCount; ++i) {
+            for (int axis = 0; axis < 3; ++axis)
+                writeVertexValue(cursor, workingMesh.positions[i * 3 + axis]);
+            for (int axis = 0; axis < 3; ++axis)
+                writeVertexValue(cursor, workingMesh.normals[i * 3 + axis]);
+            if (mesh.vertexFlags & VERTEX_HAS_UV) {
+                writeVertexValue(cursor, workingMesh.uvs[i * 2 + 0]);
+                writeVertexValue(cursor, workingMesh.uvs[i * 2 + 1]);
+            }
+            if (mesh.vertexFlags & VERTEX_HAS_TANGENT) {
+                for (int component = 0; component < 4; ++component)
+                    writeVertexValue(cursor, workingMesh.tangents[i * 4 + component]);
+            }
+        }
+    }
+
+    packIndices(workingMesh.indices, mesh.indexSize, mesh.ownedIndexData);
+
+    mesh.vertexData = mesh.ownedVertexData.data();
+    mesh.indexData = mesh.ownedIndexData.data();
+}
+
+// builds a chain of simplified index buffers for an already packed mesh, they all share its vertices
+static void generateLods(const WorkingMesh &workingMesh, SceneMeshData &mesh)
+{
+    float radius = 0.0f;
+    for (int axis = 0; axis < 3; ++axis)
+        radius += (mesh.aabbMax[axis] - mesh.aabbMin[axis]) * (mesh.aabbMax[axis] - mesh.aabbMin[axis]);
+    radius = std::sqrt(radius) * 0.5f;
+
+    std::vector<uint32_t> previous = workingMesh.indices;
+    for (size_t level = 0; level < MAX_LOD_LEVELS; ++level) {
+        const float scale = static_cast<float>(1u << level);
+        std::vector<uint32_t> simplified = MeshSimplifier::simplify(workingMesh.positions.data(), workingMesh.getVertexCount(),
+            previous, previous.size() / 6 * 3, radius * LOD_ERROR_PER_RADIUS * scale);
+        if (simplified.empty() || simplified.size() > previous.size() * LOD_MIN_REDUCTION)
+            break;
+
+        mesh.lods.emplace_back();
+        SceneLodData &lod = mesh.lods.back();
+        lod.distance = radius * LOD_DISTANCE_PER_RADIUS * scale;
+        lod.indexCount = static_cast<uint32_t>(simplified.size());
+        // NOTE: simplifying scrambles the triangle order, and the LODs are drawn just as often as the full mesh
+        MeshOptimizer::optimizeVertexCache(simplified, workingMesh.getVertexCount());
+        packIndices(simplified, mesh.indexSize, lod.ownedIndexData);
+        lod.indexData = lod.ownedIndexData.data();
+        previous = std::move(simplified);
+    }
+}
+
+// reorders the triangles for the vertex cache and overdraw, then the vertices in the order they are first used
+static void optimizeWorkingMesh(WorkingMesh &mesh, SceneLoadStats::MeshCacheReport &report)
+{
+    const MeshOptimizer::CacheStats before = MeshOptimizer::analyzeVertexCache(mesh.indices, mesh.getVertexCount());
+    MeshOptimizer::optimizeVertexCache(mesh.indices, mesh.getVertexCount());
+    MeshOptimizer::optimizeOverdraw(mesh.indices, mesh.positions.data(), mesh.getVertexCount());
+
+    size_t newVertexCount = 0;
+    const std::vector<uint32_t> remap = MeshOptimizer::optimizeVertexFetch(mesh.indices, mesh.getVertexCount(), newVertexCount);
+    WorkingMesh reordered;
+    reordered.positions.resize(newVertexCount * 3);
+    reordered.normals.resize(newVertexCount * 3);
+    reordered.uvs.resize(mesh.hasUvs() ? newVertexCount * 2 : 0);
+    reordered.tangents.resize(mesh.hasTangents() ? newVertexCount * 4 : 0);
+    for (size_t i = 0; i < remap.size(); ++i) {
+        const uint32_t target = remap[i];
+        if (target == MeshOptimizer::REMAP_UNUSED)
+            continue;
+        std::copy_n(&mesh.positions[i * 3], 3, &reordered.positions[target * 3]);
+        std::copy_n(&mesh.normals[i * 3], 3, &reordered.normals[target * 3]);
+        if (mesh.hasUvs())
+            std::copy_n(&mesh.uvs[i * 2], 2, &reordered.uvs[target * 2]);
+        if (mesh.hasTangents())
+            std::copy_n(&mesh.tangents[i * 4], 4, &reordered.tangents[target * 4]);
+    }
+    reordered.indices = std::move(mesh.indices);
+    reordered.materialIndex = mesh.materialIndex;
+    mesh = std::move(reordered);
+
+    const MeshOptimizer::CacheStats after = MeshOptimizer::analyzeVertexCache(mesh.indices, mesh.getVertexCount());
+    report.triangles = mesh.indices.size() / 3;
+    report.acmrBefore = before.acmr;
+    report.atvrBefore = before.atvr;
+    report.acmrAfter = after.acmr;
+    report.atvrAfter = after.atvr;
+}
+
+// splits the mesh (if enabled and needed), optimizes (if enabled) and packs the result,
+// reports gets one entry per resulting mesh if the meshes got optimized
+static std::vector<SceneMeshData> convertWorkingMesh(WorkingMesh workingMesh, const std::string &name, const SceneLoadOptions &options,
+                                                     std::vector<SceneLoadStats::MeshCacheReport> &reports)
+{
+    PROFILE_ZONE("Convert mesh");
+    std::vector<WorkingMesh> parts;
+    std::vector<std::string> names;
+    if (options.splitLargeMeshes && workingMesh.getVertexCount() > MAX_16BIT_VERTICES) {
+        parts = splitMesh(workingMesh, MAX_16BIT_VERTICES);
+        for (size_t i = 0; i < parts.size(); ++i)
+            names.push_back(name + "_part" + std::to_string(i));
+    } else {
+        parts.push_back(std::move(workingMesh));
+        names.push_back(name);
+    }
+
+    std::vector<SceneMeshData> meshes(parts.size());
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (options.optimizeMeshes) {
+            reports.emplace_back();
+            reports.back().name = names[i];
+            optimizeWorkingMesh(parts[i], reports.back());
+        }
+        packMesh(parts[i], names[i], options.vertexCompression, meshes[i]);
+        if (options.generateLods)
+            generateLods(parts[i], meshes[i]);
+    }
+    return meshes;
+}
+
+static std::vector<SceneMeshData> importAssimpMesh(const aiMesh* aiMesh, unsigned int meshIndex, const SceneLoadOptions &options,
+                                                   std::vector<SceneLoadStats::MeshCacheReport> &reports)
+{
+    WorkingMesh workingMesh;
+    readAssimpMesh(aiMesh, workingMesh);
+    return convertWorkingMesh(std::move(workingMesh), "AssimpMesh_" + std::to_string(meshIndex), options, reports);
+}
+
+// appends a copy of source, transformed into scene space, to target (which must have the same channels)
+static void appendTransformedMesh(const WorkingMesh &source, const aiMatrix4x4 &transform, WorkingMesh &target)
+{
+    const aiMatrix3x3 directionTransform(transform);
+    const aiMatrix3x3 normalTransform = aiMatrix3x3(directionTransform).Inverse().Transpose();
+    // a mirroring transform flips the winding order and the bitangent
+    const bool mirrored = directionTransform.Determinant() < 0.0f;
+
+    const uint32_t firstVertex = target.getVertexCount();
+    for (uint32_t i = 0; i < source.getVertexCount(); ++i) {
+        const aiVector3D position = transform * aiVector3D(source.positions[i * 3 + 0], source.positions[i * 3 + 1], source.positions[i * 3 + 2]);
+        target.positions.insert(target.positions.end(), {position.x, position.y, position.z});
+        const aiVector3D normal = (normalTransform * aiVector3D(source.normals[i * 3 + 0], source.normals[i * 3 + 1], source.normals[i * 3 + 2])).NormalizeSafe();
+        target.normals.insert(target.normals.end(), {normal.x, normal.y, normal.z});
+        if (source.hasUvs())
+            target.uvs.insert(target.uvs.end(), &source.uvs[i * 2], &source.uvs[i * 2] + 2);
+        if (source.hasTangents()) {
+            const aiVector3D tangent = (directionTransform * aiVector3D(source.tangents[i * 4 + 0], source.tangents[i * 4 + 1], source.tangents[i * 4 + 2])).NormalizeSafe();
+            const float handedness = mirrored ? -source.tangents[i * 4 + 3] : source.tangents[i * 4 + 3];
+            target.tangents.insert(target.tangents.end(), {tangent.x, tangent.y, tangent.z, handedness});
+        }
+    }
+
+    for (size_t i = 0; i + 2 < source.indices.size(); i += 3) {
+        target.indices.push_back(firstVertex + source.indices[i]);
+        target.indices.push_back(firstVertex + source.indices[i + (mirrored ? 2 : 1)]);
+        target.indices.push_back(firstVertex + source.indices[i + (mirrored ? 1 : 2)]);
+    }
+}
+
+// bakes every node's meshes into scene space, and merges all of them that end up with the same datablock
+// (and the same vertex channels) into one mesh, returns the number of node/mesh pairs that went in
+static uint32_t mergeMeshesByDatablock(const aiNode* node, const aiMatrix4x4 &parentTransform, const std::vector<WorkingMesh> &sourceMeshes,
+                                       const SceneData &sceneData, std::map<std::string, WorkingMesh> &mergedMeshes)
+{
+    const aiMatrix4x4 transform = parentTransform * node->mTransformation;
+    uint32_t numSourceItems = node->mNumMeshes;
+    for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
+        const WorkingMesh &source = sourceMeshes[node->mMeshes[i]];
+        const std::string key = getDatablockName(sceneData.materials[source.materialIndex]) +
+            (source.hasUvs() ? "/uv" : "") + (source.hasTangents() ? "/tangent" : "");
+        WorkingMesh &merged = mergedMeshes[key];
+        merged.materialIndex = source.materialIndex;
+        appendTransformedMesh(source, transform, merged);
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; ++i)
+        numSourceItems += mergeMeshesByDatablock(node->mChildren[i], transform, sourceMeshes, sceneData, mergedMeshes);
+    return numSourceItems;
+}
+
+// meshFirstIndex[i] .. meshFirstIndex[i + 1] are the SceneData meshes that assimp mesh i was converted into
+static void importAssimpNode(const aiNode* node, int32_t parentIndex, const std::vector<uint32_t> &meshFirstIndex, SceneData &sceneData)
+{
+    const int32_t nodeIndex = static_cast<int32_t>(sceneData.nodes.size());
+    sceneData.nodes.emplace_back();
+    SceneNodeData &nodeData = sceneData.nodes.back();
+    nodeData.parentIndex = parentIndex;
+
+    aiMatrix4x4 transform = node->mTransformation;
+    aiVector3t<float> scaling, position;
+    aiQuaterniont<float> rotation;
+    transform.Decompose(scaling, rotation, position);
+
+    nodeData.position[0] = position.x;
+    nodeData.position[1] = position.y;
+    nodeData.position[2] = position.z;
+    nodeData.orientation[0] = rotation.w;
+    nodeData.orientation[1] = rotation.x;
+    nodeData.orientation[2] = rotation.y;
+    nodeData.orientation[3] = rotation.z;
+    nodeData.scale[0] = scaling.x;
+    nodeData.scale[1] = scaling.y;
+    nodeData.scale[2] = scaling.z;
+    for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
+        for (uint32_t meshIndex = meshFirstIndex[node->mMeshes[i]]; meshIndex < meshFirstIndex[node->mMeshes[i] + 1]; ++meshIndex)
+            nodeData.meshIndices.push_back(meshIndex);
+    }
+
+    for (unsigned int i = 0; i < node->mNumChildren; ++i) {
+        importAssimpNode(node->mChildren[i], nodeIndex, meshFirstIndex, sceneData);
+    }
+}
+
+static bool importSceneWithAssimp(const std::string& filename, const SceneLoadOptions &options, SceneData &sceneData, WorkerPool &workerPool, SceneLoadStats &stats, std::atomic<size_t> &meshesConverted, std::atomic<size_t> &meshesTotal)
+{
+    LoadClock::time_point stageStart = LoadClock::now();
+    Assimp::Importer importer;
+    const aiScene* scene;
+    {
+        PROFILE_ZONE("Assimp::Importer::ReadFile");
+        scene = importer.ReadFile(filename, getImportFlags(options));
+    }
+    stats.importMs = millisecondsSince(stageStart);
+
+    if (!scene || !scene->mRootNode) {
+        std::cerr << "Error loading scene: " << importer.GetErrorString() << std::endl;
+        return false;
+    }
+
+    stageStart = LoadClock::now();
+    PROFILE_ZONE("Convert meshes");
+    importAssimpMaterials(scene, sceneData);
+    // NOTE: every mesh only writes to its own slot, so they can be converted in any order on any thread
+    std::vector<std::vector<SceneMeshData>> convertedMeshes;
+    std::vector<std::vector<SceneLoadStats::MeshCacheReport>> cacheReports;
+    meshesTotal = scene->mNumMeshes;
+    if (options.mergeStaticMeshes) {
+        std::vector<WorkingMesh> sourceMeshes(scene->mNumMeshes);
+        workerPool.parallelFor(scene->mNumMeshes, [scene, &sourceMeshes, &meshesConverted](size_t i) {
+            readAssimpMesh(scene->mMeshes[i], sourceMeshes[i]);
+            meshesConverted++;
+        });
+
+        std::map<std::string, WorkingMesh> mergedMeshes;
+        sceneData.numSourceItems = mergeMeshesByDatablock(scene->mRootNode, aiMatrix4x4(), sourceMeshes, sceneData, mergedMeshes);
+        sourceMeshes.clear();
+
+        std::vector<WorkingMesh*> mergedList;
+        for (auto &entry : mergedMeshes)
+            mergedList.push_back(&entry.second);
+        convertedMeshes.resize(mergedList.size());
+        cacheReports.resize(mergedList.size());
+        workerPool.parallelFor(mergedList.size(), [&options, &mergedList, &convertedMeshes, &cacheReports](size_t i) {
+            convertedMeshes[i] = convertWorkingMesh(std::move(*mergedList[i]), "MergedMesh_" + std::to_string(i), options, cacheReports[i]);
+        });
+
+        // everything is in scene space now, so a single node holds all of the merged meshes
+        for (std::vector<SceneMeshData> &meshes : convertedMeshes) {
+            for (SceneMeshData &mesh : meshes)
+                sceneData.meshes.push_back(std::move(mesh));
+        }
+        sceneData.nodes.emplace_back();
+        for (uint32_t i = 0; i < sceneData.meshes.size(); ++i)
+            sceneData.nodes.back().meshIndices.push_back(i);
+    } else {
+        convertedMeshes.resize(scene->mNumMeshes);
+        cacheReports.resize(scene->mNumMeshes);
+        workerPool.parallelFor(scene->mNumMeshes, [scene, &options, &convertedMeshes, &cacheReports, &meshesConverted](size_t i) {
+            convertedMeshes[i] = importAssimpMesh(scene->mMeshes[i], static_cast<unsigned int>(i), options, cacheReports[i]);
+            meshesConverted++;
+        });
+
+        // a mesh can turn into several when it gets split, so flatten them and remember where each one starts
+        std::vector<uint32_t> meshFirstIndex(scene->mNumMeshes + 1, 0);
+        for (unsigned int i = 0; i < scene->mNumMeshes; ++i) {
+            meshFirstIndex[i] = static_cast<uint32_t>(sceneData.meshes.size());
+            for (SceneMeshData &mesh : convertedMeshes[i])
+                sceneData.meshes.push_back(std::move(mesh));
+        }
+        meshFirstIndex[scene->mNumMeshes] = static_cast<uint32_t>(sceneData.meshes.size());
+        importAssimpNode(scene->mRootNode, -1, meshFirstIndex, sceneData);
+        for (const SceneNodeData &nodeData : sceneData.nodes)
+            sceneData.numSourceItems += static_cast<uint32_t>(nodeData.meshIndices.size());
+    }
+
+    // NOTE: in the same order as sceneData.meshes
+    for (std::vector<SceneLoadStats::MeshCacheReport> &reports : cacheReports) {
+        for (SceneLoadStats::MeshCacheReport &report : reports)
+            stats.meshCacheReports.push_back(std::move(report));
+    }
+
+    // NOTE: printed here rather than while converting, so the lines don't interleave between threads
+    for (const SceneLoadStats::MeshCacheReport &report : stats.meshCacheReports) {
+        std::cout << "\t" << report.name << ": ACMR " << report.acmrBefore << " -> " << report.acmrAfter
+                  << ", ATVR " << report.atvrBefore << " -> " << report.atvrAfter << std::endl;
+    }
+    for (const SceneMeshData &mesh : sceneData.meshes) {
+        const size_t uncompressedBytes = static_cast<size_t>(mesh.vertexCount) * VertexFormat::getStride(mesh.vertexFlags & ~VERTEX_COMPACT);
+        stats.vertexBytes += mesh.ownedVertexData.size();
+        stats.vertexBytesSaved += uncompressedBytes - mesh.ownedVertexData.size();
+        if (mesh.vertexFlags & VERTEX_COMPACT) {
+            std::cout << "\t" << mesh.name << ": " << mesh.vertexCount << " vertices, " << mesh.ownedVertexData.size()
+                      << " bytes (saved " << uncompressedBytes - mesh.ownedVertexData.size() << " bytes)" << std::endl;
+        }
+        if (!mesh.lods.empty()) {
+            std::cout << "\t" << mesh.name << ": " << mesh.lods.size() << " LODs, " << mesh.indexCount / 3 << " triangles";
+            for (const SceneLodData &lod : mesh.lods)
+                std::cout << " -> " << lod.indexCount / 3 << " at " << lod.distance;
+            std::cout << std::endl;
+        }
+        stats.numLods += mesh.lods.size();
+    }
+
+    importAssimpLights(scene, options.instancing, sceneData);
+    stats.convertMs = millisecondsSince(stageStart);
+    return true;
+}
+
+// everything up to (but not including) touching Ogre, so this can run on a background thread
+static bool prepareSceneData(const std::string& filename, const SceneLoadOptions &options, SceneData &sceneData, SceneLoadStats &stats, std::atomic<size_t> &meshesConverted, std::atomic<size_t> &meshesTotal)
+{
+    PROFILE_ZONE("Prepare scene data");
+    LoadClock::time_point stageStart = LoadClock::now();
+    uint64_t sourceHash = 0;
+    if (!MeshCache::hashFile(filename, sourceHash)) {
+        std::cerr << "Error loading scene: could not read \"" << filename << "\"" << std::endl;
+        return false;
+    }
+    stats.hashMs = millisecondsSince(stageStart);
+
+    const std::string cachePath = MeshCache::getCachePath(filename);
+    stageStart = LoadClock::now();
+    const uint32_t importFlags = getImportFlags(options);
+    const uint32_t optionFlags = getOptionFlags(options);
+    stats.fromCache = MeshCache::load(cachePath, sourceHash, importFlags, optionFlags, sceneData);
+    stats.cacheReadMs = millisecondsSince(stageStart);
+    if (stats.fromCache) {
+        meshesTotal = sceneData.meshes.size();
+        meshesConverted = sceneData.meshes.size();
+        return true;
+    }
+
+    WorkerPool workerPool;
+    stats.numThreads = workerPool.getNumThreads();
+    if (!importSceneWithAssimp(filename, options, sceneData, workerPool, stats, meshesConverted, meshesTotal))
+        return false;
+    stageStart = LoadClock::now();
+    MeshCache::save(cachePath, sourceHash, importFlags, optionFlags, sceneData);
+    stats.cacheWriteMs = millisecondsSince(stageStart);
+    return true;
+}
+
+// what a load created in the SceneManager, so it can be destroyed again
+struct SceneObjects
+{
+    std::vector<Ogre::Item*> items;
+    std::vector<Ogre::Light*> lights;
+    std::vector<Ogre::SceneNode*> nodes; // only the top level ones, their children are destroyed with them
+    std::vector<Ogre::MeshPtr> meshes;
+};
+
+static void destroySceneObjects(Ogre::SceneManager* sceneMgr, SceneObjects &objects)
+{
+    for (Ogre::Item * const item : objects.items)
+        sceneMgr->destroyItem(item);
+    for (Ogre::Light * const light : objects.lights)
+        sceneMgr->destroyLight(light);
+    for (Ogre::SceneNode * const node : objects.nodes) {
+        node->removeAndDestroyAllChildren();
+        sceneMgr->destroySceneNode(node);
+    }
+    Ogre::MeshManager &meshMgr = Ogre::MeshManager::getSingleton();
+    for (const Ogre::MeshPtr &mesh : objects.meshes)
+        meshMgr.remove(mesh->getHandle());
+    objects = SceneObjects();
+}
+
+static void buildLights(const SceneData &sceneData, Ogre::SceneManager* sceneMgr, SceneObjects &objects)
+{
+    std::cout << "LIGHTS:" << std::endl;
+    for (size_t i = 0; i < sceneData.lights.size(); ++i)
+    {
+        const SceneLightData &lightData = sceneData.lights[i];
+        std::cout << "\tLIGHT " << i << " type = " << static_cast<uint32_t>(lightData.type) << std::endl;
+
+        Ogre::Light* light = sceneMgr->createLight();
+        objects.lights.push_back(light);
+        light->setName(lightData.name);
+
+        switch (lightData.type)
+        {
+        case SceneLightType::Directional:
+            light->setType(Ogre::Light::LT_DIRECTIONAL);
+            break;
+        case SceneLightType::Point:
             light->setType(Ogre::Light::LT_POINT);
             // light->setAttenuationBasedOnRadius(300, 0.001); // HACK just trying stuff...
             light->setPowerScale(0.002);
             break;
-        case aiLightSource_SPOT:
+        case SceneLightType::Spot:
             light->setType(Ogre::Light::LT_SPOTLIGHT);
             light->setSpotlightRange(
-                Ogre::Radian(aiLight->mAngleInnerCone),
-                Ogre::Radian(aiLight->mAngleOuterCone));
+                Ogre::Radian(lightData.innerCone),
+                Ogre::Radian(lightData.outerCone));
             break;
-        default:
-            continue; // Skip unsupported types
         }
 
-        light->setDiffuseColour(aiLight->mColorDiffuse.r, aiLight->mColorDiffuse.g, aiLight->mColorDiffuse.b);
-        light->setSpecularColour(aiLight->mColorSpecular.r, aiLight->mColorSpecular.g, aiLight->mColorSpecular.b);
+        light->setDiffuseColour(lightData.diffuse[0], lightData.diffuse[1], lightData.diffuse[2]);
+        light->setSpecularColour(lightData.specular[0], lightData.specular[1], lightData.specular[2]);
 
         light->setAttenuation(
             100.0f,  // assume max range
-            aiLight->mAttenuationConstant,
-            aiLight->mAttenuationLinear,
-            aiLight->mAttenuationQuadratic);
+            lightData.attenuationConstant,
+            lightData.attenuationLinear,
+            lightData.attenuationQuadratic);
 
         Ogre::SceneNode* lightNode = sceneMgr->getRootSceneNode()->createChildSceneNode();
+        objects.nodes.push_back(lightNode);
 
-        if (aiLight->mType != aiLightSource_DIRECTIONAL)
-            lightNode->setPosition(aiLight->mPosition.x, aiLight->mPosition.y, aiLight->mPosition.z);
+        if (lightData.type != SceneLightType::Directional)
+            lightNode->setPosition(lightData.position[0], lightData.position[1], lightData.position[2]);
 
-        if (aiLight->mType != aiLightSource_POINT) {
-            Ogre::Vector3 dir(aiLight->mDirection.x, aiLight->mDirection.y, aiLight->mDirection.z);
+        if (lightData.type != SceneLightType::Point) {
+            Ogre::Vector3 dir(lightData.direction[0], lightData.direction[1], lightData.direction[2]);
             lightNode->setDirection(dir.normalisedCopy());
         }
 
@@ -71,150 +828,410 @@ static void processAssimpLights(const aiScene* scene, Ogre::SceneManager* sceneM
     }
 }
 
-static void processAssimpNode(const aiNode* node, const aiScene* scene, Ogre::SceneManager* sceneMgr, Ogre::SceneNode* parentNode)
+// NOTE: meshName has to be unique, mesh names in different files (or loads of the same file) are the same
+static Ogre::MeshPtr buildMesh(const SceneMeshData &meshData, const Ogre::String &meshName)
 {
-    Ogre::SceneNode* currentNode = parentNode->createChildSceneNode();
+    auto vaoManager = Ogre::Root::getSingleton().getRenderSystem()->getVaoManager();
+    auto meshMgr = Ogre::MeshManager::getSingletonPtr();
 
-    aiMatrix4x4 transform = node->mTransformation;
-    aiVector3t<float> scaling, position;
-    aiQuaterniont<float> rotation;
-    transform.Decompose(scaling, rotation, position);
+    const bool compact = meshData.vertexFlags & VERTEX_COMPACT;
+    Ogre::VertexElement2Vec vertexElements;
+    vertexElements.push_back(Ogre::VertexElement2(compact ? Ogre::VET_USHORT4_NORM : Ogre::VET_FLOAT3, Ogre::VES_POSITION));
+    vertexElements.push_back(Ogre::VertexElement2(compact ? Ogre::VET_SHORT4_SNORM : Ogre::VET_FLOAT3, Ogre::VES_NORMAL));
+    if (meshData.vertexFlags & VERTEX_HAS_UV)
+        vertexElements.push_back(Ogre::VertexElement2(compact ? Ogre::VET_HALF2 : Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES));
+    // NOTE: compact meshes carry the tangent inside the QTangent normal
+    if ((meshData.vertexFlags & VERTEX_HAS_TANGENT) && !compact)
+        vertexElements.push_back(Ogre::VertexElement2(Ogre::VET_FLOAT4, Ogre::VES_TANGENT));
 
-    Ogre::Vector3 scale(scaling.x, scaling.y, scaling.z);
-    Ogre::Vector3 translate(position.x, position.y, position.z);
-    Ogre::Quaternion orient(rotation.w, rotation.x, rotation.y, rotation.z);
+    // NOTE: the data is only read (copied into the GPU buffer) since we don't keep a shadow copy, so it is fine to hand Ogre a pointer into the read-only cache mapping
+    Ogre::VertexBufferPacked *vb = vaoManager->createVertexBuffer(
+        vertexElements, meshData.vertexCount, Ogre::BT_DEFAULT, const_cast<void *>(meshData.vertexData), false);
 
-    currentNode->setPosition(translate);
-    currentNode->setOrientation(orient);
-    currentNode->setScale(scale);
+    Ogre::IndexBufferPacked *ib = vaoManager->createIndexBuffer(
+        meshData.indexSize == 4 ? Ogre::IndexBufferPacked::IT_32BIT : Ogre::IndexBufferPacked::IT_16BIT, meshData.indexCount, Ogre::BT_DEFAULT, const_cast<void *>(meshData.indexData), false);
 
-    auto vaoManager = Ogre::Root::getSingleton().getRenderSystem()->getVaoManager();
-    auto meshMgr = Ogre::MeshManager::getSingletonPtr();
+    Ogre::VertexArrayObject *vao = vaoManager->createVertexArrayObject({vb}, ib, Ogre::OT_TRIANGLE_LIST);
 
-    for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
-        const aiMesh * const aiMesh = scene->mMeshes[node->mMeshes[i]];
-        const Ogre::String meshName = "AssimpMesh_" + Ogre::StringConverter::toString(node->mMeshes[i]);
+    Ogre::MeshPtr mesh = meshMgr->createManual(meshName, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+    Ogre::SubMesh *subMesh = mesh->createSubMesh();
+    //subMesh->operationType = Ogre::OT_TRIANGLE_LIST;
+    subMesh->mVao[Ogre::VpNormal].push_back(vao);
 
-        // std::cout << "LOADING MESH #" << m <<
+    // every LOD is just another index buffer over the same vertex buffer
+    if (!meshData.lods.empty()) {
+        Ogre::LodStrategy * const lodStrategy = Ogre::LodStrategyManager::getSingleton().getDefaultStrategy();
+        Ogre::MovableObject::LodValueArray lodValues;
+        lodValues.push_back(lodStrategy->getBaseValue());
+        for (const SceneLodData &lod : meshData.lods) {
+            Ogre::IndexBufferPacked *lodIb = vaoManager->createIndexBuffer(
+                meshData.indexSize == 4 ? Ogre::IndexBufferPacked::IT_32BIT : Ogre::IndexBufferPacked::IT_16BIT, lod.indexCount, Ogre::BT_DEFAULT, const_cast<void *>(lod.indexData), false);
+            subMesh->mVao[Ogre::VpNormal].push_back(vaoManager->createVertexArrayObject({vb}, lodIb, Ogre::OT_TRIANGLE_LIST));
+            lodValues.push_back(lodStrategy->transformUserValue(lod.distance));
+        }
+        mesh->_setLodInfo(lodValues);
+    }
 
-        size_t numVerts = aiMesh->mNumVertices;
-        size_t numIndices = aiMesh->mNumFaces * 3;
+    if (compact) {
+        // compact positions are in the 0..1 range, the node they get attached to maps them back (see attachMeshItem())
+        mesh->_setBounds(Ogre::Aabb(Ogre::Vector3(0.5f), Ogre::Vector3(0.5f)), false);
+    } else {
+        const Ogre::Vector3 minBounds(meshData.aabbMin[0], meshData.aabbMin[1], meshData.aabbMin[2]);
+        const Ogre::Vector3 maxBounds(meshData.aabbMax[0], meshData.aabbMax[1], meshData.aabbMax[2]);
+        Ogre::Vector3 center = (minBounds + maxBounds) * 0.5f;
+        Ogre::Vector3 halfSize = (maxBounds - minBounds) * 0.5f;
+        Ogre::Aabb bounds(center, halfSize);
+        mesh->_setBounds(bounds, false);
+    }
+    mesh->load();
+    return mesh;
+}
 
-        std::vector<float> vertexBuffer;
-        std::vector<uint16_t> indexBuffer;
+// HlmsPbs has no per mesh position scale/bias, so quantized meshes get a child node that does the dequantization
+static void attachMeshItem(const SceneMeshData &meshData, Ogre::Item* item, Ogre::SceneNode* sceneNode)
+{
+    if (meshData.vertexFlags & VERTEX_COMPACT) {
+        float scale[3];
+        VertexFormat::getQuantizationScale(meshData.aabbMin, meshData.aabbMax, scale);
+        sceneNode = sceneNode->createChildSceneNode(sceneNode->isStatic() ? Ogre::SCENE_STATIC : Ogre::SCENE_DYNAMIC);
+        sceneNode->setPosition(meshData.aabbMin[0], meshData.aabbMin[1], meshData.aabbMin[2]);
+        sceneNode->setScale(scale[0], scale[1], scale[2]);
+    }
+    sceneNode->attachObject(item);
+}
 
-        Ogre::Vector3 minBounds(std::numeric_limits<float>::max());
-        Ogre::Vector3 maxBounds(std::numeric_limits<float>::lowest());
+static Ogre::HlmsPbsDatablock* buildDatablock(const SceneMaterialData &materialData, bool &created)
+{
+    Ogre::HlmsManager * const hlmsManager = Ogre::Root::getSingleton().getHlmsManager();
+    const Ogre::String datablockName = getDatablockName(materialData);
+    created = false;
+    if (Ogre::HlmsDatablock * const existing = hlmsManager->getDatablockNoDefault(datablockName))
+        return static_cast<Ogre::HlmsPbsDatablock *>(existing);
 
-        vertexBuffer.reserve(numVerts * 6);
-        for (unsigned int i = 0; i < aiMesh->mNumVertices; ++i) {
-            vertexBuffer.push_back(aiMesh->mVertices[i].x);
-            vertexBuffer.push_back(aiMesh->mVertices[i].y);
-            vertexBuffer.push_back(aiMesh->mVertices[i].z);
+    Ogre::HlmsDatablock *datablock = hlmsManager->getHlms(Ogre::HLMS_PBS)->createDatablock(
+        datablockName, materialData.name.empty() ? datablockName : materialData.name,
+        Ogre::HlmsMacroblock(), Ogre::HlmsBlendblock(), Ogre::HlmsParamVec());
+    created = true;
 
-            {
-                Ogre::Vector3 v(aiMesh->mVertices[i].x, aiMesh->mVertices[i].y, aiMesh->mVertices[i].z);
-                minBounds.makeFloor(v);
-                maxBounds.makeCeil(v);
-            }
+    Ogre::HlmsPbsDatablock * const pbs = static_cast<Ogre::HlmsPbsDatablock *>(datablock);
+    pbs->setWorkflow(Ogre::HlmsPbsDatablock::MetallicWorkflow);
+    pbs->setDiffuse(Ogre::Vector3(materialData.diffuse[0], materialData.diffuse[1], materialData.diffuse[2]));
+    pbs->setEmissive(Ogre::Vector3(materialData.emissive[0], materialData.emissive[1], materialData.emissive[2]));
+    pbs->setRoughness(materialData.roughness);
+    pbs->setMetalness(materialData.metalness);
+    return pbs;
+}
 
-            if (aiMesh->HasNormals()) {
-                vertexBuffer.push_back(aiMesh->mNormals[i].x);
-                vertexBuffer.push_back(aiMesh->mNormals[i].y);
-                vertexBuffer.push_back(aiMesh->mNormals[i].z);
-            } else {
-                vertexBuffer.push_back(0.0f);
-                vertexBuffer.push_back(1.0f);
-                vertexBuffer.push_back(0.0f);
+// creates the Ogre side of a SceneData a little at a time, so the work can be spread over several frames
+class SceneBuilder
+{
+public:
+    // NOTE: everything created is added to objects
+    SceneBuilder(const SceneData &sceneData, Ogre::SceneManager* sceneMgr, Ogre::SceneNode* parentNode, bool staticGeometry, SceneObjects &objects) :
+        mSceneData(sceneData),
+        mObjects(objects),
+        mSceneMgr(sceneMgr),
+        mParentNode(staticGeometry ? sceneMgr->getRootSceneNode(Ogre::SCENE_STATIC) : parentNode),
+        mSceneType(staticGeometry ? Ogre::SCENE_STATIC : Ogre::SCENE_DYNAMIC),
+        mNodeCursor(0),
+        mMeshCursor(0),
+        mItemsDone(0),
+        mItemsTotal(0),
+        mMeshes(sceneData.meshes.size()),
+        mMeshesBuilt(0),
+        mDatablocks(sceneData.materials.size(), nullptr),
+        mDatablocksCreated(0)
+    {
+        static unsigned int sBuilderCount = 0;
+        mMeshNamePrefix = "Scene" + std::to_string(sBuilderCount++) + "/";
+        for (const SceneNodeData &nodeData : mSceneData.nodes)
+            mItemsTotal += nodeData.meshIndices.size();
+    }
+
+    // returns true once everything has been created, always makes some progress even with a tiny budget
+    bool step(double budgetMs)
+    {
+        PROFILE_ZONE("SceneBuilder::step");
+        const LoadClock::time_point stepStart = LoadClock::now();
+
+        // scene nodes are cheap, so they are all created in one go
+        if (mSceneNodes.empty() && !mSceneData.nodes.empty())
+            _BuildNodes();
+
+        while (mNodeCursor < mSceneData.nodes.size()) {
+            const SceneNodeData &nodeData = mSceneData.nodes[mNodeCursor];
+            if (mMeshCursor >= nodeData.meshIndices.size()) {
+                mNodeCursor++;
+                mMeshCursor = 0;
+                continue;
             }
+            const uint32_t meshIndex = nodeData.meshIndices[mMeshCursor];
+            // NOTE: every node referencing the same mesh gets an Item of the one Ogre mesh, Ogre then
+            // draws all of the Items sharing a mesh and datablock with a single instanced draw call
+            Ogre::Item * const item = mSceneMgr->createItem(_GetMesh(meshIndex), mSceneType);
+            mObjects.items.push_back(item);
+            item->setDatablock(_GetDatablock(mSceneData.meshes[meshIndex].materialIndex));
+            attachMeshItem(mSceneData.meshes[meshIndex], item, mSceneNodes[mNodeCursor]);
+            mMeshCursor++;
+            mItemsDone++;
+            if (millisecondsSince(stepStart) >= budgetMs)
+                return false;
         }
 
-        for (unsigned int i = 0; i < aiMesh->mNumFaces; ++i) {
-            const aiFace &face = aiMesh->mFaces[i];
-            for (unsigned int j = 0; j < 3; ++j) {
-                indexBuffer.push_back(static_cast<uint16_t>(face.mIndices[j]));
+        // static nodes only get their transforms and bounds updated when flagged dirty
+        if (mSceneType == Ogre::SCENE_STATIC) {
+            for (size_t i = 0; i < mSceneNodes.size(); ++i) {
+                if (mSceneData.nodes[i].parentIndex < 0)
+                    mSceneMgr->notifyStaticDirty(mSceneNodes[i]);
             }
         }
+        buildLights(mSceneData, mSceneMgr, mObjects);
+        return true;
+    }
+    size_t getItemsDone() const {return mItemsDone;}
+    size_t getItemsTotal() const {return mItemsTotal;}
+    size_t getMeshesBuilt() const {return mMeshesBuilt;}
+    bool isStatic() const {return mSceneType == Ogre::SCENE_STATIC;}
+    size_t getDatablocksCreated() const {return mDatablocksCreated;}
+    size_t getDatablocksUsed() const {return mUsedDatablocks.size();}
+protected:
+    // each mesh is created the first time a node references it
+    const Ogre::MeshPtr& _GetMesh(uint32_t meshIndex)
+    {
+        if (!mMeshes[meshIndex]) {
+            mMeshes[meshIndex] = buildMesh(mSceneData.meshes[meshIndex], mMeshNamePrefix + mSceneData.meshes[meshIndex].name);
+            mObjects.meshes.push_back(mMeshes[meshIndex]);
+            mMeshesBuilt++;
+        }
+        return mMeshes[meshIndex];
+    }
+    // every aiMaterial maps to exactly one datablock per import
+    Ogre::HlmsPbsDatablock* _GetDatablock(uint32_t materialIndex)
+    {
+        if (!mDatablocks[materialIndex]) {
+            bool created = false;
+            Ogre::HlmsPbsDatablock * const datablock = buildDatablock(mSceneData.materials[materialIndex], created);
+            mDatablocks[materialIndex] = datablock;
+            if (created)
+                mDatablocksCreated++;
+            // NOTE: several aiMaterials can end up with the same parameters, and thus the same datablock
+            mUsedDatablocks.insert(datablock);
+        }
+        return mDatablocks[materialIndex];
+    }
+    void _BuildNodes()
+    {
+        mSceneNodes.resize(mSceneData.nodes.size(), nullptr);
+        for (size_t i = 0; i < mSceneData.nodes.size(); ++i) {
+            const SceneNodeData &nodeData = mSceneData.nodes[i];
+            Ogre::SceneNode * const parent = nodeData.parentIndex < 0 ? mParentNode : mSceneNodes[nodeData.parentIndex];
+            Ogre::SceneNode * const currentNode = parent->createChildSceneNode(mSceneType);
+            mSceneNodes[i] = currentNode;
+            if (nodeData.parentIndex < 0)
+                mObjects.nodes.push_back(currentNode);
 
-        Ogre::VertexElement2Vec vertexElements;
-        vertexElements.push_back(Ogre::VertexElement2(Ogre::VET_FLOAT3, Ogre::VES_POSITION));
-        vertexElements.push_back(Ogre::VertexElement2(Ogre::VET_FLOAT3, Ogre::VES_NORMAL));
+            currentNode->setPosition(nodeData.position[0], nodeData.position[1], nodeData.position[2]);
+            currentNode->setOrientation(Ogre::Quaternion(nodeData.orientation[0], nodeData.orientation[1], nodeData.orientation[2], nodeData.orientation[3]));
+            currentNode->setScale(nodeData.scale[0], nodeData.scale[1], nodeData.scale[2]);
+        }
+    }
+protected:
+    const SceneData &mSceneData;
+    SceneObjects &mObjects;
+    Ogre::SceneManager *mSceneMgr;
+    Ogre::SceneNode *mParentNode;
+    Ogre::SceneMemoryMgrTypes mSceneType;
+    std::vector<Ogre::SceneNode*> mSceneNodes;
+    size_t mNodeCursor;
+    size_t mMeshCursor;
+    size_t mItemsDone;
+    size_t mItemsTotal;
+    std::string mMeshNamePrefix;
+    std::vector<Ogre::MeshPtr> mMeshes; // indexed by mesh index
+    size_t mMeshesBuilt;
+    std::vector<Ogre::HlmsPbsDatablock*> mDatablocks; // indexed by material index
+    size_t mDatablocksCreated;
+    std::unordered_set<Ogre::HlmsPbsDatablock*> mUsedDatablocks;
+};
 
-        Ogre::VertexBufferPacked *vb = vaoManager->createVertexBuffer(
-            vertexElements, numVerts, Ogre::BT_DEFAULT, vertexBuffer.data(), false);
+static void printMeshCacheTotal(const SceneLoadStats &stats)
+{
+    if (stats.meshCacheReports.empty())
+        return;
+    // weighted by triangle count, so it is the ratio for the whole scene
+    double trianglesTotal = 0.0, missesBefore = 0.0, missesAfter = 0.0;
+    for (const SceneLoadStats::MeshCacheReport &report : stats.meshCacheReports) {
+        trianglesTotal += report.triangles;
+        missesBefore += report.acmrBefore * report.triangles;
+        missesAfter += report.acmrAfter * report.triangles;
+    }
+    std::cout << "\tACMR:        " << missesBefore / trianglesTotal << " -> " << missesAfter / trianglesTotal << std::endl;
+}
 
-        Ogre::IndexBufferPacked *ib = vaoManager->createIndexBuffer(
-            Ogre::IndexBufferPacked::IT_16BIT, numIndices, Ogre::BT_DEFAULT, indexBuffer.data(), false);
+void printSceneLoadStats(const SceneLoadStats &stats)
+{
+    std::cout << "Scene load took " << stats.totalMs << " ms (" << stats.numMeshes << " meshes, "
+              << (stats.fromCache ? "from mesh cache" : "imported with Assimp") << "):" << std::endl;
+    std::cout << "\thash:        " << stats.hashMs << " ms" << std::endl;
+    if (stats.fromCache) {
+        std::cout << "\tcache read:  " << stats.cacheReadMs << " ms" << std::endl;
+    } else {
+        std::cout << "\tassimp:      " << stats.importMs << " ms" << std::endl;
+        std::cout << "\tconvert:     " << stats.convertMs << " ms (" << stats.numThreads << " threads)" << std::endl;
+        std::cout << "\tcache write: " << stats.cacheWriteMs << " ms" << std::endl;
+        std::cout << "\tLODs:        " << stats.numLods << std::endl;
+        printMeshCacheTotal(stats);
+        std::cout << "\tvertex data: " << stats.vertexBytes << " bytes (" << stats.vertexBytesSaved << " bytes saved by compression)" << std::endl;
+    }
+    std::cout << "\tupload:      " << stats.uploadMs << " ms" << std::endl;
+    if (stats.numSourceItems != stats.numItems)
+        std::cout << "\t" << stats.numSourceItems << " node/mesh pairs merged into " << stats.numItems << " items" << std::endl;
+    std::cout << "\t" << stats.numStaticItems << " of " << stats.numItems << " items are static" << std::endl;
+    std::cout << "\t" << stats.numItems << " items are instances of " << stats.numMeshesBuilt << " meshes" << std::endl;
+    std::cout << "\t" << stats.numItems << " items share " << stats.numDatablocks << " datablocks ("
+              << stats.numDatablocksCreated << " new, " << stats.getDatablocksSaved() << " saved)" << std::endl;
+}
 
-        Ogre::VertexArrayObject *vao = vaoManager->createVertexArrayObject({vb}, ib, Ogre::OT_TRIANGLE_LIST);
+bool printMeshOptimizationReport(const std::string& filename, const SceneLoadOptions &options)
+{
+    SceneLoadOptions importOptions = options;
+    importOptions.optimizeMeshes = true;
+    std::cout << "Optimizing the meshes of \"" << filename << "\":" << std::endl;
+    // NOTE: importing prints the ACMR/ATVR of every mesh
+    SceneData sceneData;
+    SceneLoadStats stats;
+    WorkerPool workerPool;
+    std::atomic<size_t> meshesConverted(0), meshesTotal(0);
+    if (!importSceneWithAssimp(filename, importOptions, sceneData, workerPool, stats, meshesConverted, meshesTotal))
+        return false;
+    printMeshCacheTotal(stats);
+    return true;
+}
 
-        // std::string meshName = "ImportedMesh_" + std::to_string(m);
-        Ogre::MeshPtr mesh = meshMgr->createManual(meshName, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
-        Ogre::SubMesh *subMesh = mesh->createSubMesh();
-        //subMesh->operationType = Ogre::OT_TRIANGLE_LIST;
-        subMesh->mVao[Ogre::VpNormal].push_back(vao);
+static void collectBuilderStats(const SceneBuilder &builder, SceneLoadStats &stats)
+{
+    stats.numItems = builder.getItemsTotal();
+    stats.numStaticItems = builder.isStatic() ? stats.numItems : 0;
+    stats.numMeshesBuilt = builder.getMeshesBuilt();
+    stats.numDatablocks = builder.getDatablocksUsed();
+    stats.numDatablocksCreated = builder.getDatablocksCreated();
+}
 
-        {
-            Ogre::Vector3 center = (minBounds + maxBounds) * 0.5f;
-            Ogre::Vector3 halfSize = (maxBounds - minBounds) * 0.5f;
-            Ogre::Aabb bounds(center, halfSize);
-            mesh->_setBounds(bounds, false);
-        }
-        mesh->load();
-
-        Ogre::Item *item = sceneMgr->createItem(meshName, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, Ogre::SCENE_DYNAMIC);
-        Ogre::SceneNode *node = sceneMgr->getRootSceneNode(Ogre::SCENE_DYNAMIC)->createChildSceneNode();
-        // node->attachObject(item);
-        
-        
-        
-        aiMaterial * const aiMat = scene->mMaterials[aiMesh->mMaterialIndex];
-        aiColor4D diffuseColor;
-        if (AI_SUCCESS != aiGetMaterialColor(aiMat, AI_MATKEY_BASE_COLOR, &diffuseColor))
-        {
-            // Fall back to diffuse if base color isn't set
-            aiGetMaterialColor(aiMat, AI_MATKEY_COLOR_DIFFUSE, &diffuseColor);
-        }
+SceneLoadStats loadSceneWithAssimp(const std::string& filename, Ogre::SceneManager* sceneMgr, Ogre::SceneNode* parentNode, const SceneLoadOptions &options)
+{
+    SceneLoadStats stats;
+    const LoadClock::time_point loadStart = LoadClock::now();
+    PROFILE_ZONE("loadSceneWithAssimp");
 
-        
-        
-        const Ogre::String datablockName = meshName + "/Material";
-        Ogre::HlmsDatablock *datablock = Ogre::Root::getSingleton().getHlmsManager()->getHlms(Ogre::HLMS_PBS)->createDatablock(
-            datablockName, datablockName,
-            Ogre::HlmsMacroblock(), Ogre::HlmsBlendblock(), Ogre::HlmsParamVec());
+    SceneData sceneData;
+    std::atomic<size_t> meshesConverted(0), meshesTotal(0);
+    if (!prepareSceneData(filename, options, sceneData, stats, meshesConverted, meshesTotal))
+        return stats;
 
-        Ogre::HlmsPbsDatablock * const pbs = static_cast<Ogre::HlmsPbsDatablock *>(datablock);
-        pbs->setDiffuse(Ogre::Vector3(diffuseColor.r, diffuseColor.g, diffuseColor.b));
+    const LoadClock::time_point stageStart = LoadClock::now();
+    SceneObjects objects; // NOTE: not kept, there is no way to destroy a blocking load's scene
+    SceneBuilder builder(sceneData, sceneMgr, parentNode, options.staticGeometry, objects);
+    builder.step(std::numeric_limits<double>::infinity());
+    stats.uploadMs = millisecondsSince(stageStart);
+    collectBuilderStats(builder, stats);
+
+    stats.numMeshes = sceneData.meshes.size();
+    stats.numSourceItems = sceneData.numSourceItems;
+    stats.totalMs = millisecondsSince(loadStart);
+    printSceneLoadStats(stats);
+    return stats;
+}
 
-        item->setDatablock(pbs);
+AsyncSceneLoad::AsyncSceneLoad(const std::string& filename, Ogre::SceneManager* sceneMgr, Ogre::SceneNode* parentNode, const SceneLoadOptions &options) :
+    mFilename(filename),
+    mOptions(options),
+    mSceneMgr(sceneMgr),
+    mParentNode(parentNode),
+    mSceneData(std::make_unique<SceneData>()),
+    mObjects(std::make_unique<SceneObjects>()),
+    mState(STATE_IMPORTING),
+    mMeshesConverted(0),
+    mMeshesTotal(0),
+    mStartTime(LoadClock::now())
+{
+    mThread = std::thread(&AsyncSceneLoad::_BackgroundMain, this);
+}
+
+AsyncSceneLoad::~AsyncSceneLoad()
+{
+    // NOTE: Assimp can't be interrupted, so destroying a load in progress waits for the import to finish
+    if (mThread.joinable())
+        mThread.join();
+}
 
+void AsyncSceneLoad::update(double budgetMs)
+{
+    if (mState != STATE_UPLOADING)
+        return;
 
-        currentNode->attachObject(item);
+    if (!mBuilder) {
+        mThread.join(); // the background thread is already done at this point
+        mBuilder = std::make_unique<SceneBuilder>(*mSceneData, mSceneMgr, mParentNode, mOptions.staticGeometry, *mObjects);
     }
 
-    for (unsigned int i = 0; i < node->mNumChildren; ++i) {
-        processAssimpNode(node->mChildren[i], scene, sceneMgr, currentNode);
+    const LoadClock::time_point stepStart = LoadClock::now();
+    const bool done = mBuilder->step(budgetMs);
+    mStats.uploadMs += millisecondsSince(stepStart);
+    mItemsDone = mBuilder->getItemsDone();
+    mItemsTotal = mBuilder->getItemsTotal();
+    if (done) {
+        collectBuilderStats(*mBuilder, mStats);
+        mStats.numMeshes = mSceneData->meshes.size();
+        mStats.numSourceItems = mSceneData->numSourceItems;
+        mStats.totalMs = millisecondsSince(mStartTime);
+        printSceneLoadStats(mStats);
+        // the GPU has its own copy now, so release the CPU side buffers (or unmap the cache)
+        mBuilder.reset();
+        mSceneData.reset();
+        mState = STATE_DONE;
     }
 }
 
-void loadSceneWithAssimp(const std::string& filename, Ogre::SceneManager* sceneMgr, Ogre::SceneNode* parentNode)
+void AsyncSceneLoad::destroyScene()
 {
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(filename,
-        aiProcess_Triangulate |
-        aiProcess_GenSmoothNormals |
-        aiProcess_JoinIdenticalVertices |
-        aiProcess_ImproveCacheLocality |
-        aiProcess_RemoveRedundantMaterials |
-        aiProcess_SortByPType |
-        aiProcess_PreTransformVertices
-    );
+    PROFILE_ZONE("AsyncSceneLoad::destroyScene");
+    if (mThread.joinable())
+        mThread.join();
+    destroySceneObjects(mSceneMgr, *mObjects);
+    mBuilder.reset();
+    mSceneData.reset();
+    mState = STATE_FAILED;
+}
 
-    if (!scene || !scene->mRootNode) {
-        std::cerr << "Error loading scene: " << importer.GetErrorString() << std::endl;
-        return;
+float AsyncSceneLoad::getProgress() const
+{
+    // NOTE: importing and uploading are weighted equally, which is good enough for a progress bar
+    switch (mState.load())
+    {
+    case STATE_IMPORTING:
+        return mMeshesTotal ? 0.5f * mMeshesConverted / mMeshesTotal : 0.0f;
+    case STATE_UPLOADING:
+        return 0.5f + (mItemsTotal ? 0.5f * mItemsDone / mItemsTotal : 0.0f);
+    default:
+        return 1.0f;
     }
+}
 
-    processAssimpNode(scene->mRootNode, scene, sceneMgr, parentNode);
-    processAssimpLights(scene, sceneMgr);
+const char * AsyncSceneLoad::getStatusText() const
+{
+    switch (mState.load())
+    {
+    case STATE_IMPORTING: return "Importing";
+    case STATE_UPLOADING: return "Uploading";
+    case STATE_DONE:      return "Done";
+    case STATE_FAILED:    return "Failed";
+    }
+    return "";
+}
+
+void AsyncSceneLoad::_BackgroundMain()
+{
+    Profiler::setThreadName("Scene Loader");
+    const bool ok = prepareSceneData(mFilename, mOptions, *mSceneData, mStats, mMeshesConverted, mMeshesTotal);
+    mState = ok ? STATE_UPLOADING : STATE_FAILED;
 }
@@ -1,7 +1,13 @@
 #ifndef SCENELOADER_H
 #define SCENELOADER_H
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace Ogre {
 
@@ -10,6 +16,131 @@ class SceneNode;
 
 } // namespace Ogre
 
-void loadSceneWithAssimp(const std::string& filename, Ogre::SceneManager* sceneMgr, Ogre::SceneNode* parentNode);
+struct SceneData;
+class SceneBuilder;
+struct SceneObjects;
+
+// how long each stage of a scene load took, in milliseconds
+struct SceneLoadStats
+{
+    // vertex cache efficiency of one mesh before and after the optimisation pass, see MeshOptimizer.h
+    struct MeshCacheReport
+    {
+        std::string name;
+        size_t triangles = 0;
+        float acmrBefore = 0.0f;
+        float atvrBefore = 0.0f;
+        float acmrAfter = 0.0f;
+        float atvrAfter = 0.0f;
+    };
+
+    double hashMs = 0.0; // hashing the source file for the mesh cache
+    double cacheReadMs = 0.0; // mapping and parsing the mesh cache
+    double importMs = 0.0; // Assimp::Importer::ReadFile() including the post-processing steps
+    double convertMs = 0.0; // per mesh CPU conversion (interleaving, bounds, index narrowing) on the worker pool
+    double cacheWriteMs = 0.0; // writing the mesh cache after a cold load
+    double uploadMs = 0.0; // creating GPU buffers, meshes and items on the render thread
+    double totalMs = 0.0;
+    size_t numMeshes = 0;
+    size_t numThreads = 0;
+    bool fromCache = false;
+    size_t vertexBytes = 0; // only known after importing, not when loading from the mesh cache
+    size_t vertexBytesSaved = 0;
+    size_t numLods = 0; // LOD levels generated over all meshes, also only known after importing
+    std::vector<MeshCacheReport> meshCacheReports; // one per mesh, only filled when importing with optimizeMeshes
+    size_t numItems = 0;
+    size_t numSourceItems = 0; // items the scene would have without merging (one per node/mesh pair)
+    size_t numStaticItems = 0;
+    size_t numMeshesBuilt = 0; // less than numItems when meshes are instanced across several nodes
+    size_t numDatablocks = 0; // distinct datablocks used by the scene
+    size_t numDatablocksCreated = 0; // the rest were shared with previously loaded scenes
+
+    // compared to the old one datablock per item, each of these was also a separate draw batch
+    size_t getDatablocksSaved() const {return numItems > numDatablocks ? numItems - numDatablocks : 0;}
+};
+
+void printSceneLoadStats(const SceneLoadStats &stats);
+
+enum class VertexCompression
+{
+    None, // 32-bit floats for everything
+    Compact // quantized positions, 16-bit packed normals/tangents and half float UVs, see VertexFormat.h
+};
+
+struct SceneLoadOptions
+{
+    // meshes with more than 65535 vertices normally get 32-bit indices, this splits them into 16-bit parts instead
+    bool splitLargeMeshes = false;
+    VertexCompression vertexCompression = VertexCompression::None;
+    // keeps the node hierarchy instead of baking it into the meshes (aiProcess_PreTransformVertices),
+    // so a mesh referenced by many nodes is only created once and drawn instanced
+    bool instancing = false;
+    // creates the nodes and items as SCENE_STATIC, so Ogre stops updating their transforms and bounds every frame
+    // NOTE: they are then attached under the static root node, rather than the parent node given to the loader
+    bool staticGeometry = false;
+    // bakes the node transforms into the meshes and merges all meshes sharing a datablock, which cuts draw calls
+    // (and throws away instancing, the merged copies are all separate vertices)
+    bool mergeStaticMeshes = false;
+    // simplifies every mesh into a chain of LOD index buffers (see MeshSimplifier.h), with switch distances
+    // derived from the mesh's size
+    bool generateLods = false;
+    // vertex cache, overdraw and vertex fetch ordering (see MeshOptimizer.h), this replaces Assimp's
+    // aiProcess_ImproveCacheLocality, which can't be tuned and doesn't report anything
+    bool optimizeMeshes = true;
+};
+
+// imports the scene's meshes with Assimp and the optimisation pass, without the mesh cache and without creating
+// anything in Ogre (so without a window), and prints the ACMR/ATVR of every mesh before and after the pass
+bool printMeshOptimizationReport(const std::string& filename, const SceneLoadOptions &options = SceneLoadOptions());
+
+// blocks until the whole scene is loaded
+SceneLoadStats loadSceneWithAssimp(const std::string& filename, Ogre::SceneManager* sceneMgr, Ogre::SceneNode* parentNode, const SceneLoadOptions &options = SceneLoadOptions());
+
+// loads a scene without blocking: importing (or reading the mesh cache) happens on a background thread,
+// and the GPU uploads are spread over several frames by calling update() once per frame on the render thread
+class AsyncSceneLoad
+{
+public:
+    enum State
+    {
+        STATE_IMPORTING,
+        STATE_UPLOADING,
+        STATE_DONE,
+        STATE_FAILED
+    };
+    AsyncSceneLoad(const std::string& filename, Ogre::SceneManager* sceneMgr, Ogre::SceneNode* parentNode, const SceneLoadOptions &options = SceneLoadOptions());
+    ~AsyncSceneLoad();
+    AsyncSceneLoad(const AsyncSceneLoad &) = delete;
+    AsyncSceneLoad & operator=(const AsyncSceneLoad &) = delete;
+    // spends roughly budgetMs creating GPU buffers, meshes and items (only does something once importing is done)
+    void update(double budgetMs);
+    State getState() const {return mState;}
+    bool isFinished() const {return mState == STATE_DONE || mState == STATE_FAILED;}
+    float getProgress() const; // 0.0 to 1.0
+    const char * getStatusText() const;
+    const std::string & getFilename() const {return mFilename;}
+    const SceneLoadStats & getStats() const {return mStats;} // NOTE: only complete once finished
+    // destroys the nodes, items, lights and meshes created so far (waiting for the import if it's still running),
+    // e.g. to load the scene again after its file changed; nothing else can be done with the load afterwards
+    void destroyScene();
+protected:
+    void _BackgroundMain();
+protected:
+    std::string mFilename;
+    SceneLoadOptions mOptions;
+    Ogre::SceneManager *mSceneMgr;
+    Ogre::SceneNode *mParentNode;
+    std::unique_ptr<SceneData> mSceneData;
+    std::unique_ptr<SceneBuilder> mBuilder;
+    std::unique_ptr<SceneObjects> mObjects;
+    SceneLoadStats mStats;
+    std::thread mThread;
+    std::atomic<State> mState;
+    std::atomic<size_t> mMeshesConverted;
+    std::atomic<size_t> mMeshesTotal;
+    size_t mItemsDone = 0;
+    size_t mItemsTotal = 0;
+    std::chrono::steady_clock::time_point mStartTime;
+};
 
 #endif // SCENELOADER_H
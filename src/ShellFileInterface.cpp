@@ -27,41 +27,237 @@
  */
 
 #include "ShellFileInterface.h"
+#include "Profiler.h"
+
 #include <stdio.h>
+#include <string.h>
+
+#include <fcntl.h> // for open()
+#include <sys/mman.h> // for mmap()
+#include <sys/stat.h> // for fstat()
+#include <unistd.h> // for close()
+
+// NOTE: the layout is also written by tools/pack_ui_files.py, everything is little-endian
+static const char PACK_MAGIC[4] = {'R', 'P', 'A', 'K'};
+static const uint32_t PACK_VERSION = 1;
+
+struct PackHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t numEntries;
+	uint32_t tocSize; // the entries follow the header: uint64_t offset, uint64_t size, uint32_t pathLength, the path
+};
+
+ShellFileInterface::ShellFileInterface(const Rml::String& root, const Rml::String& pack) : root(root), mapping(nullptr), mapping_size(0)
+{
+	if (!pack.empty() && !OpenPack(root + pack))
+		printf("No UI pack \"%s\", reading the UI files from disk\n", (root + pack).c_str());
+}
+
+ShellFileInterface::~ShellFileInterface()
+{
+	if (mapping)
+		munmap(mapping, mapping_size);
+}
+
+bool ShellFileInterface::OpenPack(const Rml::String& path)
+{
+	PROFILE_FUNCTION();
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(PackHeader)))
+	{
+		close(fd);
+		return false;
+	}
+	const size_t size = static_cast<size_t>(st.st_size);
+	void* const mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // NOTE: the mapping stays valid after closing the descriptor
+	if (mapped == MAP_FAILED)
+		return false;
+
+	const Rml::byte* const bytes = static_cast<const Rml::byte*>(mapped);
+	PackHeader header;
+	memcpy(&header, bytes, sizeof(header));
+	bool ok = memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0 && header.version == PACK_VERSION &&
+		header.tocSize <= size - sizeof(PackHeader);
+	size_t position = sizeof(PackHeader);
+	const size_t tocEnd = position + header.tocSize;
+	for (uint32_t i = 0; ok && i < header.numEntries; ++i)
+	{
+		uint64_t offset, entrySize;
+		uint32_t pathLength;
+		const size_t fixedSize = sizeof(offset) + sizeof(entrySize) + sizeof(pathLength);
+		if (position + fixedSize > tocEnd)
+		{
+			ok = false;
+			break;
+		}
+		memcpy(&offset, bytes + position, sizeof(offset));
+		memcpy(&entrySize, bytes + position + sizeof(offset), sizeof(entrySize));
+		memcpy(&pathLength, bytes + position + sizeof(offset) + sizeof(entrySize), sizeof(pathLength));
+		position += fixedSize;
+		if (position + pathLength > tocEnd || offset > size || entrySize > size - offset)
+		{
+			ok = false;
+			break;
+		}
+		const Rml::String entryPath(reinterpret_cast<const char*>(bytes + position), pathLength);
+		position += pathLength;
+		entries[NormalizePath(entryPath)] = Entry{bytes + offset, static_cast<size_t>(entrySize)};
+	}
+	if (!ok)
+	{
+		printf("error: the UI pack \"%s\" is broken\n", path.c_str());
+		entries.clear();
+		munmap(mapped, size);
+		return false;
+	}
+	mapping = mapped;
+	mapping_size = size;
+	printf("UI pack \"%s\": %u files\n", path.c_str(), header.numEntries);
+	return true;
+}
 
-ShellFileInterface::ShellFileInterface(const Rml::String& root) : root(root) {}
+// NOTE: RmlUi joins relative paths onto the document's directory, e.g. "data/../assets/window.rml"
+Rml::String ShellFileInterface::NormalizePath(const Rml::String& path)
+{
+	Rml::Vector<Rml::String> parts;
+	size_t start = 0;
+	while (start <= path.size())
+	{
+		size_t end = path.find_first_of("/\\", start);
+		if (end == Rml::String::npos)
+			end = path.size();
+		const Rml::String part = path.substr(start, end - start);
+		if (part == "..")
+		{
+			if (!parts.empty() && parts.back() != "..")
+				parts.pop_back();
+			else
+				parts.push_back(part);
+		}
+		else if (!part.empty() && part != ".")
+			parts.push_back(part);
+		start = end + 1;
+	}
+	Rml::String result;
+	for (const Rml::String& part : parts)
+	{
+		if (!result.empty())
+			result += '/';
+		result += part;
+	}
+	return result;
+}
+
+const ShellFileInterface::Entry* ShellFileInterface::FindEntry(const Rml::String& path) const
+{
+	const auto it = entries.find(NormalizePath(path));
+	return it != entries.end() ? &it->second : nullptr;
+}
 
-ShellFileInterface::~ShellFileInterface() {}
+bool ShellFileInterface::GetView(const Rml::String& path, const Rml::byte*& data, size_t& size) const
+{
+	const Entry* const entry = FindEntry(path);
+	if (!entry)
+		return false;
+	data = entry->data;
+	size = entry->size;
+	return true;
+}
 
 Rml::FileHandle ShellFileInterface::Open(const Rml::String& path)
 {
-    printf("DEBUG: Opening: \"%s\"\n", (root + path).c_str());
+	if (IsUsingPack())
+	{
+		const Entry* const entry = FindEntry(path);
+		if (!entry)
+		{
+			printf("error: \"%s\" isn't in the UI pack\n", path.c_str());
+			return (Rml::FileHandle) nullptr;
+		}
+		return (Rml::FileHandle) new OpenFile{nullptr, *entry, 0};
+	}
+
 	// Attempt to open the file relative to the application's root.
 	FILE* fp = fopen((root + path).c_str(), "rb");
-	if (fp != nullptr)
-		return (Rml::FileHandle)fp;
-
-	// Attempt to open the file relative to the current working directory.
-	fp = fopen(path.c_str(), "rb");
-	return (Rml::FileHandle)fp;
+	if (fp == nullptr)
+	{
+		// Attempt to open the file relative to the current working directory.
+		fp = fopen(path.c_str(), "rb");
+	}
+	if (fp == nullptr)
+		return (Rml::FileHandle) nullptr;
+	return (Rml::FileHandle) new OpenFile{fp, Entry{nullptr, 0}, 0};
 }
 
 void ShellFileInterface::Close(Rml::FileHandle file)
 {
-	fclose((FILE*)file);
+	OpenFile* const open_file = (OpenFile*)file;
+	if (open_file->fp)
+		fclose(open_file->fp);
+	delete open_file;
 }
 
 size_t ShellFileInterface::Read(void* buffer, size_t size, Rml::FileHandle file)
 {
-	return fread(buffer, 1, size, (FILE*)file);
+	OpenFile* const open_file = (OpenFile*)file;
+	if (open_file->fp)
+		return fread(buffer, 1, size, open_file->fp);
+	const size_t remaining = open_file->position < open_file->entry.size ? open_file->entry.size - open_file->position : 0;
+	const size_t count = size < remaining ? size : remaining;
+	memcpy(buffer, open_file->entry.data + open_file->position, count);
+	open_file->position += count;
+	return count;
 }
 
 bool ShellFileInterface::Seek(Rml::FileHandle file, long offset, int origin)
 {
-	return fseek((FILE*)file, offset, origin) == 0;
+	OpenFile* const open_file = (OpenFile*)file;
+	if (open_file->fp)
+		return fseek(open_file->fp, offset, origin) == 0;
+	long base = 0;
+	if (origin == SEEK_CUR)
+		base = static_cast<long>(open_file->position);
+	else if (origin == SEEK_END)
+		base = static_cast<long>(open_file->entry.size);
+	if (base + offset < 0)
+		return false;
+	// NOTE: like fseek(), seeking past the end is allowed, reading there returns nothing
+	open_file->position = static_cast<size_t>(base + offset);
+	return true;
 }
 
 size_t ShellFileInterface::Tell(Rml::FileHandle file)
 {
-	return ftell((FILE*)file);
+	OpenFile* const open_file = (OpenFile*)file;
+	if (open_file->fp)
+		return ftell(open_file->fp);
+	return open_file->position;
+}
+
+size_t ShellFileInterface::Length(Rml::FileHandle file)
+{
+	OpenFile* const open_file = (OpenFile*)file;
+	if (open_file->fp)
+		return Rml::FileInterface::Length(file);
+	return open_file->entry.size;
+}
+
+bool ShellFileInterface::LoadFile(const Rml::String& path, Rml::String& out_data)
+{
+	if (!IsUsingPack())
+		return Rml::FileInterface::LoadFile(path, out_data);
+	const Entry* const entry = FindEntry(path);
+	if (!entry)
+	{
+		printf("error: \"%s\" isn't in the UI pack\n", path.c_str());
+		return false;
+	}
+	out_data.assign(reinterpret_cast<const char*>(entry->data), entry->size);
+	return true;
 }
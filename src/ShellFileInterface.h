@@ -32,16 +32,35 @@
 #include <RmlUi/Core/FileInterface.h>
 #include <RmlUi/Core/Types.h>
 
+#include <cstdio>
+#include <unordered_map>
+
 /**
     RmlUi file interface for the shell examples.
+
+    Serves the files from a pack (made with tools/pack_ui_files.py) when one is given: the pack is memory-mapped
+    once and its table of contents read into a map, so opening a file is a lookup and reading it is a copy out of
+    the mapping, without any system calls. Without a pack (or if it can't be opened) the files are read from disk
+    with stdio, which is meant for development, where the files are being edited.
     @author Lloyd Weehuizen
  */
 
 class ShellFileInterface : public Rml::FileInterface {
 public:
-	ShellFileInterface(const Rml::String& root);
+	/// pack is relative to root, empty reads the files from disk
+	ShellFileInterface(const Rml::String& root, const Rml::String& pack = Rml::String());
 	virtual ~ShellFileInterface();
 
+	/// Returns path without "." and "dir/.." parts, with forward slashes, e.g. "data/../assets/./window.rml" -> "assets/window.rml".
+	static Rml::String NormalizePath(const Rml::String& path);
+
+	/// Returns true if the files are served from the pack.
+	bool IsUsingPack() const { return mapping != nullptr; }
+
+	/// Returns a view of a whole file in the pack, without copying it; it stays valid as long as the file interface.
+	/// Returns false if there is no pack or the file isn't in it.
+	bool GetView(const Rml::String& path, const Rml::byte*& data, size_t& size) const;
+
 	/// Opens a file.
 	Rml::FileHandle Open(const Rml::String& path) override;
 
@@ -57,8 +76,31 @@ public:
 	/// Returns the current position of the file pointer.
 	size_t Tell(Rml::FileHandle file) override;
 
+	/// Returns the length of a previously opened file.
+	size_t Length(Rml::FileHandle file) override;
+
+	/// Loads a whole file, straight from the pack if it's in there.
+	bool LoadFile(const Rml::String& path, Rml::String& out_data) override;
+
 private:
+	struct Entry {
+		const Rml::byte* data;
+		size_t size;
+	};
+	// an open file, either in the pack (fp is null) or on disk
+	struct OpenFile {
+		FILE* fp;
+		Entry entry;
+		size_t position;
+	};
+
+	bool OpenPack(const Rml::String& path);
+	const Entry* FindEntry(const Rml::String& path) const;
+
 	Rml::String root;
+	void* mapping;
+	size_t mapping_size;
+	std::unordered_map<Rml::String, Entry> entries; // by normalized path, relative to root
 };
 
 #endif
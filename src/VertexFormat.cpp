@@ -0,0 +1,160 @@
+#include "VertexFormat.h"
+#include "SceneData.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace VertexFormat {
+
+uint32_t getStride(uint32_t vertexFlags)
+{
+    const bool compact = vertexFlags & VERTEX_COMPACT;
+    uint32_t stride = compact ? 8 + 8 : 12 + 12; // position + normal (or QTangent)
+    if (vertexFlags & VERTEX_HAS_UV)
+        stride += compact ? 4 : 8;
+    if ((vertexFlags & VERTEX_HAS_TANGENT) && !compact)
+        stride += 16;
+    return stride;
+}
+
+void getQuantizationScale(const float aabbMin[3], const float aabbMax[3], float scale[3])
+{
+    float largestExtent = 0.0f;
+    for (int axis = 0; axis < 3; ++axis)
+        largestExtent = std::max(largestExtent, aabbMax[axis] - aabbMin[axis]);
+    const float minimumScale = std::max(largestExtent * 1e-4f, 1e-6f);
+    for (int axis = 0; axis < 3; ++axis)
+        scale[axis] = std::max(aabbMax[axis] - aabbMin[axis], minimumScale);
+}
+
+uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x007FFFFF;
+
+    if (((bits >> 23) & 0xFF) == 0xFF) // infinity or NaN
+        return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    if (exponent >= 31) // too large, clamp to infinity
+        return static_cast<uint16_t>(sign | 0x7C00);
+    if (exponent <= 0)
+    {
+        if (exponent < -10) // too small, flush to zero
+            return static_cast<uint16_t>(sign);
+        // denormal
+        mantissa |= 0x00800000;
+        const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1) // round to nearest
+            half++;
+        return static_cast<uint16_t>(sign | half);
+    }
+    uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000) // round to nearest, a carry into the exponent is still correct
+        half++;
+    return static_cast<uint16_t>(half);
+}
+
+int16_t packSnorm16(float value)
+{
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+uint16_t packUnorm16(float value)
+{
+    return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+static void normalize(float v[3])
+{
+    const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (length > 0.0f) {
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+}
+
+static void cross(const float a[3], const float b[3], float result[3])
+{
+    result[0] = a[1] * b[2] - a[2] * b[1];
+    result[1] = a[2] * b[0] - a[0] * b[2];
+    result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+void packQTangent(const float normal[3], const float tangent[3], float reflection, int16_t result[4])
+{
+    // build an orthonormal frame with the normal as X axis and the tangent as Y axis (like Ogre's importV1())
+    float x[3] = {normal[0], normal[1], normal[2]};
+    normalize(x);
+    const float dot = x[0] * tangent[0] + x[1] * tangent[1] + x[2] * tangent[2];
+    float y[3] = {tangent[0] - x[0] * dot, tangent[1] - x[1] * dot, tangent[2] - x[2] * dot};
+    if (y[0] * y[0] + y[1] * y[1] + y[2] * y[2] < 1e-12f) {
+        // no usable tangent, any vector perpendicular to the normal will do
+        const float other[3] = {std::fabs(x[0]) < 0.9f ? 1.0f : 0.0f, std::fabs(x[0]) < 0.9f ? 0.0f : 1.0f, 0.0f};
+        cross(other, x, y);
+    }
+    normalize(y);
+    float z[3];
+    cross(x, y, z);
+
+    // rotation matrix (with x, y, z as columns) to quaternion
+    float q[4]; // w, x, y, z
+    const float trace = x[0] + y[1] + z[2];
+    if (trace > 0.0f) {
+        const float s = std::sqrt(trace + 1.0f) * 2.0f;
+        q[0] = 0.25f * s;
+        q[1] = (y[2] - z[1]) / s;
+        q[2] = (z[0] - x[2]) / s;
+        q[3] = (x[1] - y[0]) / s;
+    } else if (x[0] > y[1] && x[0] > z[2]) {
+        const float s = std::sqrt(1.0f + x[0] - y[1] - z[2]) * 2.0f;
+        q[0] = (y[2] - z[1]) / s;
+        q[1] = 0.25f * s;
+        q[2] = (y[0] + x[1]) / s;
+        q[3] = (z[0] + x[2]) / s;
+    } else if (y[1] > z[2]) {
+        const float s = std::sqrt(1.0f + y[1] - x[0] - z[2]) * 2.0f;
+        q[0] = (z[0] - x[2]) / s;
+        q[1] = (y[0] + x[1]) / s;
+        q[2] = 0.25f * s;
+        q[3] = (z[1] + y[2]) / s;
+    } else {
+        const float s = std::sqrt(1.0f + z[2] - x[0] - y[1]) * 2.0f;
+        q[0] = (x[1] - y[0]) / s;
+        q[1] = (z[0] + x[2]) / s;
+        q[2] = (z[1] + y[2]) / s;
+        q[3] = 0.25f * s;
+    }
+    const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    for (int i = 0; i < 4; ++i)
+        q[i] /= length;
+
+    // the sign of w stores the reflection, so w must never quantize to zero
+    if (q[0] < 0.0f) {
+        for (int i = 0; i < 4; ++i)
+            q[i] = -q[i];
+    }
+    const float bias = 1.0f / 32767.0f;
+    if (q[0] < bias) {
+        const float normFactor = std::sqrt(1.0f - bias * bias);
+        for (int i = 1; i < 4; ++i)
+            q[i] *= normFactor;
+        q[0] = bias;
+    }
+    if (reflection < 0.0f) {
+        for (int i = 0; i < 4; ++i)
+            q[i] = -q[i];
+    }
+
+    // NOTE: Ogre's VET_SHORT4_SNORM order is x, y, z, w
+    result[0] = packSnorm16(q[1]);
+    result[1] = packSnorm16(q[2]);
+    result[2] = packSnorm16(q[3]);
+    result[3] = packSnorm16(q[0]);
+}
+
+} // namespace VertexFormat
@@ -0,0 +1,32 @@
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+#include <cstdint>
+
+// helpers for the interleaved vertex layouts described by SceneMeshData::vertexFlags
+//
+// full:    position FLOAT3, normal FLOAT3, [uv FLOAT2], [tangent FLOAT4]
+// compact: position USHORT4_NORM (relative to the mesh AABB), QTangent SHORT4_SNORM, [uv HALF2]
+//
+// NOTE: Ogre's Hlms treats a SHORT4_SNORM normal as a "QTangent", a quaternion holding the whole normal/tangent frame,
+// so compact meshes don't need a separate tangent channel
+namespace VertexFormat {
+
+// size in bytes of one vertex
+uint32_t getStride(uint32_t vertexFlags);
+
+// compact positions are stored as (position - aabbMin) / scale, where scale is the AABB extent
+// NOTE: axes where the mesh is flat get a tiny non-zero scale, so the scale can always be inverted
+void getQuantizationScale(const float aabbMin[3], const float aabbMax[3], float scale[3]);
+
+uint16_t floatToHalf(float value);
+int16_t packSnorm16(float value); // -1.0 to 1.0
+uint16_t packUnorm16(float value); // 0.0 to 1.0
+
+// encodes a normal/tangent frame the same way Ogre's Mesh::importV1() does with qTangents enabled,
+// reflection is the handedness of the bitangent (-1 or 1), tangent doesn't have to be orthogonal to normal
+void packQTangent(const float normal[3], const float tangent[3], float reflection, int16_t result[4]);
+
+} // namespace VertexFormat
+
+#endif // VERTEXFORMAT_H
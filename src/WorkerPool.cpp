@@ -0,0 +1,84 @@
+#include "WorkerPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <string>
+
+WorkerPool::WorkerPool(size_t numThreads) :
+    mFunc(nullptr),
+    mCount(0),
+    mNextIndex(0),
+    mBusyWorkers(0),
+    mGeneration(0),
+    mQuit(false)
+{
+    if (numThreads == 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    // the thread calling parallelFor() counts as one of the workers
+    for (size_t i = 1; i < numThreads; ++i)
+        mThreads.emplace_back(&WorkerPool::_WorkerMain, this, i);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWakeCondition.notify_all();
+    for (std::thread &thread : mThreads)
+        thread.join();
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)> &func)
+{
+    if (count == 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFunc = &func;
+        mCount = count;
+        mNextIndex = 0;
+        mBusyWorkers = mThreads.size();
+        mGeneration++;
+    }
+    mWakeCondition.notify_all();
+
+    _RunJob();
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCondition.wait(lock, [this]() {return mBusyWorkers == 0;});
+    mFunc = nullptr;
+}
+
+void WorkerPool::_WorkerMain(size_t index)
+{
+    Profiler::setThreadName("Worker " + std::to_string(index));
+    unsigned int seenGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWakeCondition.wait(lock, [this, seenGeneration]() {return mQuit || mGeneration != seenGeneration;});
+            if (mQuit)
+                return;
+            seenGeneration = mGeneration;
+        }
+
+        _RunJob();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mBusyWorkers--;
+        }
+        mDoneCondition.notify_one();
+    }
+}
+
+void WorkerPool::_RunJob()
+{
+    PROFILE_ZONE("WorkerPool job");
+    size_t index;
+    while ((index = mNextIndex.fetch_add(1)) < mCount)
+        (*mFunc)(index);
+}
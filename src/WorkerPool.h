@@ -0,0 +1,42 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a minimal pool of persistent worker threads, used for CPU heavy loading work that can be split per item
+class WorkerPool
+{
+public:
+    // numThreads == 0 means one thread per hardware thread
+    explicit WorkerPool(size_t numThreads = 0);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool & operator=(const WorkerPool &) = delete;
+
+    // calls func(i) for every i in [0, count), blocks until all of them are done
+    // NOTE: the calling thread helps out, so this also works with a pool of one thread
+    void parallelFor(size_t count, const std::function<void(size_t)> &func);
+    size_t getNumThreads() const {return mThreads.size() + 1;}
+protected:
+    void _WorkerMain(size_t index);
+    void _RunJob();
+protected:
+    std::vector<std::thread> mThreads;
+    std::mutex mMutex;
+    std::condition_variable mWakeCondition;
+    std::condition_variable mDoneCondition;
+    const std::function<void(size_t)> *mFunc;
+    size_t mCount;
+    std::atomic<size_t> mNextIndex;
+    size_t mBusyWorkers;
+    unsigned int mGeneration;
+    bool mQuit;
+};
+
+#endif // WORKERPOOL_H
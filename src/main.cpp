@@ -1,24 +1,119 @@
-#define ENABLE_RMLUI_CONTEXT
-
 #include "FPSGame.h"
+#include "Benchmark.h"
 #include "GUI.h"
+#include "CompositorPassRmlUi.h"
+#include "DataModelPublisher.h"
+#include "FileWatcher.h"
+#include "FramePacer.h"
+#include "FrameTimingHistory.h"
+#include "GpuTimer.h"
+#include "InputRecording.h"
+#include "Profiler.h"
+#include "SceneLoader.h"
 
 #include <OgreRoot.h>
 #include <OgreFrameStats.h>
 
+#include <RmlUi/Core/Core.h>
 #include <RmlUi/Core/EventListener.h>
 #include <RmlUi/Core/ElementDocument.h>
 
 #include <SDL.h>
 #include <SDL_opengl.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 
-#include <cstdlib> // for EXIT_FAILURE and EXIT_SUCCESS
+#include <climits> // for PATH_MAX
+#include <cmath> // for std::lround()
+#include <cstdlib> // for EXIT_FAILURE, EXIT_SUCCESS and realpath()
 
 static const int WINDOW_WIDTH = 1280;
 static const int WINDOW_HEIGHT = 720;
-static const bool DISABLE_VSYNC = false;
+static const char DEFAULT_SCENE[] = "../data/test_scene.glb";
+// how many of the latest frames the frame time graph shows
+static const size_t GRAPH_FRAMES = 120;
+static const char DEFAULT_PROFILE_PATH[] = "profile.json";
+// where F7 adds the camera position as a keyframe, unless --camera-path says otherwise
+static const char DEFAULT_CAMERA_PATH[] = "camera_path.txt";
+// the pack of the UI files, relative to the data root (the parent directory), made with tools/pack_ui_files.py
+static const char DEFAULT_UI_PACK[] = "ui.pak";
+// where the glyph sets drawn are remembered between runs, to rasterize them at startup
+static const char DEFAULT_GLYPH_CACHE[] = "glyph_cache.txt";
+// what --hot-reload watches, besides the scene's directory
+static const char * const HOT_RELOAD_DIRECTORIES[] = {"../assets", "../data"};
+
+// the GPU timestamps of a frame, the RmlUi ones are inside the Ogre ones unless RmlUi has its own GL context
+enum GpuTimestamp
+{
+    GPU_OGRE_BEGIN,
+    GPU_RMLUI_BEGIN,
+    GPU_RMLUI_END,
+    GPU_OGRE_END,
+    GPU_TIMESTAMP_COUNT
+};
+
+// GPU time added up since the frame stats panel was last updated
+struct GpuTimeTotals
+{
+    double ogreMs = 0.0;
+    double rmluiMs = 0.0;
+    int ogreFrames = 0;
+    int rmluiFrames = 0;
+};
+
+static void recordGpuZone(const GpuTimer &timer, GpuTimestamp begin, GpuTimestamp end, const char *name)
+{
+    unsigned long long beginNs, endNs;
+    if (timer.getProfilerTimeNs(begin, beginNs) && timer.getProfilerTimeNs(end, endNs))
+        Profiler::recordZone("GPU", name, beginNs, endNs);
+}
+
+// takes the results of an earlier frame from timer, call after GpuTimer::beginFrame() returned true
+static void collectGpuTimes(const GpuTimer &timer, GpuTimeTotals &totals)
+{
+    float ogreMs = 0.0f, rmluiMs = 0.0f;
+    const bool hasOgre = timer.getElapsedMs(GPU_OGRE_BEGIN, GPU_OGRE_END, ogreMs);
+    const bool hasRmlUi = timer.getElapsedMs(GPU_RMLUI_BEGIN, GPU_RMLUI_END, rmluiMs);
+    if (hasOgre)
+    {
+        totals.ogreMs += hasRmlUi ? std::max(0.0f, ogreMs - rmluiMs) : ogreMs;
+        totals.ogreFrames++;
+    }
+    if (hasRmlUi)
+    {
+        totals.rmluiMs += rmluiMs;
+        totals.rmluiFrames++;
+    }
+    recordGpuZone(timer, GPU_OGRE_BEGIN, GPU_OGRE_END, "FPSGame::draw");
+    recordGpuZone(timer, GPU_RMLUI_BEGIN, GPU_RMLUI_END, "RmlUi");
+}
+
+// the absolute path of an existing file, empty if it doesn't exist
+static std::string getRealPath(const std::string &path)
+{
+    char buffer[PATH_MAX];
+    return realpath(path.c_str(), buffer) ? std::string(buffer) : std::string();
+}
+
+static bool endsWith(const std::string &text, const char *suffix)
+{
+    const size_t length = std::char_traits<char>::length(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+static float millisecondsSince(std::chrono::steady_clock::time_point &start)
+{
+    // NOTE: also moves start to now, so consecutive calls time consecutive phases
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const float ms = std::chrono::duration<float, std::milli>(now - start).count();
+    start = now;
+    return ms;
+}
 
 class ResetEventListener : public Rml::EventListener
 {
@@ -84,137 +179,600 @@ static int mainBody(int argc, const char *argv[])
     }
 
     SDL_GL_MakeCurrent(window.get(), ogreContext.get());
-    if (DISABLE_VSYNC)
-        SDL_GL_SetSwapInterval(0);
-    FPSGame game(window.get());
+    Profiler::setThreadName("Main");
+    // NOTE: an optional argument picks the scene to load, e.g. "../data/large_mesh_test.glb"
+    FPSGameOptions gameOptions;
+    gameOptions.scenePath = DEFAULT_SCENE;
+    FramePacer::Mode pacingMode = FramePacer::Mode::VSync;
+    bool pacingModeSet = false;
+    double targetFps = 60.0;
+    int profileFrames = 0; // NOTE: captures from the start, so the startup is in it too
+    std::string profilePath = DEFAULT_PROFILE_PATH;
+    bool benchmarking = false;
+    BenchmarkOptions benchmarkOptions;
+    std::string cameraPathFile;
+    bool scenePathSet = false;
+    std::string recordPath;
+    std::string replayPath;
+    std::string uiPack = DEFAULT_UI_PACK;
+    bool hotReload = false;
+    std::string glyphCache = DEFAULT_GLYPH_CACHE;
+    bool retainedUi = false;
+    std::chrono::steady_clock::duration statsInterval = GUI::DataModelPublisher::DEFAULT_INTERVAL;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+            gameOptions.numThreads = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--simulation-thread")
+            gameOptions.simulationThread = true;
+        else if (arg == "--tick-rate" && i + 1 < argc)
+            gameOptions.tickRate = std::max(1.0, std::strtod(argv[++i], nullptr));
+        else if (arg == "--pacing" && i + 1 < argc)
+        {
+            if (FramePacer::parseMode(argv[++i], pacingMode))
+                pacingModeSet = true;
+            else
+                fprintf(stderr, "warning: unknown frame pacing mode \"%s\" (vsync, adaptive, limit or uncapped)\n", argv[i]);
+        }
+        else if (arg == "--fps" && i + 1 < argc)
+            targetFps = std::max(1.0, std::strtod(argv[++i], nullptr));
+        else if (arg == "--profile-frames" && i + 1 < argc)
+            profileFrames = std::atoi(argv[++i]);
+        else if (arg == "--profile-output" && i + 1 < argc)
+            profilePath = argv[++i];
+        else if (arg == "--benchmark")
+            benchmarking = true;
+        else if (arg == "--benchmark-frames" && i + 1 < argc)
+            benchmarkOptions.frames = std::atoi(argv[++i]);
+        else if (arg == "--benchmark-warmup" && i + 1 < argc)
+            benchmarkOptions.warmupFrames = std::atoi(argv[++i]);
+        else if (arg == "--benchmark-output" && i + 1 < argc)
+            benchmarkOptions.outputPath = argv[++i];
+        else if (arg == "--camera-path" && i + 1 < argc)
+            cameraPathFile = argv[++i];
+        else if (arg == "--stats-interval" && i + 1 < argc)
+            statsInterval = std::chrono::milliseconds(std::max(0, std::atoi(argv[++i])));
+        else if (arg == "--ui-pack" && i + 1 < argc)
+            uiPack = argv[++i];
+        else if (arg == "--loose-ui-files")
+            uiPack.clear();
+        else if (arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (arg == "--hot-reload")
+            hotReload = true;
+        else if (arg == "--glyph-cache" && i + 1 < argc)
+            glyphCache = argv[++i];
+        else if (arg == "--no-glyph-cache")
+            glyphCache.clear();
+        else if (arg == "--retained-ui")
+            retainedUi = true;
+        else
+        {
+            gameOptions.scenePath = arg;
+            scenePathSet = true;
+        }
+    }
+    if (!replayPath.empty() && (benchmarking || !recordPath.empty()))
+    {
+        fprintf(stderr, "error: --replay can't be combined with --benchmark or --record\n");
+        return EXIT_FAILURE;
+    }
+    // NOTE: a replay plays the recorded scene with the recorded tick rate, unless told to play another scene
+    std::unique_ptr<InputReplayer> replayer;
+    if (!replayPath.empty())
+    {
+        replayer = std::make_unique<InputReplayer>();
+        if (!replayer->open(replayPath))
+            return EXIT_FAILURE;
+        if (!scenePathSet)
+            gameOptions.scenePath = replayer->getHeader().scenePath;
+        else if (gameOptions.scenePath != replayer->getHeader().scenePath)
+            fprintf(stderr, "warning: replaying input recorded in \"%s\" in \"%s\"\n", replayer->getHeader().scenePath.c_str(), gameOptions.scenePath.c_str());
+        gameOptions.tickRate = replayer->getHeader().tickRate;
+    }
+    InputRecorder recorder;
+    if (!recordPath.empty())
+    {
+        InputRecordingHeader header;
+        header.scenePath = gameOptions.scenePath;
+        header.tickRate = gameOptions.tickRate;
+        if (!recorder.open(recordPath, header))
+            return EXIT_FAILURE;
+    }
+    // NOTE: the game logic has to be ticked from the frames' deltas to tick the same way again
+    const bool recordingSession = recorder.isOpen() || replayer;
+    if (recordingSession && gameOptions.simulationThread)
+    {
+        fprintf(stderr, "warning: --simulation-thread is ignored when recording or replaying input\n");
+        gameOptions.simulationThread = false;
+    }
+    // NOTE: the pack is made before running, the files it was made from can't be reloaded from it
+    if (hotReload && !uiPack.empty())
+    {
+        fprintf(stderr, "note: --hot-reload reads the UI files from disk instead of \"%s\"\n", uiPack.c_str());
+        uiPack.clear();
+    }
+    // NOTE: a benchmark (or a replay) measures how fast frames can be made, not the refresh rate of the monitor
+    if ((benchmarking || replayer) && !pacingModeSet)
+        pacingMode = FramePacer::Mode::Uncapped;
+    std::unique_ptr<Benchmark> benchmark;
+    if (benchmarking)
+    {
+        benchmarkOptions.cameraPathFile = cameraPathFile;
+        benchmark = std::make_unique<Benchmark>(benchmarkOptions, gameOptions.scenePath);
+        if (!benchmark->loadCameraPath())
+            return EXIT_FAILURE;
+    }
+    if (profileFrames > 0)
+        Profiler::beginCapture();
+    FPSGame game(window.get(), gameOptions);
     if (!game.getWindow())
         return EXIT_FAILURE;
+    // NOTE: timers only work in the context they were created in, with two contexts each one gets a timer
+    // (and their queries aren't deleted in the right context on exit, which doesn't matter as both go away)
+    GpuTimer ogreGpuTimer(GPU_TIMESTAMP_COUNT);
 
 #ifdef ENABLE_RMLUI_CONTEXT
     SDL_GL_MakeCurrent(window.get(), rmluiContext.get());
-    if (DISABLE_VSYNC)
-        SDL_GL_SetSwapInterval(0);
+    GpuTimer rmluiGpuTimer(GPU_TIMESTAMP_COUNT);
+#endif // ENABLE_RMLUI_CONTEXT
+    FramePacer pacer(window.get(), pacingMode, targetFps);
+    GUI::GUI gui(window.get(), uiPack, glyphCache);
+    // NOTE: the slider only has whole numbers, so the pacer's target is only changed when the slider moved, a
+    // fractional --fps (e.g. 59.94) stays as it is until then
+    int guiTargetFps = 0;
+    {
+        GUI::FramePacingData &pacing = gui.getFramePacingData();
+        pacing.mode = FramePacer::getModeName(pacer.getMode());
+        pacing.targetFps = static_cast<int>(std::lround(pacer.getTargetFps()));
+        guiTargetFps = pacing.targetFps;
+    }
+#ifndef ENABLE_RMLUI_CONTEXT
+    // the UI is drawn by a compositor pass after the scene, in the same GL context
+    if (CompositorPassRmlUiProvider * const passProvider = game.getRmlUiPassProvider())
+    {
+        passProvider->setContext(gui.getContext(), gui.getRenderInterface());
+        passProvider->setGpuTimer(&ogreGpuTimer, GPU_RMLUI_BEGIN, GPU_RMLUI_END);
+    }
+    gui.getRenderInterface()->SetRetained(retainedUi);
+#else
+    if (retainedUi)
+        fprintf(stderr, "warning: --retained-ui is ignored, RmlUi has its own GL context (ENABLE_RMLUI_CONTEXT)\n");
 #endif // ENABLE_RMLUI_CONTEXT
-    GUI::GUI gui(window.get());
     ResetEventListener resetEventListener;
-    if (Rml::ElementDocument * const document = gui.getFrameStatsDocument())
+    // NOTE: again whenever the document is reloaded
+    const auto attachResetEventListener = [&]()
     {
-        if (Rml::Element * const element = gui.getFrameStatsDocument()->GetElementById("resetButton"))
-            element->AddEventListener(Rml::EventId::Click, &resetEventListener);
+        if (Rml::ElementDocument * const document = gui.getFrameStatsDocument())
+        {
+            if (Rml::Element * const element = document->GetElementById("resetButton"))
+                element->AddEventListener(Rml::EventId::Click, &resetEventListener);
+        }
+    };
+    attachResetEventListener();
+
+    // --hot-reload
+    std::unique_ptr<FileWatcher> fileWatcher;
+    bool sceneReloading = false; // until the reloaded scene is done loading
+    const std::string sceneRealPath = getRealPath(gameOptions.scenePath);
+    if (hotReload)
+    {
+        fileWatcher = std::make_unique<FileWatcher>();
+        std::vector<std::string> watchedDirectories;
+        for (const char * const directory : HOT_RELOAD_DIRECTORIES)
+        {
+            if (fileWatcher->addDirectory(directory))
+                watchedDirectories.push_back(getRealPath(directory));
+        }
+        // NOTE: the scene can be anywhere, its directory is only watched (recursively) if it isn't already
+        const size_t slash = gameOptions.scenePath.rfind('/');
+        const std::string sceneDirectory = slash == std::string::npos ? std::string(".") : gameOptions.scenePath.substr(0, slash);
+        const std::string sceneDirectoryRealPath = getRealPath(sceneDirectory);
+        // NOTE: on a path separator boundary, "/project/data" isn't below "/project/dat"
+        bool sceneDirectoryWatched = false;
+        for (const std::string &directory : watchedDirectories)
+        {
+            sceneDirectoryWatched |= !directory.empty() && sceneDirectoryRealPath.compare(0, directory.size(), directory) == 0 &&
+                (sceneDirectoryRealPath.size() == directory.size() || sceneDirectoryRealPath[directory.size()] == '/');
+        }
+        if (!sceneDirectoryWatched)
+            fileWatcher->addDirectory(sceneDirectory);
     }
 
-    Uint64 old_ticks = SDL_GetTicks64();
+    // NOTE: a high resolution clock, SDL_GetTicks64() only has millisecond resolution
+    std::chrono::steady_clock::time_point old_time = std::chrono::steady_clock::now();
+    FrameTimingHistory frameTimings;
+    GpuTimeTotals gpuTimes;
+    std::vector<FrameTiming> graphTimings(GRAPH_FRAMES);
+    Rml::Vector<float> graphHeights;
+    GUI::DataModelPublisher frameStatPublisher(gui.getFrameStatModel(), statsInterval);
+    GUI::DataModelPublisher framePacingPublisher(gui.getFramePacingModel(), statsInterval);
+    GUI::DataModelPublisher sceneLoadPublisher(gui.getSceneLoadModel(), statsInterval);
+
+    int framesProfiled = 0;
+    // the game logic's time, the frame times added up, or recorded frame deltas when replaying
+    std::chrono::steady_clock::time_point gameTime = old_time;
+    bool sessionStarted = false;
+    std::vector<SDL_Event> sessionEvents; // recorded or replayed this frame
+    const uint32_t windowId = SDL_GetWindowID(window.get());
+    CameraPath recordedCameraPath;
+    std::chrono::steady_clock::time_point cameraPathStart;
 
     bool showingGui = true;
     int guiMouseX = 0, guiMouseY = 0;
+    // the input / window events, live or replayed
+    const auto handleEvent = [&](const SDL_Event &event)
+    {
+        if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_TAB)
+        {
+            if (showingGui)
+            {
+                SDL_GetMouseState(&guiMouseX, &guiMouseY);
+            }
+            showingGui = !showingGui;
+            SDL_SetRelativeMouseMode(!showingGui ? SDL_TRUE : SDL_FALSE);
+            if (showingGui)
+            {
+                // SDL_ShowCursor(SDL_DISABLE);
+                SDL_WarpMouseInWindow(window.get(), guiMouseX, guiMouseY);
+            }
+            if (Rml::ElementDocument * const mainMenuDoc = gui.getMainMenuDocument())
+            {
+                if (showingGui)
+                    mainMenuDoc->Show();
+                else
+                    mainMenuDoc->Hide();
+            }
+        }
+        else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_RETURN && (event.key.keysym.mod & KMOD_CTRL))
+        {
+            const bool wasFullscreen = SDL_GetWindowFlags(window.get()) & SDL_WINDOW_FULLSCREEN;
+            const int displayIndex = SDL_GetWindowDisplayIndex(window.get());
+            SDL_DisplayMode desktopDisplayMode;
+            if (SDL_GetDesktopDisplayMode(displayIndex, &desktopDisplayMode) == 0)
+            {
+                SDL_SetWindowDisplayMode(window.get(), &desktopDisplayMode);
+            }
+            SDL_SetWindowDisplayMode(window.get(), &desktopDisplayMode);
+            SDL_SetWindowFullscreen(window.get(), wasFullscreen ? 0 : SDL_WINDOW_FULLSCREEN);
+        }
+#ifdef ENABLE_PROFILER
+        else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F9)
+        {
+            // starts a capture, or ends it and writes it out
+            if (Profiler::isCapturing())
+                Profiler::endCapture(profilePath);
+            else
+                Profiler::beginCapture();
+        }
+#endif // ENABLE_PROFILER
+        else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F7 && !benchmark)
+        {
+            // records a keyframe for a benchmark camera path, at the time since the first one
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (recordedCameraPath.empty())
+                cameraPathStart = now;
+            recordedCameraPath.addKeyframe(std::chrono::duration<float>(now - cameraPathStart).count(), game.getCameraState());
+            const std::string &filename = cameraPathFile.empty() ? DEFAULT_CAMERA_PATH : cameraPathFile;
+            if (recordedCameraPath.save(filename))
+                std::cout << "Camera keyframe " << recordedCameraPath.getNumKeyframes() << " saved to \"" << filename << "\"" << std::endl;
+        }
+        else if (showingGui)
+        {
+            gui.handleEvent(event);
+            if (event.type == SDL_WINDOWEVENT)
+                game.handleEvent(event);
+        }
+        else
+        {
+            game.handleEvent(event);
+        }
+    };
     // SDL_ShowCursor(SDL_DISABLE); // TODO maybe move this further up?
     while (
         !game.getQuit() &&
         !gui.getQuit() &&
         !SDL_QuitRequested())
     {
+        // NOTE: the frame limiter waits here, before the input is read, so it doesn't add latency
+        {
+            PROFILE_ZONE("Wait");
+            pacer.waitForNextFrame();
+        }
+        PROFILE_ZONE("Frame");
+
         // calculate time delta
-        Uint64 new_ticks = SDL_GetTicks64();
-        const float seconds_elapsed = static_cast<float>(new_ticks - old_ticks)/1000.0f;
-        old_ticks = new_ticks;
+        const std::chrono::steady_clock::time_point new_time = std::chrono::steady_clock::now();
+        std::chrono::nanoseconds gameDelta = std::chrono::duration_cast<std::chrono::nanoseconds>(new_time - old_time);
+        old_time = new_time;
+        FrameTiming timing;
+        std::chrono::steady_clock::time_point phaseStart = new_time;
+
+        // a recorded (or replayed) session starts once the scene has loaded, from a restarted game logic clock, so
+        // the replay starts out exactly like the recording did regardless of how long the loading took
+        sessionEvents.clear();
+        if (recordingSession && !sessionStarted)
+        {
+            const AsyncSceneLoad * const sceneLoad = game.getSceneLoad();
+            if (!sceneLoad || sceneLoad->isFinished())
+            {
+                sessionStarted = true;
+                gameTime = new_time;
+                gameDelta = std::chrono::nanoseconds::zero();
+                game.restartClock(gameTime);
+            }
+        }
+        if (replayer && sessionStarted && !replayer->readFrame(windowId, gameDelta, sessionEvents))
+        {
+            // the end of the recording
+            break;
+        }
+        gameTime += std::chrono::duration_cast<std::chrono::steady_clock::duration>(gameDelta);
+        const float seconds_elapsed = std::chrono::duration<float>(gameDelta).count();
 
         // process input / window events
-        SDL_Event event;
-        while (SDL_PollEvent(&event) &&
-            !game.getQuit() &&
-            !gui.getQuit() &&
-            !SDL_QuitRequested())
         {
-            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_TAB)
+            PROFILE_ZONE("Input");
+            SDL_Event event;
+            while (SDL_PollEvent(&event) &&
+                !game.getQuit() &&
+                !gui.getQuit() &&
+                !SDL_QuitRequested())
             {
-                if (showingGui)
-                {
-                    SDL_GetMouseState(&guiMouseX, &guiMouseY);
-                }
-                showingGui = !showingGui;
-                SDL_SetRelativeMouseMode(!showingGui ? SDL_TRUE : SDL_FALSE);
-                if (showingGui)
-                {
-                    // SDL_ShowCursor(SDL_DISABLE);
-                    SDL_WarpMouseInWindow(window.get(), guiMouseX, guiMouseY);
-                }
-                if (Rml::ElementDocument * const mainMenuDoc = gui.getMainMenuDocument())
-                {
-                    if (showingGui)
-                        mainMenuDoc->Show();
-                    else
-                        mainMenuDoc->Hide();
-                }
+                // NOTE: the replayed input is in charge, only the window events get through, and a recorded session
+                // only gets the input from when it started
+                if (InputRecorder::isRecorded(event) && (replayer || (recordingSession && !sessionStarted)))
+                    continue;
+                if (recorder.isOpen())
+                    sessionEvents.push_back(event);
+                handleEvent(event);
             }
-            else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_RETURN && (event.key.keysym.mod & KMOD_CTRL))
+            if (replayer)
             {
-                const bool wasFullscreen = SDL_GetWindowFlags(window.get()) & SDL_WINDOW_FULLSCREEN;
-                const int displayIndex = SDL_GetWindowDisplayIndex(window.get());
-                SDL_DisplayMode desktopDisplayMode;
-                if (SDL_GetDesktopDisplayMode(displayIndex, &desktopDisplayMode) == 0)
-                {
-                    SDL_SetWindowDisplayMode(window.get(), &desktopDisplayMode);
-                }
-                SDL_SetWindowDisplayMode(window.get(), &desktopDisplayMode);
-                SDL_SetWindowFullscreen(window.get(), wasFullscreen ? 0 : SDL_WINDOW_FULLSCREEN);
+                for (const SDL_Event &replayedEvent : sessionEvents)
+                    handleEvent(replayedEvent);
             }
-            else if (showingGui)
+            else if (recorder.isOpen() && sessionStarted)
             {
-                gui.handleEvent(event);
-                if (event.type == SDL_WINDOWEVENT)
-                    game.handleEvent(event);
+                recorder.recordFrame(gameDelta, sessionEvents);
             }
-            else
+        }
+
+        // reload whatever changed on disk (debounced by the watcher), each kind of file only once per frame
+        // NOTE: counted as input rather than simulation, it's the reaction to files being edited
+        if (fileWatcher)
+        {
+            PROFILE_ZONE("Hot Reload");
+            bool documentsChanged = false, texturesChanged = false, sceneChanged = false;
+            for (const std::string &path : fileWatcher->takeChanges(new_time))
             {
-                game.handleEvent(event);
+                if (endsWith(path, ".rml") || endsWith(path, ".rcss"))
+                    documentsChanged = true;
+                else if (endsWith(path, ".tga") || endsWith(path, ".png"))
+                    texturesChanged = true;
+                else if (!sceneRealPath.empty() && getRealPath(path) == sceneRealPath)
+                    sceneChanged = true;
+            }
+            if (documentsChanged)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                const Rml::ElementDocument * const frameStatsDocument = gui.getFrameStatsDocument();
+                const Rml::Vector<Rml::String> reloaded = gui.reloadStaleDocuments();
+                if (gui.getFrameStatsDocument() != frameStatsDocument)
+                    attachResetEventListener();
+                for (const Rml::String &path : reloaded)
+                    std::cout << "Reloaded \"" << path << "\"" << std::endl;
+                if (!reloaded.empty())
+                    std::cout << "Reloaded " << reloaded.size() << " UI documents in " << millisecondsSince(start) << " ms" << std::endl;
+            }
+            if (texturesChanged)
+            {
+                // NOTE: RmlUi loads them again the next time they are drawn
+                Rml::ReleaseTextures();
+                std::cout << "Released the UI textures to reload them" << std::endl;
+            }
+            if (sceneChanged)
+            {
+                // NOTE: the meshes are imported again (in the background), the load time is shown like at startup
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                game.reloadScene();
+                std::cout << "Reloading \"" << gameOptions.scenePath << "\", the old scene was destroyed in " << millisecondsSince(start) << " ms" << std::endl;
+                sceneReloading = true;
+            }
+            const AsyncSceneLoad * const sceneLoad = game.getSceneLoad();
+            if (sceneReloading && sceneLoad && sceneLoad->isFinished())
+            {
+                sceneReloading = false;
+                std::cout << "Reloaded \"" << gameOptions.scenePath << "\" in " << sceneLoad->getStats().totalMs << " ms" << std::endl;
             }
         }
+        timing.inputMs = millisecondsSince(phaseStart);
 
-        game.advance(seconds_elapsed);
-        //if (showingGui) // TODO why do things go strangely if I don't guard this?
         {
-            static int counter;
-            counter++;
-            if (counter == 20)
+            PROFILE_ZONE("Simulation");
+            game.advance(gameTime);
+            if (benchmark)
+                benchmark->beginFrame(game);
+        }
+        timing.simulationMs = millisecondsSince(phaseStart);
+        if (resetEventListener.resetClicked)
+        {
+            resetEventListener.resetClicked = false;
+            frameTimings.reset();
+        }
+        // NOTE: on a timer rather than every frame, and only what changed visibly is dirtied, as every dirty
+        // variable makes RmlUi update (and re-layout) the elements bound to it
+        if (frameStatPublisher.isDue(new_time))
+        {
+            PROFILE_ZONE("Frame Stats");
+            GUI::FrameStatData &data = gui.getFrameStatData();
+            Ogre::Root * const root = Ogre::Root::getSingletonPtr();
+            // root->resetFrameStats();
+            const Ogre::FrameStats * const frameStats = root->getFrameStats();
+            const Ogre::RenderingMetrics &renderingMetrics = root->getRenderSystem()->getMetrics();
+            const float fps = frameStats->getRollingAverageFps();
+            const float avgTime = (frameStats->getRollingAverage()*1000.0);
+            const float bestTime = (frameStats->getBestTime()*1000.0);
+            const float worstTime = (frameStats->getWorstTime()*1000.0);
+            GUI::DataModelPublisher &p = frameStatPublisher;
+            p.set("fps", data.fps, fps, 3);
+            p.set("avgTime", data.avgTime, avgTime, 3);
+            p.set("bestTime", data.bestTime, bestTime, 3);
+            p.set("worstTime", data.worstTime, worstTime, 3);
+            p.set("faceCount", data.faceCount, static_cast<int>(renderingMetrics.mFaceCount));
+            p.set("vertexCount", data.vertexCount, static_cast<int>(renderingMetrics.mVertexCount));
+            p.set("drawCount", data.drawCount, static_cast<int>(renderingMetrics.mDrawCount));
+            p.set("batchCount", data.batchCount, static_cast<int>(renderingMetrics.mBatchCount));
+            p.set("sceneUpdateTime", data.sceneUpdateTime, game.takeSceneUpdateTime(), 3);
+            p.set("sceneThreads", data.sceneThreads, static_cast<int>(game.getSceneManagerThreads()));
+            const FrameTimingSummary summary = frameTimings.getSummary();
+            p.set("p50Time", data.p50Time, summary.p50Ms, 2);
+            p.set("p95Time", data.p95Time, summary.p95Ms, 2);
+            p.set("p99Time", data.p99Time, summary.p99Ms, 2);
+            p.set("p999Time", data.p999Time, summary.p999Ms, 2);
+            p.set("stutters", data.stutters, static_cast<int>(summary.stutters));
+            p.set("totalStutters", data.totalStutters, static_cast<int>(summary.totalStutters));
+            p.set("inputTime", data.inputTime, summary.average.inputMs, 3);
+            p.set("simulationTime", data.simulationTime, summary.average.simulationMs, 3);
+            p.set("ogreTime", data.ogreTime, summary.average.ogreMs, 3);
+            p.set("rmluiTime", data.rmluiTime, summary.average.rmluiMs, 3);
+            p.set("swapTime", data.swapTime, summary.average.swapMs, 3);
+            p.set("gpuSupported", data.gpuSupported, ogreGpuTimer.isSupported());
+            p.set("gpuOgreTime", data.gpuOgreTime, gpuTimes.ogreFrames ? static_cast<float>(gpuTimes.ogreMs / gpuTimes.ogreFrames) : 0.0f, 3);
+            p.set("gpuRmlUiTime", data.gpuRmlUiTime, gpuTimes.rmluiFrames ? static_cast<float>(gpuTimes.rmluiMs / gpuTimes.rmluiFrames) : 0.0f, 3);
+            gpuTimes = GpuTimeTotals();
+            // NOTE: the bars are compared at whole percents, finer than that doesn't show
+            const size_t graphCount = frameTimings.copyLatest(graphTimings.data(), graphTimings.size());
+            graphHeights.resize(graphCount);
+            for (size_t i = 0; i < graphCount; ++i)
+                graphHeights[i] = std::min(graphTimings[i].totalMs / GUI::GRAPH_MAX_TIME * 100.0f, 100.0f);
+            p.set("graph", data.graph, graphHeights, 0);
+        }
+        if (framePacingPublisher.isDue(new_time))
+        {
+            GUI::FramePacingData &pacing = gui.getFramePacingData();
+            const FramePacer::PresentStats presentStats = pacer.getPresentStats();
+            framePacingPublisher.set("presentInterval", pacing.presentInterval, presentStats.averageIntervalMs, 2);
+            framePacingPublisher.set("presentJitter", pacing.presentJitter, presentStats.jitterMs, 2);
+            framePacingPublisher.set("adaptiveSupported", pacing.adaptiveSupported, presentStats.adaptiveVSyncSupported);
+        }
+        // the frame pacing mode can be changed in the GUI
+        {
+            const GUI::FramePacingData &pacing = gui.getFramePacingData();
+            FramePacer::Mode mode;
+            if (FramePacer::parseMode(pacing.mode, mode))
+                pacer.setMode(mode);
+            if (pacing.targetFps > 0 && pacing.targetFps != guiTargetFps)
             {
-                counter = 0;
-                GUI::FrameStatData &data = gui.getFrameStatData();
-                Rml::DataModelHandle model = gui.getFrameStatModel();
-                Ogre::Root * const root = Ogre::Root::getSingletonPtr();
-                // root->resetFrameStats();
-                const Ogre::FrameStats * const frameStats = root->getFrameStats();
-                const Ogre::RenderingMetrics &renderingMetrics = root->getRenderSystem()->getMetrics();
-                const float fps = frameStats->getRollingAverageFps();
-                const float avgTime = (frameStats->getRollingAverage()*1000.0);
-                const float bestTime = (frameStats->getBestTime()*1000.0);
-                const float worstTime = (frameStats->getWorstTime()*1000.0);
-                data.fps = fps;
-                data.avgTime = avgTime;
-                data.bestTime = bestTime;
-                data.worstTime = worstTime;
-                data.faceCount = renderingMetrics.mFaceCount;
-                data.vertexCount = renderingMetrics.mVertexCount;
-                if (model)
-                    model.DirtyAllVariables();
+                guiTargetFps = pacing.targetFps;
+                pacer.setTargetFps(pacing.targetFps);
             }
         }
+        // forward the scene streaming progress to the GUI
+        // NOTE: data.loading only turns false once that is published, so the final state always makes it
+        const AsyncSceneLoad * const sceneLoad = game.getSceneLoad();
+        if (sceneLoad && (!sceneLoad->isFinished() || gui.getSceneLoadData().loading) && sceneLoadPublisher.isDue(new_time))
+        {
+            GUI::SceneLoadData &data = gui.getSceneLoadData();
+            const SceneLoadStats &stats = sceneLoad->getStats();
+            GUI::DataModelPublisher &p = sceneLoadPublisher;
+            p.set("loading", data.loading, !sceneLoad->isFinished());
+            p.set("progress", data.progress, sceneLoad->getProgress(), 2);
+            p.set("status", data.status, sceneLoad->getStatusText());
+            p.set("loadTime", data.loadTime, static_cast<float>(stats.totalMs), 1);
+            p.set("datablocks", data.datablocks, static_cast<int>(stats.numDatablocks));
+            p.set("datablocksSaved", data.datablocksSaved, static_cast<int>(stats.getDatablocksSaved()));
+            p.set("items", data.items, static_cast<int>(stats.numItems));
+            p.set("itemsBeforeMerge", data.itemsBeforeMerge, static_cast<int>(stats.numSourceItems));
+            p.set("staticItems", data.staticItems, static_cast<int>(stats.numStaticItems));
+        }
         gui.advance(seconds_elapsed);
+        timing.rmluiMs = millisecondsSince(phaseStart);
 
         // SDL_GL_MakeCurrent(window.get(), ogreContext.get());
         // glClear(GL_COLOR_BUFFER_BIT);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 #ifdef ENABLE_RMLUI_CONTEXT
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
         SDL_GL_MakeCurrent(window.get(), ogreContext.get());
 #endif // ENABLE_RMLUI_CONTEXT
-        game.draw();
+        {
+            PROFILE_ZONE("Ogre Render");
+            if (ogreGpuTimer.beginFrame())
+                collectGpuTimes(ogreGpuTimer, gpuTimes);
+            ogreGpuTimer.timestamp(GPU_OGRE_BEGIN);
+            game.draw();
+            ogreGpuTimer.timestamp(GPU_OGRE_END);
+        }
+        timing.ogreMs = millisecondsSince(phaseStart);
+#ifndef ENABLE_RMLUI_CONTEXT
+        // NOTE: the UI was drawn by a pass of the workspace, move its time out of Ogre's
+        if (CompositorPassRmlUiProvider * const passProvider = game.getRmlUiPassProvider())
+        {
+            const float uiMs = std::min(passProvider->takeRenderTime(), timing.ogreMs);
+            timing.ogreMs -= uiMs;
+            timing.rmluiMs += uiMs;
+        }
+#endif // ENABLE_RMLUI_CONTEXT
         // if (showingGui)
         {
 #ifdef ENABLE_RMLUI_CONTEXT
             SDL_GL_MakeCurrent(window.get(), rmluiContext.get());
+            if (rmluiGpuTimer.beginFrame())
+                collectGpuTimes(rmluiGpuTimer, gpuTimes);
+            rmluiGpuTimer.timestamp(GPU_RMLUI_BEGIN);
 #endif // ENABLE_RMLUI_CONTEXT
             gui.draw();
+#ifdef ENABLE_RMLUI_CONTEXT
+            rmluiGpuTimer.timestamp(GPU_RMLUI_END);
+#endif // ENABLE_RMLUI_CONTEXT
+        }
+        timing.rmluiMs += millisecondsSince(phaseStart);
+        {
+            PROFILE_ZONE("Present");
+            pacer.present();
         }
-        SDL_GL_SwapWindow(window.get());
+        timing.swapMs = millisecondsSince(phaseStart);
+        timing.totalMs = std::chrono::duration<float, std::milli>(phaseStart - new_time).count();
+        frameTimings.push(timing);
+
+        // --profile-frames
+        if (profileFrames > 0 && Profiler::isCapturing() && ++framesProfiled == profileFrames)
+            Profiler::endCapture(profilePath);
+
+        if (benchmark)
+        {
+            benchmark->endFrame(timing);
+            if (benchmark->isFinished())
+                break;
+        }
+    }
+    // NOTE: quitting before the last frame still writes out what was captured
+    if (Profiler::isCapturing())
+        Profiler::endCapture(profilePath);
+
+    if (!recorder.close())
+        return EXIT_FAILURE;
+    if (replayer)
+    {
+        const FrameTimingSummary summary = frameTimings.getSummary();
+        std::cout << "Replayed " << replayer->getNumFramesRead() << " frames, frame time p50 " << summary.p50Ms
+                  << " ms, p95 " << summary.p95Ms << " ms, p99 " << summary.p99Ms << " ms, "
+                  << summary.totalStutters << " stutters" << std::endl;
+    }
+
+    if (benchmark)
+    {
+        if (benchmark->getPhase() != Benchmark::Phase::Done)
+        {
+            if (benchmark->getPhase() != Benchmark::Phase::Failed)
+                fprintf(stderr, "error: the benchmark was stopped before it was done\n");
+            return EXIT_FAILURE;
+        }
+        if (!benchmark->writeResults())
+            return EXIT_FAILURE;
     }
 
     return EXIT_SUCCESS;
@@ -222,6 +780,18 @@ static int mainBody(int argc, const char *argv[])
 
 int main(int argc, const char *argv[])
 {
+    // NOTE: --mesh-report only imports a scene and prints how well the mesh optimisation pass did, it doesn't need
+    // SDL, a window or Ogre, so it also runs on machines without a display
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--mesh-report")
+        {
+            SceneLoadOptions options;
+            options.instancing = true; // NOTE: the same meshes as FPSGame loads
+            return printMeshOptimizationReport(argv[i + 1], options) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
     // initialize SDL
     if (SDL_Init(SDL_INIT_VIDEO) < 0)
     {
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Generates data/large_mesh_test.glb, a single terrain-like grid mesh with more
+vertices than a 16-bit index buffer can address (65535), used to check that the
+scene loader switches to 32-bit indices (or splits the mesh) instead of
+silently wrapping the indices around.
+
+Usage: python3 tools/generate_large_mesh_scene.py [output.glb]
+"""
+
+import json
+import math
+import struct
+import sys
+
+GRID_X = 260  # 260 * 253 = 65780 vertices
+GRID_Z = 253
+SIZE = 200.0  # meters
+HEIGHT = 6.0
+
+
+def build_grid():
+    positions = bytearray()
+    min_pos = [math.inf] * 3
+    max_pos = [-math.inf] * 3
+    for z in range(GRID_Z):
+        for x in range(GRID_X):
+            px = (x / (GRID_X - 1) - 0.5) * SIZE
+            pz = (z / (GRID_Z - 1) - 0.5) * SIZE
+            py = HEIGHT * math.sin(px * 0.05) * math.cos(pz * 0.07) - 2.0
+            p = (px, py, pz)
+            positions += struct.pack('<3f', *p)
+            for axis in range(3):
+                min_pos[axis] = min(min_pos[axis], p[axis])
+                max_pos[axis] = max(max_pos[axis], p[axis])
+
+    indices = bytearray()
+    for z in range(GRID_Z - 1):
+        for x in range(GRID_X - 1):
+            i0 = z * GRID_X + x
+            i1 = i0 + 1
+            i2 = i0 + GRID_X
+            i3 = i2 + 1
+            indices += struct.pack('<6I', i0, i2, i1, i1, i2, i3)
+    return positions, indices, min_pos, max_pos
+
+
+def main():
+    output = sys.argv[1] if len(sys.argv) > 1 else 'data/large_mesh_test.glb'
+    positions, indices, min_pos, max_pos = build_grid()
+    num_vertices = GRID_X * GRID_Z
+    num_indices = (GRID_X - 1) * (GRID_Z - 1) * 6
+
+    binary = positions + indices
+    gltf = {
+        'asset': {'version': '2.0', 'generator': 'generate_large_mesh_scene.py'},
+        'extensionsUsed': ['KHR_lights_punctual'],
+        'extensions': {'KHR_lights_punctual': {'lights': [
+            {'type': 'directional', 'color': [1, 1, 1], 'intensity': 3, 'name': 'Sun'},
+        ]}},
+        'scene': 0,
+        'scenes': [{'name': 'Scene', 'nodes': [0, 1]}],
+        'nodes': [
+            {'name': 'Terrain', 'mesh': 0},
+            {'name': 'Sun', 'rotation': [-0.3535534, 0.3535534, 0.1464466, 0.8535534],
+             'extensions': {'KHR_lights_punctual': {'light': 0}}},
+        ],
+        'materials': [{'name': 'Terrain', 'pbrMetallicRoughness': {
+            'baseColorFactor': [0.3, 0.55, 0.2, 1], 'metallicFactor': 0, 'roughnessFactor': 0.8}}],
+        'meshes': [{'name': 'Terrain', 'primitives': [
+            {'attributes': {'POSITION': 0}, 'indices': 1, 'material': 0}]}],
+        'accessors': [
+            {'bufferView': 0, 'componentType': 5126, 'count': num_vertices, 'type': 'VEC3',
+             'min': min_pos, 'max': max_pos},
+            {'bufferView': 1, 'componentType': 5125, 'count': num_indices, 'type': 'SCALAR'},
+        ],
+        'bufferViews': [
+            {'buffer': 0, 'byteOffset': 0, 'byteLength': len(positions), 'target': 34962},
+            {'buffer': 0, 'byteOffset': len(positions), 'byteLength': len(indices), 'target': 34963},
+        ],
+        'buffers': [{'byteLength': len(binary)}],
+    }
+
+    json_chunk = json.dumps(gltf, separators=(',', ':')).encode('utf-8')
+    json_chunk += b' ' * (-len(json_chunk) % 4)
+    binary += b'\0' * (-len(binary) % 4)
+    total_length = 12 + 8 + len(json_chunk) + 8 + len(binary)
+
+    with open(output, 'wb') as f:
+        f.write(struct.pack('<4sII', b'glTF', 2, total_length))
+        f.write(struct.pack('<I4s', len(json_chunk), b'JSON'))
+        f.write(json_chunk)
+        f.write(struct.pack('<I4s', len(binary), b'BIN\0'))
+        f.write(binary)
+    print('wrote %s (%d vertices, %d triangles)' % (output, num_vertices, num_indices // 3))
+
+
+if __name__ == '__main__':
+    main()
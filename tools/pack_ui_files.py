@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Packs the UI files (RML documents, RCSS style sheets, TGA images and TTF
+fonts under assets/ and data/) into ui.pak, a single file that
+ShellFileInterface memory-maps at startup instead of opening every file.
+
+The layout (little-endian, read by src/ShellFileInterface.cpp):
+  header: "RPAK", uint32 version, uint32 entry count, uint32 TOC size
+  TOC:    per entry uint64 offset, uint64 size, uint32 path length, path
+  data:   the files, each one starting at a multiple of 16 bytes
+
+The paths are relative to the project directory, e.g. "assets/window.rml".
+The pack has to be rebuilt after changing any of the files (or deleted, then
+the files are read from disk again).
+
+Usage: python3 tools/pack_ui_files.py [output.pak]
+"""
+
+import os
+import struct
+import sys
+
+MAGIC = b'RPAK'
+VERSION = 1
+ALIGNMENT = 16
+DIRECTORIES = ['assets', 'data']
+EXTENSIONS = {'.rml', '.rcss', '.tga', '.ttf', '.otf'}
+
+
+def find_files(project_dir):
+    paths = []
+    for directory in DIRECTORIES:
+        for dirpath, dirnames, filenames in os.walk(os.path.join(project_dir, directory)):
+            dirnames.sort()
+            for filename in sorted(filenames):
+                if os.path.splitext(filename)[1].lower() in EXTENSIONS:
+                    full_path = os.path.join(dirpath, filename)
+                    paths.append(os.path.relpath(full_path, project_dir).replace(os.sep, '/'))
+    return paths
+
+
+def align(offset):
+    return offset + (-offset % ALIGNMENT)
+
+
+def main():
+    project_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+    output = sys.argv[1] if len(sys.argv) > 1 else os.path.join(project_dir, 'ui.pak')
+    paths = find_files(project_dir)
+
+    contents = []
+    for path in paths:
+        with open(os.path.join(project_dir, path), 'rb') as f:
+            contents.append(f.read())
+
+    toc_size = sum(8 + 8 + 4 + len(path.encode('utf-8')) for path in paths)
+    offset = align(16 + toc_size)
+    toc = bytearray()
+    offsets = []
+    for path, data in zip(paths, contents):
+        encoded = path.encode('utf-8')
+        toc += struct.pack('<QQI', offset, len(data), len(encoded)) + encoded
+        offsets.append(offset)
+        offset = align(offset + len(data))
+
+    with open(output, 'wb') as f:
+        f.write(struct.pack('<4sIII', MAGIC, VERSION, len(paths), toc_size))
+        f.write(toc)
+        for data_offset, data in zip(offsets, contents):
+            f.write(b'\0' * (data_offset - f.tell()))
+            f.write(data)
+    print('wrote %s (%d files, %d bytes)' % (output, len(paths), offset))
+
+
+if __name__ == '__main__':
+    main()